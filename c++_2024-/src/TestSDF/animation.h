@@ -4,97 +4,836 @@
 namespace animation {
 struct Skeleton {
     float4x4 geometryFromRoot;
-    float4x4* parentFromPosedJoint;
-    float4x4* geometryFromPosedJoint;
     float4x4* jointFromGeometry;
+    float4* jointBounds; // joint space sphere around the vertices each joint influences (w: radius, <0 if none)
     s8* parentIndices; // the parent of each joint (-1 for root)
     u32 jointCount; // number of joints
 };
-struct Joint_TRS {
-    float3 translation;
-    float4 rotation;
-    float3 scale;
+// Keyframes are stored SoA and frame-major: each frame holds all joints packed in blocks of 8,
+// one joint per lane, so that the sampler can blend 8 joints per instruction.
+// Lanes past the skeleton's joint count hold the identity transform
+enum { JointLanes = 8 };
+struct JointBlock {
+    f32 tx[JointLanes]; f32 ty[JointLanes]; f32 tz[JointLanes];
+    f32 qx[JointLanes]; f32 qy[JointLanes]; f32 qz[JointLanes]; f32 qw[JointLanes];
+    f32 sx[JointLanes]; f32 sy[JointLanes]; f32 sz[JointLanes];
 };
-struct JointKeyframes {
-    Joint_TRS* joint_to_parent_trs; // must be initaliazed to Clip::frameCount
+// Compressed clips keep three tracks per joint, each with only the keys that can't be linearly
+// interpolated from their neighbours within CompressionParams' error bounds (a single key for
+// constant tracks). Keys are 48 bits: rotations are smallest-three quaternions, translations
+// and scales are quantized to 16 bits per component within the track's range
+struct TrackType { enum Enum { Translation, Rotation, Scale, Count }; };
+struct QuantizedKey { u16 v[3]; };
+struct Track {
+    float3 min; // quantization range, translation and scale tracks only
+    float3 extent;
+    u32 firstKey; // into CompressedClip::keyFrames and CompressedClip::keys
+    u32 keyCount;
+};
+struct CompressedClip {
+    Track* tracks; // jointCount * TrackType::Count
+    u16* keyFrames; // frame of each key, in increasing order within a track
+    QuantizedKey* keys;
+    u32 keyCount;
+};
+struct CompressionParams {
+    f32 maxTranslationError = 0.001f;
+    f32 maxRotationError = 0.001f; // per quaternion component
+    f32 maxScaleError = 0.001f;
 };
 struct Clip {
-    JointKeyframes* joints;
+    JointBlock* frames; // frameCount * blockCount blocks, null for compressed clips
+    CompressedClip compressed;
+    u32 blockCount; // (jointCount + 7) / 8
     u32 frameCount;
     f32 timeEnd;
 };
+// Decoding state of a compressed clip for 8 joints: the two keys of each track around the last
+// sampled frame, already decoded, so sampling only blends them as sampleClip_256 does. Keys are
+// only decoded again once the frame leaves their segment, which, as clip time moves forward,
+// means walking to the next key instead of searching the track
+struct KeyCursorBlock {
+    JointBlock key0;
+    JointBlock key1; // rotations are on key0's hemisphere
+    f32 start[TrackType::Count][JointLanes]; // frame of key0
+    f32 end[TrackType::Count][JointLanes]; // frame of key1, FLT_MAX for tracks with a single key
+    f32 invLength[TrackType::Count][JointLanes]; // 1 / (end - start), 0 for tracks with a single key
+    u32 key[TrackType::Count][JointLanes]; // index of key0 within its track
+};
 struct State {
     float4x4 skinning[32]; // geometry to posed geometry matrices for each joint // todo: improve??
     u32 animIndex;
     f32 time;
     f32 scale;
+    u32 updateInterval; // frames between pose evaluations, 0 if frozen
+    float3 boundsMin; // geometry space box around the posed joint bounds
+    float3 boundsMax;
 };
 typedef u32 Handle;
-struct NodeMeta { enum Enum { HandleBits = 32, HandleMask = 0xffffffff, MaxNodes = HandleMask - 1 }; }; // handle=0 reserved for 0 initialization
+struct NodeMeta { enum Enum { MaxNodes = allocator::PackedPoolMeta::MaxSlots }; }; // generation-tagged, handle=0 reserved for 0 initialization
 struct Node {
-    Skeleton skeleton; // constant mesh_to_joint matrices, as well as posed joint_to_parent matrices
+    Skeleton skeleton; // constant mesh_to_joint matrices, shared by every node of the same asset
     Clip* clips;
     State state; // separate???
+    KeyCursorBlock keyCursors[32 / JointLanes]; // for compressed clips, same joint limit as State::skinning
+    const Clip* keyCursorClip; // clip the cursors were last used with, they're reset on change
     u32 clipCount;
+    renderer::DrawNodeHandle drawHandle; // to pick the update rate from visibility and distance
+};
+// Nodes that were visible last frame are evaluated every frame up to fullRateDistance from the
+// camera, and then every 2 to maxInterval frames, reached at minRateDistance. Nodes not seen
+// by any camera are frozen: their clip time keeps advancing, but their pose isn't evaluated
+// until they are visible again
+struct LODParams {
+    f32 fullRateDistance = 40.f;
+    f32 minRateDistance = 160.f;
+    u32 maxInterval = 4;
+    bool enabled = true;
 };
 struct Scene {
-    allocator::Pool<Node> nodes;
+    allocator::PackedPool<Node> nodes;
+    LODParams lod;
+    u32 frameIndex;
+    u32 evaluatedCount; // nodes posed during the last update
 };
 
 force_inline Node& get_node(Scene& scene, const Handle handle) {
-    return allocator::get_pool_slot(scene.nodes, handle - 1);
+    return allocator::get_packed_pool_slot(scene.nodes, handle);
 }
 force_inline Handle handle_from_node(Scene& scene, Node& node) {
-    return allocator::get_pool_index(scene.nodes, node) + 1;
+    return allocator::get_packed_pool_handle(scene.nodes, node);
+}
+
+force_inline u32 get_block_count(const u32 jointCount) { return (jointCount + JointLanes - 1) / JointLanes; }
+force_inline const JointBlock* get_frame(const Clip& clip, const u32 frame) {
+    return clip.frames + frame * clip.blockCount;
+}
+void set_joint_lane(
+    JointBlock& block, const u32 lane,
+    const float3& translation, const float4& rotation, const float3& scale) {
+    block.tx[lane] = translation.x; block.ty[lane] = translation.y; block.tz[lane] = translation.z;
+    block.qx[lane] = rotation.x; block.qy[lane] = rotation.y;
+    block.qz[lane] = rotation.z; block.qw[lane] = rotation.w;
+    block.sx[lane] = scale.x; block.sy[lane] = scale.y; block.sz[lane] = scale.z;
+}
+
+// Reference sampler: slerps rotations and lerps translation and scale, one joint at a time
+void sampleClip(
+    float4x4* parentFromPosedJoint, const Clip& clip, const u32 jointCount,
+    const u32 f0, const f32 alpha) {
+    const JointBlock* frame0 = get_frame(clip, f0);
+    const JointBlock* frame1 = get_frame(clip, f0 + 1);
+    for (u32 jointIndex = 0; jointIndex < jointCount; jointIndex++) {
+        const JointBlock& a = frame0[jointIndex / JointLanes];
+        const JointBlock& b = frame1[jointIndex / JointLanes];
+        const u32 l = jointIndex % JointLanes;
+        // note: this will likely always default to lerp, since the angle delta will likely be small
+        float4 q = math::quaternionSlerp(
+            alpha, float4(a.qx[l], a.qy[l], a.qz[l], a.qw[l]), float4(b.qx[l], b.qy[l], b.qz[l], b.qw[l]));
+        float3 translation = math::lerp(
+            alpha, float3(a.tx[l], a.ty[l], a.tz[l]), float3(b.tx[l], b.ty[l], b.tz[l]));
+        float3 scale = math::lerp(
+            alpha, float3(a.sx[l], a.sy[l], a.sz[l]), float3(b.sx[l], b.sy[l], b.sz[l]));
+        parentFromPosedJoint[jointIndex] = math::trsToMatrix(translation, q, scale);
+    }
+}
+
+// Normalizes the rotations of 8 joints and builds their matrices in SoA form (same formulas as
+// math::trsToMatrix), then writes the first laneCount of them out
+force_inline void storeJointMatrices_256(
+    float4x4* out, const u32 laneCount,
+    const __m256 tx, const __m256 ty, const __m256 tz,
+    __m256 qx, __m256 qy, __m256 qz, __m256 qw,
+    const __m256 scalex, const __m256 scaley, const __m256 scalez) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 two = _mm256_set1_ps(2.f);
+    const __m256 sx = _mm256_mul_ps(two, scalex);
+    const __m256 sy = _mm256_mul_ps(two, scaley);
+    const __m256 sz = _mm256_mul_ps(two, scalez);
+
+    __m256 lengthSq = _mm256_mul_ps(qx, qx);
+    lengthSq = _mm256_fmadd_ps(qy, qy, lengthSq);
+    lengthSq = _mm256_fmadd_ps(qz, qz, lengthSq);
+    lengthSq = _mm256_fmadd_ps(qw, qw, lengthSq);
+    const __m256 invLength = _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_sqrt_ps(lengthSq));
+    qx = _mm256_mul_ps(qx, invLength); qy = _mm256_mul_ps(qy, invLength);
+    qz = _mm256_mul_ps(qz, invLength); qw = _mm256_mul_ps(qw, invLength);
+
+    const __m256 xx = _mm256_mul_ps(qx, qx), xy = _mm256_mul_ps(qx, qy);
+    const __m256 xz = _mm256_mul_ps(qx, qz), xw = _mm256_mul_ps(qx, qw);
+    const __m256 yy = _mm256_mul_ps(qy, qy), yz = _mm256_mul_ps(qy, qz);
+    const __m256 yw = _mm256_mul_ps(qy, qw);
+    const __m256 zz = _mm256_mul_ps(qz, qz), zw = _mm256_mul_ps(qz, qw);
+
+    // columns 0 to 3, rows x to z
+    f32 m[12][JointLanes];
+    _mm256_storeu_ps(m[0], _mm256_mul_ps(sx, _mm256_sub_ps(half, _mm256_add_ps(yy, zz))));
+    _mm256_storeu_ps(m[1], _mm256_mul_ps(sx, _mm256_add_ps(xy, zw)));
+    _mm256_storeu_ps(m[2], _mm256_mul_ps(sx, _mm256_sub_ps(xz, yw)));
+    _mm256_storeu_ps(m[3], _mm256_mul_ps(sy, _mm256_sub_ps(xy, zw)));
+    _mm256_storeu_ps(m[4], _mm256_mul_ps(sy, _mm256_sub_ps(half, _mm256_add_ps(xx, zz))));
+    _mm256_storeu_ps(m[5], _mm256_mul_ps(sy, _mm256_add_ps(xw, yz)));
+    _mm256_storeu_ps(m[6], _mm256_mul_ps(sz, _mm256_add_ps(xz, yw)));
+    _mm256_storeu_ps(m[7], _mm256_mul_ps(sz, _mm256_sub_ps(yz, xw)));
+    _mm256_storeu_ps(m[8], _mm256_mul_ps(sz, _mm256_sub_ps(half, _mm256_add_ps(xx, yy))));
+    _mm256_storeu_ps(m[9], tx);
+    _mm256_storeu_ps(m[10], ty);
+    _mm256_storeu_ps(m[11], tz);
+
+    for (u32 l = 0; l < laneCount; l++) {
+        out[l].col0 = float4(m[0][l], m[1][l], m[2][l], 0.f);
+        out[l].col1 = float4(m[3][l], m[4][l], m[5][l], 0.f);
+        out[l].col2 = float4(m[6][l], m[7][l], m[8][l], 0.f);
+        out[l].col3 = float4(m[9][l], m[10][l], m[11][l], 1.f);
+    }
+}
+
+// Blends 8 joints at a time with normalized lerp. Consecutive keys are stored on the same
+// hemisphere, so nlerp takes the short arc without checking the sign of each pair.
+void sampleClip_256(
+    float4x4* parentFromPosedJoint, const Clip& clip, const u32 jointCount,
+    const u32 f0, const f32 alpha) {
+    const JointBlock* frame0 = get_frame(clip, f0);
+    const JointBlock* frame1 = get_frame(clip, f0 + 1);
+    const __m256 alpha_256 = _mm256_set1_ps(alpha);
+    for (u32 b = 0; b < clip.blockCount; b++) {
+        const JointBlock& k0 = frame0[b];
+        const JointBlock& k1 = frame1[b];
+        auto blend = [&](const f32* v0, const f32* v1) {
+            const __m256 a = _mm256_loadu_ps(v0);
+            return _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(v1), a), alpha_256, a);
+        };
+        storeJointMatrices_256(
+            &parentFromPosedJoint[b * JointLanes],
+            math::min(jointCount - b * JointLanes, (u32)JointLanes),
+            blend(k0.tx, k1.tx), blend(k0.ty, k1.ty), blend(k0.tz, k1.tz),
+            blend(k0.qx, k1.qx), blend(k0.qy, k1.qy), blend(k0.qz, k1.qz), blend(k0.qw, k1.qw),
+            blend(k0.sx, k1.sx), blend(k0.sy, k1.sy), blend(k0.sz, k1.sz));
+    }
+}
+
+// Smallest-three quaternion: the index of the largest component in the top 2 bits, and the
+// other three, which must be within +-1/sqrt(2), in 15 bits each. The largest component is
+// made positive, so the decoded quaternion may be the negated input
+QuantizedKey encodeRotation(const float4& q) {
+    const f32 c[4] = { q.x, q.y, q.z, q.w };
+    u32 largest = 0;
+    for (u32 i = 1; i < 4; i++) {
+        if (math::abs(c[i]) > math::abs(c[largest])) { largest = i; }
+    }
+    const f32 sign = c[largest] < 0.f ? -1.f : 1.f;
+    u64 bits = largest;
+    for (u32 i = 0; i < 4; i++) {
+        if (i == largest) { continue; }
+        const f32 v = math::clamp(c[i] * sign * math::sqrt2_32 * 0.5f + 0.5f, 0.f, 1.f);
+        bits = (bits << 15) | (u64)math::round(v * 32767.f);
+    }
+    QuantizedKey key;
+    key.v[0] = (u16)bits; key.v[1] = (u16)(bits >> 16); key.v[2] = (u16)(bits >> 32);
+    return key;
+}
+float4 decodeRotation(const QuantizedKey& key) {
+    const u64 bits = (u64)key.v[0] | ((u64)key.v[1] << 16) | ((u64)key.v[2] << 32);
+    const u32 largest = (u32)(bits >> 45);
+    f32 c[4];
+    f32 lengthSq = 0.f;
+    for (u32 i = 0, shift = 30; i < 4; i++) {
+        if (i == largest) { continue; }
+        c[i] = (((bits >> shift) & 0x7fff) / 32767.f * 2.f - 1.f) * (1.f / math::sqrt2_32);
+        lengthSq += c[i] * c[i];
+        shift -= 15;
+    }
+    c[largest] = math::sqrt(math::max(1.f - lengthSq, 0.f));
+    return float4(c[0], c[1], c[2], c[3]);
+}
+QuantizedKey encodeRange(const float3& v, const float3& min, const float3& extent) {
+    QuantizedKey key;
+    const f32 c[3] = { v.x, v.y, v.z };
+    const f32 cmin[3] = { min.x, min.y, min.z };
+    const f32 cextent[3] = { extent.x, extent.y, extent.z };
+    for (u32 i = 0; i < 3; i++) {
+        const f32 u = cextent[i] > 0.f ? math::clamp((c[i] - cmin[i]) / cextent[i], 0.f, 1.f) : 0.f;
+        key.v[i] = (u16)math::round(u * 65535.f);
+    }
+    return key;
+}
+force_inline float3 decodeRange(const QuantizedKey& key, const float3& min, const float3& extent) {
+    return float3(
+        min.x + key.v[0] / 65535.f * extent.x,
+        min.y + key.v[1] / 65535.f * extent.y,
+        min.z + key.v[2] / 65535.f * extent.z);
+}
+// Interpolates a track at a fractional frame. Rotations come out unnormalized
+float4 decodeTrack(const CompressedClip& compressed, const Track& track,
+                   const TrackType::Enum type, const f32 frame) {
+    const u16* keyFrames = &compressed.keyFrames[track.firstKey];
+    const QuantizedKey* keys = &compressed.keys[track.firstKey];
+    u32 k = 0;
+    f32 alpha = 0.f;
+    if (track.keyCount > 1) {
+        // last key at or before the frame, keeping one key after it
+        u32 lo = 0, hi = track.keyCount - 1;
+        while (hi - lo > 1) {
+            const u32 mid = (lo + hi) / 2;
+            if (keyFrames[mid] <= frame) { lo = mid; } else { hi = mid; }
+        }
+        k = lo;
+        alpha = math::clamp(
+            (frame - keyFrames[k]) / (f32)(keyFrames[k + 1] - keyFrames[k]), 0.f, 1.f);
+    }
+    if (type == TrackType::Rotation) {
+        const float4 a = decodeRotation(keys[k]);
+        if (alpha == 0.f) { return a; }
+        float4 b = decodeRotation(keys[k + 1]);
+        if (math::quaternionDot(a, b) < 0.f) { b = float4(-b.x, -b.y, -b.z, -b.w); }
+        return float4(math::lerp(alpha, a.x, b.x), math::lerp(alpha, a.y, b.y),
+                      math::lerp(alpha, a.z, b.z), math::lerp(alpha, a.w, b.w));
+    } else {
+        const float3 a = decodeRange(keys[k], track.min, track.extent);
+        if (alpha == 0.f) { return float4(a.x, a.y, a.z, 0.f); }
+        const float3 b = decodeRange(keys[k + 1], track.min, track.extent);
+        const float3 v = math::lerp(alpha, a, b);
+        return float4(v.x, v.y, v.z, 0.f);
+    }
+}
+// Decodes the pose of up to 8 joints at a fractional frame into a block
+void decodeBlock(JointBlock& block, const Clip& clip, const u32 blockIndex,
+                 const u32 jointCount, const f32 frame) {
+    const CompressedClip& compressed = clip.compressed;
+    for (u32 l = 0; l < JointLanes; l++) {
+        const u32 jointIndex = blockIndex * JointLanes + l;
+        if (jointIndex >= jointCount) {
+            set_joint_lane(block, l, float3(0.f, 0.f, 0.f), float4(0.f, 0.f, 0.f, 1.f), float3(1.f, 1.f, 1.f));
+            continue;
+        }
+        const Track* tracks = &compressed.tracks[jointIndex * TrackType::Count];
+        const float4 t = decodeTrack(compressed, tracks[TrackType::Translation], TrackType::Translation, frame);
+        const float4 q = decodeTrack(compressed, tracks[TrackType::Rotation], TrackType::Rotation, frame);
+        const float4 s = decodeTrack(compressed, tracks[TrackType::Scale], TrackType::Scale, frame);
+        set_joint_lane(block, l, float3(t.x, t.y, t.z), q, float3(s.x, s.y, s.z));
+    }
+}
+// Moves a track's cursor to the segment that holds the frame, and decodes its two keys.
+// Searches from the cursor's key, or from the first key if the frame is behind it (the clip looped)
+void seekKeyCursor(
+    KeyCursorBlock& cursor, const CompressedClip& compressed, const u32 jointIndex,
+    const TrackType::Enum type, const f32 frame, const bool reset) {
+    const u32 l = jointIndex % JointLanes;
+    const Track& track = compressed.tracks[jointIndex * TrackType::Count + type];
+    const u16* keyFrames = &compressed.keyFrames[track.firstKey];
+    const QuantizedKey* keys = &compressed.keys[track.firstKey];
+    u32 k = reset || frame < keyFrames[cursor.key[type][l]] ? 0 : cursor.key[type][l];
+    while (k + 2 < track.keyCount && keyFrames[k + 1] <= frame) { k++; }
+    const u32 k1 = track.keyCount > 1 ? k + 1 : k;
+    cursor.key[type][l] = k;
+    cursor.start[type][l] = keyFrames[k];
+    cursor.end[type][l] = k1 != k ? keyFrames[k1] : FLT_MAX;
+    cursor.invLength[type][l] = k1 != k ? 1.f / (f32)(keyFrames[k1] - keyFrames[k]) : 0.f;
+    JointBlock& a = cursor.key0;
+    JointBlock& b = cursor.key1;
+    if (type == TrackType::Rotation) {
+        const float4 q0 = decodeRotation(keys[k]);
+        float4 q1 = decodeRotation(keys[k1]);
+        if (math::quaternionDot(q0, q1) < 0.f) { q1 = float4(-q1.x, -q1.y, -q1.z, -q1.w); }
+        a.qx[l] = q0.x; a.qy[l] = q0.y; a.qz[l] = q0.z; a.qw[l] = q0.w;
+        b.qx[l] = q1.x; b.qy[l] = q1.y; b.qz[l] = q1.z; b.qw[l] = q1.w;
+    } else {
+        const float3 v0 = decodeRange(keys[k], track.min, track.extent);
+        const float3 v1 = decodeRange(keys[k1], track.min, track.extent);
+        if (type == TrackType::Translation) {
+            a.tx[l] = v0.x; a.ty[l] = v0.y; a.tz[l] = v0.z;
+            b.tx[l] = v1.x; b.ty[l] = v1.y; b.tz[l] = v1.z;
+        } else {
+            a.sx[l] = v0.x; a.sy[l] = v0.y; a.sz[l] = v0.z;
+            b.sx[l] = v1.x; b.sy[l] = v1.y; b.sz[l] = v1.z;
+        }
+    }
+}
+// Samples a compressed clip through the key cursors (clip.blockCount of them), which must be
+// reset the first time they're used with a clip. Only the tracks whose segment doesn't hold the
+// frame get decoded, the rest is the same 8-wide blend as sampleClip_256, with an alpha per track
+void sampleCompressedClip_256(
+    float4x4* parentFromPosedJoint, const Clip& clip, const u32 jointCount,
+    const u32 f0, const f32 alpha, KeyCursorBlock* cursors, const bool resetCursors) {
+    const f32 frame = f0 + alpha;
+    const __m256 frame_256 = _mm256_set1_ps(frame);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    for (u32 b = 0; b < clip.blockCount; b++) {
+        KeyCursorBlock& cursor = cursors[b];
+        const u32 laneCount = math::min(jointCount - b * JointLanes, (u32)JointLanes);
+        if (resetCursors) {
+            for (u32 l = laneCount; l < JointLanes; l++) {
+                set_joint_lane(cursor.key0, l, float3(0.f, 0.f, 0.f), float4(0.f, 0.f, 0.f, 1.f), float3(1.f, 1.f, 1.f));
+                set_joint_lane(cursor.key1, l, float3(0.f, 0.f, 0.f), float4(0.f, 0.f, 0.f, 1.f), float3(1.f, 1.f, 1.f));
+                for (u32 type = 0; type < TrackType::Count; type++) {
+                    cursor.start[type][l] = 0.f;
+                    cursor.end[type][l] = FLT_MAX;
+                    cursor.invLength[type][l] = 0.f;
+                    cursor.key[type][l] = 0;
+                }
+            }
+        }
+        __m256 alphas[TrackType::Count];
+        for (u32 type = 0; type < TrackType::Count; type++) {
+            u32 seekMask = (1 << laneCount) - 1;
+            if (!resetCursors) {
+                const __m256 start = _mm256_loadu_ps(cursor.start[type]);
+                const __m256 end = _mm256_loadu_ps(cursor.end[type]);
+                seekMask &= (u32)_mm256_movemask_ps(_mm256_or_ps(
+                    _mm256_cmp_ps(frame_256, start, _CMP_LT_OQ), _mm256_cmp_ps(frame_256, end, _CMP_GT_OQ)));
+            }
+            for (u32 l = 0; seekMask; l++, seekMask >>= 1) {
+                if (!(seekMask & 1)) { continue; }
+                seekKeyCursor(
+                    cursor, clip.compressed, b * JointLanes + l, (TrackType::Enum)type, frame, resetCursors);
+            }
+            const __m256 t = _mm256_mul_ps(
+                _mm256_sub_ps(frame_256, _mm256_loadu_ps(cursor.start[type])),
+                _mm256_loadu_ps(cursor.invLength[type]));
+            alphas[type] = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+        }
+        const KeyCursorBlock& c = cursor;
+        auto blend = [&](const f32* v0, const f32* v1, const TrackType::Enum type) {
+            const __m256 a = _mm256_loadu_ps(v0);
+            return _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(v1), a), alphas[type], a);
+        };
+        const TrackType::Enum T = TrackType::Translation, R = TrackType::Rotation, S = TrackType::Scale;
+        storeJointMatrices_256(
+            &parentFromPosedJoint[b * JointLanes], laneCount,
+            blend(c.key0.tx, c.key1.tx, T), blend(c.key0.ty, c.key1.ty, T), blend(c.key0.tz, c.key1.tz, T),
+            blend(c.key0.qx, c.key1.qx, R), blend(c.key0.qy, c.key1.qy, R),
+            blend(c.key0.qz, c.key1.qz, R), blend(c.key0.qw, c.key1.qw, R),
+            blend(c.key0.sx, c.key1.sx, S), blend(c.key0.sy, c.key1.sy, S), blend(c.key0.sz, c.key1.sz, S));
+    }
 }
 
-void updateAnimation(Scene& scene, const f32 dt) {
+// Builds a compressed copy of an uncompressed clip. Keys are removed greedily: each track
+// extends the segment from its last key for as long as every frame in between is within the
+// error bound of the interpolated (quantized) endpoints
+void compressClip(
+    Clip& dst, const Clip& src, const u32 jointCount, const CompressionParams& params,
+    allocator::PagedArena& persistentArena, allocator::PagedArena scratchArena) {
+    const u32 frameCount = src.frameCount;
+    const u32 trackCount = jointCount * TrackType::Count;
+    Track* tracks = ALLOC_ARRAY(persistentArena, Track, trackCount);
+    u16* keyFrames = ALLOC_ARRAY(scratchArena, u16, trackCount * frameCount);
+    QuantizedKey* keys = ALLOC_ARRAY(scratchArena, QuantizedKey, trackCount * frameCount);
+    float4* values = ALLOC_ARRAY(scratchArena, float4, frameCount);
+    float4* decoded = ALLOC_ARRAY(scratchArena, float4, frameCount);
+    QuantizedKey* quantized = ALLOC_ARRAY(scratchArena, QuantizedKey, frameCount);
+    u32 keyCount = 0;
 
-    for (u32 n = 0, count = 0; n < scene.nodes.cap && count < scene.nodes.count; n++) {
-        if (scene.nodes.data[n].alive == 0) { continue; }
-        count++;
+    for (u32 jointIndex = 0; jointIndex < jointCount; jointIndex++) {
+        const u32 b = jointIndex / JointLanes, l = jointIndex % JointLanes;
+        for (u32 type = 0; type < TrackType::Count; type++) {
+            Track& track = tracks[jointIndex * TrackType::Count + type];
+            f32 maxError;
+            for (u32 f = 0; f < frameCount; f++) {
+                const JointBlock& block = get_frame(src, f)[b];
+                switch (type) {
+                case TrackType::Translation:
+                    values[f] = float4(block.tx[l], block.ty[l], block.tz[l], 0.f); break;
+                case TrackType::Rotation:
+                    values[f] = float4(block.qx[l], block.qy[l], block.qz[l], block.qw[l]); break;
+                case TrackType::Scale:
+                    values[f] = float4(block.sx[l], block.sy[l], block.sz[l], 0.f); break;
+                }
+            }
+            if (type == TrackType::Rotation) {
+                maxError = params.maxRotationError;
+                track.min = float3(0.f, 0.f, 0.f);
+                track.extent = float3(0.f, 0.f, 0.f);
+                for (u32 f = 0; f < frameCount; f++) {
+                    quantized[f] = encodeRotation(values[f]);
+                    decoded[f] = decodeRotation(quantized[f]);
+                }
+            } else {
+                maxError =
+                    type == TrackType::Translation ? params.maxTranslationError : params.maxScaleError;
+                float3 min = values[0].xyz, max = values[0].xyz;
+                for (u32 f = 1; f < frameCount; f++) {
+                    min = math::min(min, values[f].xyz);
+                    max = math::max(max, values[f].xyz);
+                }
+                track.min = min;
+                track.extent = math::subtract(max, min);
+                for (u32 f = 0; f < frameCount; f++) {
+                    quantized[f] = encodeRange(values[f].xyz, track.min, track.extent);
+                    const float3 v = decodeRange(quantized[f], track.min, track.extent);
+                    decoded[f] = float4(v.x, v.y, v.z, 0.f);
+                }
+            }
+            // largest component difference between a reconstructed value and the source,
+            // rotations are compared on the source's hemisphere and after normalization
+            auto error = [&](float4 v, const u32 f) {
+                if (type == TrackType::Rotation) {
+                    if (math::quaternionDot(v, values[f]) < 0.f) { v = float4(-v.x, -v.y, -v.z, -v.w); }
+                    const f32 invLength = 1.f / math::sqrt(math::quaternionDot(v, v));
+                    v = float4(v.x * invLength, v.y * invLength, v.z * invLength, v.w * invLength);
+                }
+                return math::max(
+                    math::max(math::abs(v.x - values[f].x), math::abs(v.y - values[f].y)),
+                    math::max(math::abs(v.z - values[f].z), math::abs(v.w - values[f].w)));
+            };
+            auto segmentFits = [&](const u32 f0, const u32 f1) {
+                const float4 a = decoded[f0];
+                float4 b = decoded[f1];
+                if (type == TrackType::Rotation && math::quaternionDot(a, b) < 0.f) {
+                    b = float4(-b.x, -b.y, -b.z, -b.w);
+                }
+                for (u32 f = f0 + 1; f < f1; f++) {
+                    const f32 alpha = (f - f0) / (f32)(f1 - f0);
+                    const float4 v(math::lerp(alpha, a.x, b.x), math::lerp(alpha, a.y, b.y),
+                                   math::lerp(alpha, a.z, b.z), math::lerp(alpha, a.w, b.w));
+                    if (error(v, f) > maxError) { return false; }
+                }
+                return true;
+            };
 
-        animation::Node& animatedData = scene.nodes.data[n].state.live;
+            track.firstKey = keyCount;
+            auto add_key = [&](const u32 f) {
+                keyFrames[keyCount] = (u16)f;
+                keys[keyCount++] = quantized[f];
+            };
+            bool constant = true;
+            for (u32 f = 0; f < frameCount && constant; f++) {
+                constant = error(decoded[0], f) <= maxError;
+            }
+            add_key(0);
+            if (!constant) {
+                u32 last = 0;
+                for (u32 f = 2; f < frameCount; f++) {
+                    if (!segmentFits(last, f)) { add_key(f - 1); last = f - 1; }
+                }
+                add_key(frameCount - 1);
+            }
+            track.keyCount = keyCount - track.firstKey;
+        }
+    }
+
+    dst.frames = nullptr;
+    dst.compressed.tracks = tracks;
+    dst.compressed.keyFrames = ALLOC_ARRAY(persistentArena, u16, keyCount);
+    dst.compressed.keys = ALLOC_ARRAY(persistentArena, QuantizedKey, keyCount);
+    memcpy(dst.compressed.keyFrames, keyFrames, keyCount * sizeof(u16));
+    memcpy(dst.compressed.keys, keys, keyCount * sizeof(QuantizedKey));
+    dst.compressed.keyCount = keyCount;
+    dst.blockCount = src.blockCount;
+    dst.frameCount = src.frameCount;
+    dst.timeEnd = src.timeEnd;
+}
+// Expands a compressed clip back into one block per frame
+void decompressClip(Clip& dst, const Clip& src, const u32 jointCount, allocator::PagedArena& arena) {
+    dst = src;
+    dst.frames = ALLOC_ARRAY(arena, JointBlock, src.frameCount * src.blockCount);
+    for (u32 f = 0; f < src.frameCount; f++) {
+        for (u32 b = 0; b < src.blockCount; b++) {
+            JointBlock& block = dst.frames[f * src.blockCount + b];
+            decodeBlock(block, src, b, jointCount, (f32)f);
+            if (f == 0) { continue; }
+            const JointBlock& prev = dst.frames[(f - 1) * src.blockCount + b];
+            for (u32 l = 0; l < JointLanes; l++) { // same hemisphere as the previous frame
+                const f32 dot = block.qx[l] * prev.qx[l] + block.qy[l] * prev.qy[l]
+                              + block.qz[l] * prev.qz[l] + block.qw[l] * prev.qw[l];
+                if (dot < 0.f) {
+                    block.qx[l] = -block.qx[l]; block.qy[l] = -block.qy[l];
+                    block.qz[l] = -block.qz[l]; block.qw[l] = -block.qw[l];
+                }
+            }
+        }
+    }
+}
+force_inline size_t get_clip_size(const Clip& clip, const u32 jointCount) {
+    if (clip.frames) { return clip.frameCount * clip.blockCount * sizeof(JointBlock); }
+    return jointCount * TrackType::Count * sizeof(Track)
+         + clip.compressed.keyCount * (sizeof(u16) + sizeof(QuantizedKey));
+}
+// Largest model space distance between the joints posed by two clips, sampled at every
+// frame and half frame
+f32 computeMaxJointError(
+    const Clip& clipA, const Clip& clipB, const Skeleton& skeleton,
+    allocator::PagedArena scratchArena) {
+    const u32 jointCount = skeleton.jointCount;
+    float4x4* parentFromJointA = ALLOC_ARRAY(scratchArena, float4x4, jointCount);
+    float4x4* parentFromJointB = ALLOC_ARRAY(scratchArena, float4x4, jointCount);
+    float4x4* rootFromJointA = ALLOC_ARRAY(scratchArena, float4x4, jointCount);
+    float4x4* rootFromJointB = ALLOC_ARRAY(scratchArena, float4x4, jointCount);
+    KeyCursorBlock* cursorsA = ALLOC_ARRAY(scratchArena, KeyCursorBlock, clipA.blockCount);
+    KeyCursorBlock* cursorsB = ALLOC_ARRAY(scratchArena, KeyCursorBlock, clipB.blockCount);
+    auto sample = [&](float4x4* out, const Clip& clip, KeyCursorBlock* cursors, const u32 f0, const f32 alpha) {
+        if (clip.frames) { sampleClip_256(out, clip, jointCount, f0, alpha); }
+        else { sampleCompressedClip_256(out, clip, jointCount, f0, alpha, cursors, f0 == 0 && alpha == 0.f); }
+    };
+    f32 maxError = 0.f;
+    for (u32 f = 0; f < clipA.frameCount - 1; f++) {
+        for (u32 h = 0; h < 2; h++) {
+            const f32 alpha = h * 0.5f;
+            sample(parentFromJointA, clipA, cursorsA, f, alpha);
+            sample(parentFromJointB, clipB, cursorsB, f, alpha);
+            for (u32 jointIndex = 0; jointIndex < jointCount; jointIndex++) {
+                const s8 parentIndex = skeleton.parentIndices[jointIndex];
+                if (parentIndex < 0) {
+                    rootFromJointA[jointIndex] = parentFromJointA[jointIndex];
+                    rootFromJointB[jointIndex] = parentFromJointB[jointIndex];
+                } else {
+                    rootFromJointA[jointIndex] =
+                        math::mult(rootFromJointA[parentIndex], parentFromJointA[jointIndex]);
+                    rootFromJointB[jointIndex] =
+                        math::mult(rootFromJointB[parentIndex], parentFromJointB[jointIndex]);
+                }
+                const float3 a = math::mult(skeleton.geometryFromRoot, rootFromJointA[jointIndex].col3).xyz;
+                const float3 b = math::mult(skeleton.geometryFromRoot, rootFromJointB[jointIndex].col3).xyz;
+                maxError = math::max(maxError, math::mag(math::subtract(a, b)));
+            }
+        }
+    }
+    return maxError;
+}
+
+// Returns the first of the two keyframes to blend at the given time, and how far along we are
+force_inline u32 get_keyframe(f32& alpha, const Clip& clip, const f32 time) {
+    const f32 frame = (time / clip.timeEnd) * (clip.frameCount - 1);
+    const u32 f0 = math::min((u32)frame, clip.frameCount - 2);
+    alpha = math::min(frame - f0, 1.f);
+    return f0;
+}
+
+// Poses a node at its current time, the intermediate joint matrices live in scratch memory,
+// since the skeleton is shared with every other node of the same asset
+void updatePose(Node& node, allocator::PagedArena scratchArena) {
+    State& state = node.state;
+    const Clip& clip = node.clips[state.animIndex];
+    const Skeleton& skeleton = node.skeleton;
+    float4x4* parentFromPosedJoint = ALLOC_ARRAY(scratchArena, float4x4, skeleton.jointCount);
+    float4x4* geometryFromPosedJoint = ALLOC_ARRAY(scratchArena, float4x4, skeleton.jointCount);
+
+    f32 alpha;
+    const u32 f0 = get_keyframe(alpha, clip, state.time);
+    if (clip.frames) {
+        sampleClip_256(parentFromPosedJoint, clip, skeleton.jointCount, f0, alpha);
+    } else {
+        const bool resetCursors = node.keyCursorClip != &clip;
+        node.keyCursorClip = &clip;
+        sampleCompressedClip_256(
+            parentFromPosedJoint, clip, skeleton.jointCount, f0, alpha, node.keyCursors, resetCursors);
+    }
+
+    geometryFromPosedJoint[0] = math::mult(skeleton.geometryFromRoot, parentFromPosedJoint[0]);
+    for (u32 jointIndex = 1; jointIndex < skeleton.jointCount; jointIndex++) {
+        s8 parentIndex = skeleton.parentIndices[jointIndex];
+        geometryFromPosedJoint[jointIndex] =
+            math::mult(geometryFromPosedJoint[parentIndex], parentFromPosedJoint[jointIndex]);
+    }
+    for (u32 jointIndex = 0; jointIndex < skeleton.jointCount; jointIndex++) {
+        state.skinning[jointIndex] =
+            math::mult(geometryFromPosedJoint[jointIndex], skeleton.jointFromGeometry[jointIndex]);
+    }
+
+    // skinned vertices are weighted averages of their joints' transforms, so they stay
+    // within the box around each of their joints' posed spheres
+    float3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+    float3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (u32 jointIndex = 0; jointIndex < skeleton.jointCount; jointIndex++) {
+        const float4& sphere = skeleton.jointBounds[jointIndex];
+        if (sphere.w < 0.f) { continue; }
+        const float4x4& m = geometryFromPosedJoint[jointIndex];
+        const float3 center = math::mult(m, float4(sphere.xyz, 1.f)).xyz;
+        const f32 scaleSq = math::max(
+            math::max(math::dot(m.col0.xyz, m.col0.xyz), math::dot(m.col1.xyz, m.col1.xyz)),
+            math::dot(m.col2.xyz, m.col2.xyz));
+        const f32 radius = sphere.w * math::sqrt(scaleSq);
+        boundsMin = math::min(boundsMin, math::subtract(center, float3(radius, radius, radius)));
+        boundsMax = math::max(boundsMax, math::add(center, float3(radius, radius, radius)));
+    }
+    if (boundsMin.x <= boundsMax.x) {
+        state.boundsMin = boundsMin;
+        state.boundsMax = boundsMax;
+    }
+}
+struct UpdatePoseTask {
+    Node** nodes;
+    u32 count;
+};
+void updatePoseTask(jobs::Context& jobCtx, void* data) {
+    __PROFILEONLY(profiler::start_zone("pose");)
+    UpdatePoseTask& task = *(UpdatePoseTask*)data;
+    for (u32 i = 0; i < task.count; i++) {
+        updatePose(*task.nodes[i], jobCtx.scratchArena);
+    }
+    __PROFILEONLY(profiler::end_zone();)
+}
+
+// Advances every node's clip time, and poses the nodes that are due this frame across jobs.
+// Posed nodes update their draw node's bounds
+void updateAnimation(
+    Scene& scene, renderer::Scene& renderScene, const f32 dt, allocator::PagedArena scratchArena) {
+
+    Node** nodes = ALLOC_ARRAY(scratchArena, Node*, scene.nodes.count);
+    u32 nodeCount = 0;
+    for (u32 n = 0; n < scene.nodes.count; n++) {
+        animation::Node& animatedData = scene.nodes.data[n];
         State& state = animatedData.state;
         const Clip& clip = animatedData.clips[state.animIndex];
-        const Skeleton& skeleton = animatedData.skeleton;
 
         state.time = state.time + dt * state.scale;
         if (state.time >= clip.timeEnd) {
             state.time -= clip.timeEnd;
         }
-        f32 t = state.time / clip.timeEnd;
-        u32 f0 = (u32)(t * (clip.frameCount - 1));
-        u32 f1 = f0 + 1;
-
-        for (u32 jointIndex = 0; jointIndex < skeleton.jointCount; jointIndex++) {
-
-            const animation::Joint_TRS& joint_to_parent0 = clip.joints[jointIndex].joint_to_parent_trs[f0];
-            const animation::Joint_TRS& joint_to_parent1 = clip.joints[jointIndex].joint_to_parent_trs[f1];
-            // note: this will likely always default to lerp, since the angle delta will likely be small
-            float4 q = math::quaternionSlerp(t, joint_to_parent0.rotation, joint_to_parent1.rotation);
-            float3 translation = math::lerp(t, joint_to_parent0.translation, joint_to_parent1.translation);
-            float3 scale = math::lerp(t, joint_to_parent0.scale, joint_to_parent1.scale);
-            skeleton.parentFromPosedJoint[jointIndex] = math::trsToMatrix(translation, q, scale);
+        // nodes with the same interval are staggered by their index, to spread the cost
+        const u32 interval = scene.lod.enabled ? state.updateInterval : 1;
+        if (interval && (scene.frameIndex + n) % interval == 0) { nodes[nodeCount++] = &animatedData; }
+    }
+    scene.frameIndex++;
+    scene.evaluatedCount = nodeCount;
+    if (!nodeCount) { return; }
+
+    // a few jobs per worker, so that nodes with bigger skeletons can be balanced by stealing
+    const u32 maxJobs = jobs::pool.workerCount * 4;
+    const u32 nodesPerJob = (nodeCount + maxJobs - 1) / maxJobs;
+    const u32 jobCount = (nodeCount + nodesPerJob - 1) / nodesPerJob;
+    UpdatePoseTask* tasks = ALLOC_ARRAY(scratchArena, UpdatePoseTask, jobCount);
+    jobs::Counter counter = {};
+    for (u32 j = 0; j < jobCount; j++) {
+        UpdatePoseTask& task = tasks[j];
+        task.nodes = &nodes[j * nodesPerJob];
+        task.count = math::min(nodesPerJob, nodeCount - j * nodesPerJob);
+        jobs::push(counter, updatePoseTask, &task, scratchArena);
+    }
+    jobs::wait(counter, scratchArena);
+
+    // culling follows the posed bounds, the cull tree isn't thread safe so this runs after the jobs
+    for (u32 i = 0; i < nodeCount; i++) {
+        const Node& node = *nodes[i];
+        if (!node.drawHandle) { continue; }
+        renderer::DrawNode& drawNode = renderer::node_from_handle(renderScene, node.drawHandle);
+        drawNode.min = node.state.boundsMin;
+        drawNode.max = node.state.boundsMax;
+        renderer::updateCullNode(renderScene, node.drawHandle);
+    }
+}
+
+// Picks each node's update interval for the next frame, from whether its draw node was visible
+// in any camera this frame, and its distance to the main camera
+void updateLOD(
+    Scene& scene, const u32* isEachNodeVisible, renderer::Scene& renderScene,
+    const float3& cameraPos) {
+    const LODParams& lod = scene.lod;
+    for (u32 n = 0; n < scene.nodes.count; n++) {
+        animation::Node& animatedData = scene.nodes.data[n];
+        State& state = animatedData.state;
+        if (!animatedData.drawHandle) { state.updateInterval = 1; continue; }
+        if (!isEachNodeVisible[animatedData.drawHandle - 1]) { state.updateInterval = 0; continue; }
+        const renderer::DrawNode& drawNode =
+            renderer::node_from_handle(renderScene, animatedData.drawHandle);
+        const f32 distance =
+            math::mag(math::subtract(drawNode.nodeData.worldMatrix.col3.xyz, cameraPos));
+        if (distance <= lod.fullRateDistance) { state.updateInterval = 1; continue; }
+        const f32 t = math::clamp(
+            (distance - lod.fullRateDistance) / (lod.minRateDistance - lod.fullRateDistance),
+            0.f, 1.f);
+        state.updateInterval =
+            math::max(2u, 2 + (u32)math::round(t * (math::max(lod.maxInterval, 2u) - 2)));
+    }
+}
+
+#if __DEBUG
+// Samples every live node's current clip at random times with both samplers, and reports
+// their cost and the largest difference between the resulting joint matrices
+void benchmarkSampling(const Scene& scene, allocator::PagedArena scratchArena) {
+    const u32 sampleCount = 1024;
+    for (u32 n = 0; n < scene.nodes.count; n++) {
+        allocator::PagedArena arena = scratchArena; // explicit copy
+        const animation::Node& animatedData = scene.nodes.data[n];
+        const u32 jointCount = animatedData.skeleton.jointCount;
+        const Clip& runtimeClip = animatedData.clips[animatedData.state.animIndex];
+        Clip clip = runtimeClip; // uncompressed clip, to compare the samplers on the same keys
+        if (!clip.frames) { decompressClip(clip, runtimeClip, jointCount, arena); }
+        f32* times = ALLOC_ARRAY(arena, f32, sampleCount);
+        float4x4* poseRef = ALLOC_ARRAY(arena, float4x4, jointCount * sampleCount);
+        float4x4* pose256 = ALLOC_ARRAY(arena, float4x4, jointCount * sampleCount);
+        for (u32 i = 0; i < sampleCount; i++) { times[i] = math::rand() * clip.timeEnd; }
+
+        u64 start = __rdtsc();
+        for (u32 i = 0; i < sampleCount; i++) {
+            f32 alpha;
+            const u32 f0 = get_keyframe(alpha, clip, times[i]);
+            sampleClip(&poseRef[i * jointCount], clip, jointCount, f0, alpha);
         }
+        const u64 cyclesRef = __rdtsc() - start;
+        start = __rdtsc();
+        for (u32 i = 0; i < sampleCount; i++) {
+            f32 alpha;
+            const u32 f0 = get_keyframe(alpha, clip, times[i]);
+            sampleClip_256(&pose256[i * jointCount], clip, jointCount, f0, alpha);
+        }
+        const u64 cycles256 = __rdtsc() - start;
 
-        skeleton.geometryFromPosedJoint[0] =
-            math::mult(skeleton.geometryFromRoot, skeleton.parentFromPosedJoint[0]);
-        for (u32 jointIndex = 1; jointIndex < skeleton.jointCount; jointIndex++) {
-            s8 parentIndex = skeleton.parentIndices[jointIndex];
-            skeleton.geometryFromPosedJoint[jointIndex] =
-                math::mult(
-                    skeleton.geometryFromPosedJoint[parentIndex],
-                    skeleton.parentFromPosedJoint[jointIndex]);
+        f32 maxError = 0.f;
+        for (u32 i = 0; i < jointCount * sampleCount; i++) {
+            const f32* a = &poseRef[i].col0.x;
+            const f32* b = &pose256[i].col0.x;
+            for (u32 e = 0; e < 16; e++) { maxError = math::max(maxError, math::abs(a[e] - b[e])); }
         }
-        for (u32 jointIndex = 0; jointIndex < skeleton.jointCount; jointIndex++) {
-            animatedData.state.skinning[jointIndex] =
-                math::mult(
-                    skeleton.geometryFromPosedJoint[jointIndex],
-                    skeleton.jointFromGeometry[jointIndex]);
+        io::debuglog(
+            "anim sampling %d joints x %d samples: slerp %.3f Mcycles, nlerp_256 %.3f Mcycles "
+            "(%.2fx), max error %.6f\n",
+            jointCount, sampleCount, cyclesRef / 1000000.f, cycles256 / 1000000.f,
+            cyclesRef / (f32)cycles256, maxError);
+
+        if (!runtimeClip.frames) {
+            // random times make the cursors search their tracks again on most samples, playback
+            // times (every 60th of a second, as updateAnimation would) mostly reuse their keys
+            KeyCursorBlock* cursors = ALLOC_ARRAY(arena, KeyCursorBlock, runtimeClip.blockCount);
+            f32* playbackTimes = ALLOC_ARRAY(arena, f32, sampleCount);
+            for (u32 i = 0; i < sampleCount; i++) {
+                playbackTimes[i] = math::mod(i / 60.f, clip.timeEnd);
+            }
+            float4x4* poseCompressed = ALLOC_ARRAY(arena, float4x4, jointCount * sampleCount);
+            auto sampleAll = [&](const f32* sampleTimes, const bool compressed) {
+                const u64 start = __rdtsc();
+                for (u32 i = 0; i < sampleCount; i++) {
+                    f32 alpha;
+                    const u32 f0 = get_keyframe(alpha, clip, sampleTimes[i]);
+                    if (compressed) {
+                        sampleCompressedClip_256(
+                            &poseCompressed[i * jointCount], runtimeClip, jointCount, f0, alpha,
+                            cursors, i == 0);
+                    } else {
+                        sampleClip_256(&pose256[i * jointCount], clip, jointCount, f0, alpha);
+                    }
+                }
+                return __rdtsc() - start;
+            };
+            auto maxPoseError = [&]() {
+                f32 error = 0.f;
+                for (u32 i = 0; i < jointCount * sampleCount; i++) {
+                    const f32* a = &poseCompressed[i].col0.x;
+                    const f32* b = &pose256[i].col0.x;
+                    for (u32 e = 0; e < 16; e++) { error = math::max(error, math::abs(a[e] - b[e])); }
+                }
+                return error;
+            };
+            sampleAll(times, false);
+            const u64 cyclesRandom = sampleAll(times, true);
+            f32 maxCompressedError = maxPoseError();
+            const u64 cyclesPlayback256 = sampleAll(playbackTimes, false);
+            const u64 cyclesPlayback = sampleAll(playbackTimes, true);
+            maxCompressedError = math::max(maxCompressedError, maxPoseError());
+            io::debuglog(
+                "    compressed: random times %.3f Mcycles (%.2fx nlerp_256), playback %.3f Mcycles "
+                "(%.2fx nlerp_256 at %.3f), max error %.6f against the decompressed clip, "
+                "%d keys, %.1fKB -> %.1fKB\n",
+                cyclesRandom / 1000000.f, cycles256 / (f32)cyclesRandom,
+                cyclesPlayback / 1000000.f, cyclesPlayback256 / (f32)cyclesPlayback,
+                cyclesPlayback256 / 1000000.f, maxCompressedError,
+                runtimeClip.compressed.keyCount,
+                get_clip_size(clip, jointCount) / 1024.f,
+                get_clip_size(runtimeClip, jointCount) / 1024.f);
         }
     }
 }
+#endif
 }
 
 #endif // __WASTELADNS_ANIMATION_H__
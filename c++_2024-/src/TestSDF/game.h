@@ -9,10 +9,10 @@ const size_t scratchArenaSize = 4 * 1024 * 1024;
 #if __DEBUG
 struct CameraNode;
 namespace debug {
-struct DebugMenus { enum Enum { Main, Arenas, Count }; };
+struct DebugMenus { enum Enum { Main, Arenas, Profiler, Count }; };
 struct VisualizationModes { enum Enum { Physics, Culling, BVH, Count }; };
 bool visualizationModes[VisualizationModes::Count] = {};
-bool debugMenus[DebugMenus::Count] = { true, false };
+bool debugMenus[DebugMenus::Count] = { true, false, false };
 struct EventText { char text[256]; f64 time; };
 
 f64 frameHistory[60];
@@ -25,6 +25,7 @@ EventText eventLabel = {};
 bool capture_cameras_next_frame = false;
 im::Pane debugPane;
 im::Pane arenasPane;
+im::Pane profilerPane;
 
 }
 #endif
@@ -32,7 +33,7 @@ im::Pane arenasPane;
 #include "gameplay.h"
 #if __DX11
 #include "shader_src_dx11/shader_output_dx11.h"
-#elif __GL33
+#elif __GL33 || __NULLRHI
 #include "shader_src_gl33/shader_output_gl33.h"
 #endif // __GL33
 #include "renderer.h"
@@ -77,11 +78,13 @@ namespace input
 struct Memory {
     allocator::PagedArena persistentArena;
     allocator::PagedArena sceneArena;
+    allocator::PagedArena sceneArenaNext; // the next room gets built here, see RoomStreaming
     __DEBUGDEF(allocator::PagedArena debugArena;)
     allocator::PagedArena scratchArenaRoot; // to be passed by copy, so it works as a scoped stack allocator
     allocator::PagedArena frameArena;
     u8* frameArenaBuffer; // used to reset allocator::frameArena every frame
     u8* sceneArenaBuffer; // used to reset allocator::sceneArena upon scene switches
+    u8* sceneArenaNextBuffer;
     // used for debugging visualization
     __DEBUGDEF(u8* persistentArenaBuffer;)
     // to track largest allocation
@@ -89,14 +92,76 @@ struct Memory {
     __DEBUGDEF(uintptr_t frameArenaHighmark;)
 };
 
+// Rooms get built on a background worker, into their own scene arena, while the current one keeps
+// running. Once the build is done, the scenes and their arenas are swapped at the start of a frame,
+// and the old arena is released for the next build
+struct RoomStreaming {
+    Scene scene;
+    BuildRoomTask task;
+    jobs::Counter counter;
+    u32 roomId;
+    bool building;
+    // swap frame cost
+    f64 lastSwapMs;
+    f64 maxSwapMs;
+    u32 swapCount;
+};
+
 struct Instance {
     Time time;
     Memory memory;
     Scene scene;
     u32 roomId;
+    RoomStreaming streaming;
     Resources resources;
 };
 
+// Starts building a room in the background, it replaces the current scene once it's ready
+// Returns false if another room is still being built
+bool request_room(Instance& game, const u32 roomId) {
+    RoomStreaming& streaming = game.streaming;
+    if (streaming.building) { return false; }
+    assert(roomId < countof(roomDefinitions));
+    streaming.roomId = roomId;
+    streaming.building = true;
+    streaming.task = {
+        &streaming.scene, &game.memory.sceneArenaNext, &game.resources,
+        platform::state.screen, &roomDefinitions[roomId] };
+    jobs::push_background(streaming.counter, buildRoomTask, &streaming.task);
+    return true;
+}
+// Swaps a finished room in, only the cbuffer creation is left for this frame
+void swap_room(Instance& game) {
+    RoomStreaming& streaming = game.streaming;
+    if (!streaming.building || atomic::load(&streaming.counter.pending) != 0) { return; }
+    __PROFILEONLY(profiler::start_zone("room swap");)
+    const f64 start = platform::time_seconds();
+    renderer::create_pending_cbuffers(streaming.scene.renderScene);
+    renderer::release_cbuffers(game.scene.renderScene);
+    game.scene = streaming.scene;
+    game.roomId = streaming.roomId;
+    // the old scene's arena becomes the back arena, cleared for the next build
+    Memory& memory = game.memory;
+    allocator::PagedArena arena = memory.sceneArena;
+    u8* buffer = memory.sceneArenaBuffer;
+    memory.sceneArena = memory.sceneArenaNext;
+    memory.sceneArenaBuffer = memory.sceneArenaNextBuffer;
+    memory.sceneArenaNext = arena;
+    memory.sceneArenaNextBuffer = buffer;
+    memory.sceneArenaNext.curr = memory.sceneArenaNextBuffer;
+    streaming.building = false;
+    streaming.lastSwapMs = (platform::time_seconds() - start) * 1000.;
+    streaming.maxSwapMs = math::max(streaming.maxSwapMs, streaming.lastSwapMs);
+    streaming.swapCount++;
+    __PROFILEONLY(profiler::end_zone();)
+    #if __DEBUG
+    io::format(
+        debug::eventLabel.text, sizeof(debug::eventLabel.text),
+        "Room %d swapped in, %.3fms", game.roomId, streaming.lastSwapMs);
+    debug::eventLabel.time = platform::state.time.now;
+    #endif
+}
+
 void loadLaunchConfig(platform::LaunchConfig& config) {
     // hardcoded for now
     config.window_width = 320 * 3;
@@ -116,11 +181,15 @@ void start(Instance& game, platform::GameConfig& config) {
     config = {};
     config.nextFrame = platform::state.time.now;
 
+    jobs::init((u32)platform::core_count(), scratchArenaSize);
+    __PROFILEONLY(profiler::init();)
     {
         allocator::init_arena(game.memory.persistentArena, persistentArenaSize);
         __DEBUGDEF(game.memory.persistentArenaBuffer = game.memory.persistentArena.curr;)
         allocator::init_arena(game.memory.sceneArena, sceneArenaSize);
         game.memory.sceneArenaBuffer = game.memory.sceneArena.curr;
+        allocator::init_arena(game.memory.sceneArenaNext, sceneArenaSize);
+        game.memory.sceneArenaNextBuffer = game.memory.sceneArenaNext.curr;
         allocator::init_arena(game.memory.scratchArenaRoot, scratchArenaSize);
         __DEBUGDEF(
             game.memory.scratchArenaHighmark =
@@ -133,10 +202,20 @@ void start(Instance& game, platform::GameConfig& config) {
                 (uintptr_t)game.memory.frameArena.curr;
             game.memory.frameArena.highmark = &game.memory.frameArenaHighmark;)
         __DEBUGDEF(allocator::init_arena(game.memory.debugArena, im::arena_size);)
+        #if __ARENA_TRACKING
+        // both scene arenas are sized by sceneArenaSize, and swap with every room
+        allocator::track_arena("persistent", game.memory.persistentArena);
+        allocator::track_arena("scene", game.memory.sceneArena);
+        allocator::track_arena("scene", game.memory.sceneArenaNext);
+        allocator::track_arena("scratch", game.memory.scratchArenaRoot);
+        allocator::track_arena("frame", game.memory.frameArena);
+        __DEBUGDEF(allocator::track_arena("debug", game.memory.debugArena);)
+        #endif
     }
     {
         game.scene = {};
         game.roomId = 0;
+        game.streaming = {};
         SceneMemory arenas = {
               game.memory.persistentArena
             , game.memory.scratchArenaRoot
@@ -147,7 +226,7 @@ void start(Instance& game, platform::GameConfig& config) {
             game.scene, game.memory.sceneArena, game.memory.scratchArenaRoot,
             game.resources, platform::state.screen,
             roomDefinitions[game.roomId]);
-
+        renderer::create_pending_cbuffers(game.scene.renderScene);
     }
 
 #if __DEBUG
@@ -159,11 +238,21 @@ void start(Instance& game, platform::GameConfig& config) {
     im::make_pane(
         debug::arenasPane, "ARENAS MENU",
         float2(0.f, game.resources.renderCore.windowProjection.config.top - im::ui.scale * 35));
+    im::make_pane(
+        debug::profilerPane, "PROFILER MENU",
+        float2(game.resources.renderCore.windowProjection.config.right - im::ui.scale * 250,
+               game.resources.renderCore.windowProjection.config.top - im::ui.scale * 35));
 #endif
 }
 
 void update(Instance& game, platform::GameConfig& config) {
 
+    __PROFILEONLY(profiler::start_zone("update");)
+
+    #if __ARENA_TRACKING
+    allocator::end_tracking_frame();
+    #endif
+
     // frame arena reset
     game.memory.frameArena.curr = game.memory.frameArenaBuffer;
 
@@ -195,7 +284,6 @@ void update(Instance& game, platform::GameConfig& config) {
 
     // meta input checks
     const ::input::keyboard::State& keyboard = platform::state.input.keyboard;
-    const u32 prevRoomId = game.roomId;
     bool step = true;
     __DEBUGDEF(bool captureCameras = debug::capture_cameras_next_frame; debug::capture_cameras_next_frame = false;)
     {
@@ -213,14 +301,7 @@ void update(Instance& game, platform::GameConfig& config) {
         #endif
     }
 
-    if (prevRoomId != game.roomId) {
-        game.memory.sceneArena.curr = game.memory.sceneArenaBuffer;
-        game.scene = {};
-        spawn_scene_mirrorRoom(
-            game.scene, game.memory.sceneArena, game.memory.scratchArenaRoot,
-            game.resources, platform::state.screen,
-            roomDefinitions[game.roomId]);
-    }
+    swap_room(game);
 
     if (step)
     {
@@ -230,6 +311,7 @@ void update(Instance& game, platform::GameConfig& config) {
 
         // player movement update
         {
+            __PROFILEONLY(profiler::start_zone("player");)
             game::MovementInput controlpad = game.scene.player.control, controlkeyboard = game.scene.player.control;
             game::movementInputFromKeys(controlpad, keyboard, { input::UP, input::DOWN, input::LEFT, input::RIGHT });
             game::movementInputFromPad(controlkeyboard, platform::state.input.pads[0]);
@@ -335,6 +417,7 @@ void update(Instance& game, platform::GameConfig& config) {
             // update player render
             renderer::NodeData& nodeData = renderer::node_from_handle(game.scene.renderScene, game.scene.playerDrawNodeHandle).nodeData;
             nodeData.worldMatrix = game.scene.player.transform.matrix;
+            renderer::updateCullNode(game.scene.renderScene, game.scene.playerDrawNodeHandle);
 
             { // animation hack
                 animation::Node& animatedData = animation::get_node(game.scene.animScene, game.scene.playerAnimatedNodeHandle);
@@ -428,34 +511,50 @@ void update(Instance& game, platform::GameConfig& config) {
                     instance_matrices->data[i] = t.matrix;
                 }
             }
+            __PROFILEONLY(profiler::end_zone();)
         }
 
         // physics update
         if (game.scene.instancedNodesHandles[Scene::InstancedTypes::PhysicsBalls])
         {
+            __PROFILEONLY(profiler::start_zone("physics");)
             physics::updatePositionFromHandle(
                 game.scene.physicsScene,
                 game.scene.playerPhysicsNodeHandle,
                 game.scene.player.transform.pos, (f32)game.time.lastFrameDelta);
 
-            physics::updatePhysics(game.scene.physicsScene, dt);
+            physics::updatePhysics(game.scene.physicsScene, dt, game.memory.frameArena);
 
-            // update draw positions
+            // update draw positions, interpolated between the last two substeps
             renderer::Matrices64* instance_matrices; u32* instance_count;
             renderer::instanced_node_from_handle(instance_matrices, instance_count, game.scene.renderScene, game.scene.instancedNodesHandles[Scene::InstancedTypes::PhysicsBalls]);
             for (u32 i = 0; i < *instance_count; i++) {
                 float4x4& m = instance_matrices->data[i];
-                m.col3.xyz = game.scene.physicsScene.balls[i].pos;
+                m.col3.xyz = physics::get_ball_render_pos(game.scene.physicsScene, i);
                 m.col0.x = game.scene.physicsScene.balls[i].radius;
                 m.col1.y = game.scene.physicsScene.balls[i].radius;
                 m.col2.z = game.scene.physicsScene.balls[i].radius;
             }
+            __PROFILEONLY(profiler::end_zone();)
         }
 
         // anim update
         {
+            __PROFILEONLY(profiler::start_zone("animation");)
             animation::Scene& animScene = game.scene.animScene;
-            animation::updateAnimation(animScene, dt);
+            animation::updateAnimation(
+                animScene, game.scene.renderScene, dt, game.memory.scratchArenaRoot);
+            __PROFILEONLY(profiler::end_zone();)
+        }
+
+        // mirror update
+        if (game.scene.mirrors.vertices)
+        {
+            __PROFILEONLY(profiler::start_zone("mirrors");)
+            game::update_moving_mirrors(
+                game.scene.mirrors, game.resources, game.memory.sceneArena,
+                game.memory.scratchArenaRoot, dt);
+            __PROFILEONLY(profiler::end_zone();)
         }
 
         // camera update
@@ -478,6 +577,7 @@ void update(Instance& game, platform::GameConfig& config) {
     Camera mainCamera = {};
     if (!game.time.pausedRender)
     {
+        __PROFILEONLY(profiler::start_zone("render");)
         renderer::Scene& scene = game.scene.renderScene;
         renderer::CoreResources& renderCore = game.resources.renderCore;
         using namespace renderer;
@@ -502,12 +602,11 @@ void update(Instance& game, platform::GameConfig& config) {
         
             renderer::VisibleNodes* visibleNodesTree = nullptr;
             {
-                allocator::PagedArena scratchArena = game.memory.scratchArenaRoot;
-
                 // gather mirrors
                 u32 numCameras = 0;
                 {
-                    allocator::Buffer<CameraNode> cameraTreeBuffer;
+                    __PROFILEONLY(profiler::start_zone("mirror gather");)
+                    allocator::Buffer<CameraNode> cameraTreeBuffer = {};
                     CameraNode mainCameraRoot = {};
                     // Initialize main camera in our camera tree format
                     mainCameraRoot.viewMatrix = mainCamera.viewMatrix;
@@ -520,16 +619,12 @@ void update(Instance& game, platform::GameConfig& config) {
                     gfx::extract_frustum_planes_from_vp(
                         mainCameraRoot.frustum.planes, mainCamera.vpMatrix);
                     mainCameraRoot.frustum.numPlanes = 6;
-                    // the buffer will copy this data into it's allocated region as
-                    // it starts adding more cameras
-                    cameraTreeBuffer.data = &mainCameraRoot;
-                    cameraTreeBuffer.cap = cameraTreeBuffer.len = 1;
                     GatherMirrorTreeContext gatherTreeContext =
                     { game.memory.frameArena, game.memory.scratchArenaRoot,
-                      cameraTreeBuffer, game.scene.mirrors, game.scene.maxMirrorBounces };
-                    numCameras = gatherMirrorTreeRecursive(gatherTreeContext, 1, mainCameraRoot);
+                      cameraTreeBuffer, game.scene.mirrors, game.scene.maxMirrorBounces, 0 };
+                    numCameras = gatherMirrorTree(gatherTreeContext, mainCameraRoot);
                     cameraTree = cameraTreeBuffer.data;
-                    cameraTree[0].siblingIndex = numCameras;
+                    __PROFILEONLY(profiler::end_zone();)
                 }
 
                 #if __DEBUG
@@ -542,43 +637,48 @@ void update(Instance& game, platform::GameConfig& config) {
                 #endif
 
                 // figure out which nodes are visible among all of the visibility lists
+                __PROFILEONLY(profiler::start_zone("culling");)
                 u32* isEachNodeVisible =
-                    ALLOC_ARRAY(game.memory.frameArena, u32, scene.drawNodes.count);
-                memset(isEachNodeVisible, 0, scene.drawNodes.count * sizeof(bool));
+                    ALLOC_ARRAY(game.memory.frameArena, u32, scene.drawNodes.cap);
+                memset(isEachNodeVisible, 0, scene.drawNodes.cap * sizeof(u32));
                 visibleNodesTree = // todo: in function??
                     ALLOC_ARRAY(game.memory.frameArena, VisibleNodes, numCameras);
                 visibleNodesTree[0].visible_nodes =
                     ALLOC_ARRAY(game.memory.frameArena, u32, scene.drawNodes.count);
                 visibleNodesTree[0].visible_nodes_count = 0;
-                renderer::CullEntries cullEntries = {};
-                allocCullEntries(scratchArena, cullEntries, scene);
                 renderer::computeVisibilityCS(
                     visibleNodesTree[0], isEachNodeVisible, mainCamera.vpMatrix, scene);
                 for (u32 i = 1; i < numCameras; i++) {
                     renderer::computeVisibilityWS(
                         game.memory.frameArena, visibleNodesTree[i], isEachNodeVisible,
-                        cameraTree[i].frustum, cullEntries);
+                        cameraTree[i].frustum, scene.cullTree);
                 }
+                __PROFILEONLY(profiler::end_zone();)
+                // animated nodes pick next frame's update rate from what was visible in this one
+                animation::updateLOD(game.scene.animScene, isEachNodeVisible, scene, mainCamera.pos);
                 
-                // update cbuffers of all visible nodes
-                for (u32 n = 0, count = 0; n < scene.drawNodes.cap && count < scene.drawNodes.count; n++) {
-                    if (scene.drawNodes.data[n].alive == 0) { continue; }
-                    count++;
-                    if (!isEachNodeVisible[n]) { continue; }
-                    const DrawNode& node = scene.drawNodes.data[n].state.live;
-                    gfx::rhi::update_cbuffer(
-                            cbuffer_from_handle(scene, node.cbuffer_node),
-                            &node.nodeData);
-                    if (node.cbuffer_ext) {
+                // update cbuffers of all visible nodes, from the visibility lists rather than the
+                // whole pool. Nodes can be in several lists, so each one's visibility flag is cleared
+                // once it's uploaded (nothing reads the flags after this)
+                for (u32 i = 0; i < numCameras; i++) {
+                    const VisibleNodes& visibleNodes = visibleNodesTree[i];
+                    for (u32 v = 0; v < visibleNodes.visible_nodes_count; v++) {
+                        const u32 n = visibleNodes.visible_nodes[v];
+                        if (!isEachNodeVisible[n]) { continue; }
+                        isEachNodeVisible[n] = false;
+                        const DrawNode& node = scene.drawNodes.data[n].state.live;
                         gfx::rhi::update_cbuffer(
-                                cbuffer_from_handle(scene, node.cbuffer_ext),
-                                node.ext_data);
+                                cbuffer_from_handle(scene, node.cbuffer_node),
+                                &node.nodeData);
+                        if (node.cbuffer_ext) {
+                            gfx::rhi::update_cbuffer(
+                                    cbuffer_from_handle(scene, node.cbuffer_ext),
+                                    node.ext_data);
+                        }
                     }
                 }
-                for (u32 n = 0, count = 0; n < scene.instancedDrawNodes.cap && count < scene.instancedDrawNodes.count; n++) {
-                    if (scene.instancedDrawNodes.data[n].alive == 0) { continue; }
-                    count++;
-                    const DrawNodeInstanced& node = scene.instancedDrawNodes.data[n].state.live;
+                for (u32 n = 0; n < scene.instancedDrawNodes.count; n++) {
+                    const DrawNodeInstanced& node = scene.instancedDrawNodes.data[n];
                     gfx::rhi::update_cbuffer(
                             cbuffer_from_handle(scene, node.cbuffer_node),
                             &node.nodeData);
@@ -616,9 +716,11 @@ void update(Instance& game, platform::GameConfig& config) {
                         game.memory.scratchArenaRoot);
             }
         }
+        __PROFILEONLY(profiler::end_zone();)
     }
     {
         #if __DEBUG
+        __PROFILEONLY(profiler::start_zone("debug ui");)
 
         renderer::Scene& scene = game.scene.renderScene;
 
@@ -634,7 +736,7 @@ void update(Instance& game, platform::GameConfig& config) {
                 if (bvh.nodeCount > 0) {
 
                     struct DrawNode {
-                        u16 nodeid;
+                        bvh::Index nodeid;
                         u16 depth;
                     };
                     DrawNode* nodeStack = ALLOC_ARRAY(scratchArena, DrawNode, bvh.nodeCount);
@@ -660,7 +762,7 @@ void update(Instance& game, platform::GameConfig& config) {
                             nodeStack[stackCount++] =
                                 DrawNode{ node.lchildId, u16(n.depth + 1u) };
                             nodeStack[stackCount++] =
-                                DrawNode{ u16(node.lchildId + 1u), u16(n.depth + 1u) };
+                                DrawNode{ bvh::Index(node.lchildId + 1u), u16(n.depth + 1u) };
                         }
                     }
 
@@ -784,11 +886,9 @@ void update(Instance& game, platform::GameConfig& config) {
                         im::poly2d(polyScreen, poly_count, Color32(1.f, 1.f, 1.f, 0.3f));
 
                         // render culled nodes
-                        renderer::CullEntries cullEntries = {};
-                        allocCullEntries(scratchArena, cullEntries, scene);
                         renderer::computeVisibilityWS(
                             scratchArena, visibleNodesDebug, isEachNodeVisible,
-                            cameraNode.frustum, cullEntries);
+                            cameraNode.frustum, scene.cullTree);
                         const Color32 color(0.25f, 0.8f, 0.15f, 0.7f);
                         im::frustum(cameraNode.frustum.planes, cameraNode.frustum.numPlanes, color);
                     }
@@ -869,13 +969,65 @@ void update(Instance& game, platform::GameConfig& config) {
                             "Pause scene render: %s", game.time.pausedRender ? "true" : "false");
                         debug::eventLabel.time = platform::state.time.now;
                     }
+                    if (im::button("Benchmark sort keys")) {
+                        renderer::benchmarkSortKeys(game.memory.scratchArenaRoot);
+                    }
+                    if (im::button("Benchmark animation sampling")) {
+                        animation::benchmarkSampling(
+                            game.scene.animScene, game.memory.scratchArenaRoot);
+                    }
+                    if (im::button("Benchmark physics broadphase")) {
+                        physics::benchmarkBroadphase(game.memory.scratchArenaRoot);
+                    }
+                    if (im::button("Benchmark physics solver")) {
+                        physics::benchmarkSolver(game.memory.scratchArenaRoot);
+                    }
+                    if (im::button("Benchmark concurrent arena")) {
+                        jobs::benchmarkConcurrentArena(game.memory.scratchArenaRoot);
+                    }
+                    if (im::button("Rebuild room in background")) {
+                        request_room(game, game.roomId);
+                    }
+                    if (im::button("Cycle room in background")) {
+                        request_room(game, (game.roomId + 1) % countof(roomDefinitions));
+                    }
+                    im::label_format(
+                        "%s, last swap %.3fms, max %.3fms over %d swaps",
+                        game.streaming.building ? "building room" : "room ready",
+                        game.streaming.lastSwapMs, game.streaming.maxSwapMs,
+                        game.streaming.swapCount);
+                    {
+                        physics::Scene& physicsScene = game.scene.physicsScene;
+                        u32 broadphase = physicsScene.broadphase;
+                        im::input_step(
+                            physics::broadphaseNames[broadphase], &broadphase,
+                            0u, (u32)physics::BroadphaseType::Count - 1, true);
+                        physicsScene.broadphase = (physics::BroadphaseType::Enum)broadphase;
+                        im::checkbox("SIMD physics", &physicsScene.simd);
+                        im::input_step("Max physics substeps", &physicsScene.maxSubsteps, 1u, 16u);
+                        im::label_format(
+                            "%d physics substeps last frame", physicsScene.substepCount);
+                    }
+                    im::checkbox("Animation LOD", &game.scene.animScene.lod.enabled);
+                    im::label_format(
+                        "%d/%d animated nodes posed", game.scene.animScene.evaluatedCount,
+                        game.scene.animScene.nodes.count);
                     im::checkbox(
                         "Toggle memory arenas menu", &debug::debugMenus[debug::DebugMenus::Arenas]);
+                    __PROFILEONLY(im::checkbox(
+                        "Toggle profiler menu", &debug::debugMenus[debug::DebugMenus::Profiler]);)
                     im::checkbox(
                         "Toggle BVH debugging",
                         &debug::visualizationModes[debug::VisualizationModes::BVH]);
                     if (debug::visualizationModes[debug::VisualizationModes::BVH]) {
                         im::input_step("BVH depth", &debug::bvhDepth, 0u, 10000u);
+                        bvh::TreeStats stats;
+                        bvh::computeTreeStats(
+                            stats, game.memory.scratchArenaRoot, game.scene.mirrors.bvh);
+                        im::label_format(
+                            "%d nodes (%d wide), %d leaves, depth %d, SAH cost %.3f",
+                            stats.nodeCount, stats.wideNodeCount, stats.leafCount,
+                            stats.maxDepth, stats.sahCost);
                     }
 
                     im::checkbox(
@@ -886,6 +1038,9 @@ void update(Instance& game, platform::GameConfig& config) {
                         if (im::button("Capture cameras")) {
                             debug::capture_cameras_next_frame = true;
                         }
+                        if (im::button("Benchmark")) {
+                            renderer::benchmarkCullEntries(game.memory.scratchArenaRoot);
+                        }
                         u32 numCameras = 0;
                         if (debug::capturedCameras) {
                             if (im::button("Clear")) {
@@ -1037,6 +1192,18 @@ void update(Instance& game, platform::GameConfig& config) {
                             game.memory.scratchArenaRoot.curr, game.memory.scratchArenaHighmark,
                             "Scratch arena", arenabaseCol, arenahighmarkCol);
                     }
+                    if (jobs::pool.workerCount > 1) {
+                        // all worker threads' scratch arenas as a single bar
+                        const jobs::ScratchUsage usage = jobs::get_scratch_usage();
+                        const Color32 arenabaseCol(0.65f, 0.65f, 0.65f, 0.4f);
+                        const Color32 arenahighmarkCol(0.95f, 0.35f, 0.8f, 1.f);
+                        renderArena(
+                            (u8*)usage.committed, (u8*)0, (uintptr_t)usage.highmark,
+                            "Worker scratch arenas", arenabaseCol, arenahighmarkCol);
+                        im::label_format(
+                            arenahighmarkCol, "(%d workers, max %lu bytes in one)",
+                            jobs::pool.workerCount - 1, usage.maxWorkerHighmark);
+                    }
                     {
                         const Color32 arenabaseCol(0.65f, 0.65f, 0.65f, 0.4f);
                         const Color32 arenahighmarkCol(0.95f, 0.35f, 0.8f, 1.f);
@@ -1053,6 +1220,15 @@ void update(Instance& game, platform::GameConfig& config) {
                             (ptrdiff_t)game.memory.sceneArena.curr,
                             "Scene arena", arenabaseCol, arenahighmarkCol);
                     }
+                    // written by the background room build, so only shown while there is none
+                    if (!game.streaming.building) {
+                        const Color32 arenabaseCol(0.65f, 0.65f, 0.65f, 0.4f);
+                        const Color32 arenahighmarkCol(0.95f, 0.35f, 0.8f, 1.f);
+                        renderArena(
+                            game.memory.sceneArenaNext.end, game.memory.sceneArenaNextBuffer,
+                            (ptrdiff_t)game.memory.sceneArenaNext.curr,
+                            "Next scene arena", arenabaseCol, arenahighmarkCol);
+                    }
                     {
                         const Color32 baseCol(0.65f, 0.65f, 0.65f, 0.4f);
                         const Color32 used3dCol(0.95f, 0.35f, 0.8f, 1.f);
@@ -1107,10 +1283,77 @@ void update(Instance& game, platform::GameConfig& config) {
                             float2(originWS.x + i2d_barstart + i2d_barwidth, originWS.y),
                             used2didxCol);
                     }
+                    #if __ARENA_TRACKING
+                    {
+                        // callsites with the biggest single frame totals, across all arenas
+                        const Color32 callsiteCol(0.95f, 0.35f, 0.8f, 1.f);
+                        const allocator::TrackedCallsite* callsites[8];
+                        const u32 callsiteCount =
+                            allocator::get_top_callsites(callsites, countof(callsites));
+                        for (u32 i = 0; i < allocator::tracker.arenaCount; i++) {
+                            const allocator::TrackedArena& arena = allocator::tracker.arenas[i];
+                            im::label_format(
+                                callsiteCol, "%s arena %d: peak frame highmark %lu bytes",
+                                arena.name, i, arena.peakHighmark);
+                        }
+                        im::label_format(
+                            "Top arena callsites (%d tracked, %lu allocations dropped from a full table)",
+                            allocator::tracker.callsiteCount, allocator::tracker.droppedAllocs);
+                        for (u32 i = 0; i < callsiteCount; i++) {
+                            const allocator::TrackedCallsite& callsite = *callsites[i];
+                            const char* filename = callsite.file;
+                            for (const char* c = callsite.file; *c; c++) {
+                                if (*c == '/' || *c == '\\') { filename = c + 1; }
+                            }
+                            const char* arenaName = allocator::tracker.arenas[callsite.arena].name;
+                            im::label_format(
+                                callsiteCol, "%s:%d (%s arena) peak %lu bytes, %lu bytes this frame "
+                                "(%d allocs, %lu wasted)",
+                                filename, callsite.line, arenaName ? arenaName : "untracked",
+                                callsite.peakFrameBytes,
+                                callsite.frameBytes, callsite.frameAllocs, callsite.frameWaste);
+                        }
+                        if (im::button("Dump arena timeline")) {
+                            const char* path = "arena_timeline.csv";
+                            const bool written = allocator::write_tracking_csv(path);
+                            io::format(
+                                debug::eventLabel.text, sizeof(debug::eventLabel.text),
+                                written ? "Arena timeline written to %s" : "Couldn't write %s",
+                                path);
+                            debug::eventLabel.time = platform::state.time.now;
+                        }
+                    }
+                    #endif
                 }
                 im::pane_end();
             }
 
+            #if __PROFILE
+            if (debug::debugMenus[debug::DebugMenus::Profiler])
+            {
+                im::pane_start(debug::profilerPane);
+                {
+                    // rolling averages over the last frames, nested zones are included in their parents
+                    for (u32 i = 0; i < profiler::state.stageCount; i++) {
+                        const profiler::Stage& stage = profiler::state.stages[i];
+                        im::label_format(
+                            "%*s%s%s: %.3fms (%d calls)", stage.depth * 2, "", stage.name,
+                            stage.workerId ? " (jobs)" : "", profiler::get_stage_ms(stage),
+                            stage.calls);
+                    }
+                    if (im::button("Export Chrome trace")) {
+                        const char* path = "profile_trace.json";
+                        const bool written = profiler::write_chrome_trace(path);
+                        io::format(
+                            debug::eventLabel.text, sizeof(debug::eventLabel.text),
+                            written ? "Chrome trace written to %s" : "Couldn't write %s", path);
+                        debug::eventLabel.time = platform::state.time.now;
+                    }
+                }
+                im::pane_end();
+            }
+            #endif
+
             // event label
             if (debug::eventLabel.time != 0.f) {
 
@@ -1175,9 +1418,11 @@ void update(Instance& game, platform::GameConfig& config) {
                 }
             }
         }
+        __PROFILEONLY(profiler::end_zone();)
         #endif
 
         // copy backbuffer to window (upscale from game resolution to window resolution)
+        __PROFILEONLY(profiler::start_zone("present");)
         {
             gfx::rhi::start_event("UPSCALE TO WINDOW");
             {
@@ -1310,8 +1555,10 @@ void update(Instance& game, platform::GameConfig& config) {
             im::present2d(game.resources.renderCore.windowProjection.matrix);
         }
         #endif
-
+        __PROFILEONLY(profiler::end_zone();)
     }
+
+    __PROFILEONLY(profiler::end_zone(); profiler::end_frame();)
 }
 }
 
@@ -1,10 +1,166 @@
 #ifndef __WASTELADNS_ALLOCATOR_H__
 #define __WASTELADNS_ALLOCATOR_H__
 
+// Define __ARENA_TRACKING to 1 to record every Arena and PagedArena allocation by callsite
+// (file and line), along with the bytes lost to alignment, and keep a per frame timeline of them.
+// Callsites are default arguments evaluated at the caller, so ALLOC_ARRAY, push, reserve and
+// direct alloc_arena calls are all attributed to the line that made them
+#ifndef __ARENA_TRACKING
+#define __ARENA_TRACKING 0
+#endif
+
+#if __ARENA_TRACKING
+#define __ARENA_CALLSITE_DECL , const char* file = __builtin_FILE(), u32 line = __builtin_LINE()
+#define __ARENA_CALLSITE_ARGS , file, line
+#else
+#define __ARENA_CALLSITE_DECL
+#define __ARENA_CALLSITE_ARGS
+#endif
+
 namespace allocator {
 
 ptrdiff_t pagesize = 4 * 1024; // defaults to 4KB
 
+#if __ARENA_TRACKING
+// Callsites are kept in a hash table keyed by file, line and arena, and their allocations are added
+// up per frame. end_tracking_frame appends the frame's totals to a timeline ring, and keeps track of
+// the highest frame total of each callsite. Worker threads allocate from their scratch arenas
+// concurrently, so recording takes a spinlock
+// Arenas are registered with track_arena, and found by the address of each allocation, so scoped
+// copies count towards the arena they were copied from. Each timeline entry also stores how far
+// into its arena allocations reached in that frame, which is what the arena sizes have to cover
+struct TrackedCallsite {
+    const char* file;
+    u32 line;
+    u32 arena; // index into Tracker::arenas
+    u32 frameAllocs;
+    u64 frameBytes;
+    u64 frameWaste; // bytes skipped to align allocations
+    u64 peakFrameBytes;
+    u64 totalBytes;
+};
+struct TrackedArena {
+    const char* name;
+    uintptr_t base;
+    uintptr_t end; // of the reserved range
+    u64 frameHighmark; // bytes past base reached by this frame's allocations
+    u64 peakHighmark;
+};
+struct TrackedFrame {
+    u32 frame;
+    u32 callsite;
+    u32 allocs;
+    u64 bytes;
+    u64 waste;
+    u64 arenaHighmark; // of the callsite's arena, in this frame
+};
+struct Tracker {
+    enum { MaxCallsites = 1024, TimelineCapacity = 64 * 1024 }; // powers of two
+    enum { MaxArenas = 32, UntrackedArena = MaxArenas }; // allocations from unregistered arenas
+    TrackedCallsite callsites[MaxCallsites]; // open addressing, file is null if unused
+    TrackedArena arenas[MaxArenas + 1];
+    TrackedFrame timeline[TimelineCapacity];
+    u64 timelineCount;
+    u64 droppedAllocs; // new callsites that didn't fit in the table
+    u32 callsiteCount;
+    u32 arenaCount;
+    u32 frame;
+    volatile s32 lock;
+};
+Tracker tracker;
+
+// Arenas that aren't registered (or past MaxArenas) all count as the untracked one, which has
+// no name and no highmark
+void track_arena(const char* name, const uintptr_t base, const uintptr_t end) {
+    atomic::lock(&tracker.lock);
+    if (tracker.arenaCount < Tracker::MaxArenas) {
+        TrackedArena& arena = tracker.arenas[tracker.arenaCount++];
+        arena = {};
+        arena.name = name;
+        arena.base = base;
+        arena.end = end;
+    }
+    atomic::unlock(&tracker.lock);
+}
+void track_alloc(const char* file, const u32 line, const uintptr_t ptr, const ptrdiff_t size, const ptrdiff_t waste) {
+    atomic::lock(&tracker.lock);
+    u32 arenaIndex = Tracker::UntrackedArena;
+    for (u32 i = 0; i < tracker.arenaCount; i++) {
+        if (ptr >= tracker.arenas[i].base && ptr < tracker.arenas[i].end) { arenaIndex = i; break; }
+    }
+    if (arenaIndex != Tracker::UntrackedArena) {
+        TrackedArena& arena = tracker.arenas[arenaIndex];
+        arena.frameHighmark = math::max(arena.frameHighmark, (u64)(ptr + size - arena.base));
+    }
+
+    u32 hash = (line ^ (arenaIndex << 24)) * 2654435761u;
+    for (const char* c = file; *c; c++) { hash = (hash ^ (u8)*c) * 16777619u; }
+    // one slot is always left empty, so probing for a callsite that isn't in the table always ends
+    u32 index = hash & (Tracker::MaxCallsites - 1);
+    while (tracker.callsites[index].file
+        && (tracker.callsites[index].line != line
+            || tracker.callsites[index].arena != arenaIndex
+            || (tracker.callsites[index].file != file
+                && strcmp(tracker.callsites[index].file, file) != 0))) {
+        index = (index + 1) & (Tracker::MaxCallsites - 1);
+    }
+    TrackedCallsite& callsite = tracker.callsites[index];
+    if (!callsite.file) {
+        if (tracker.callsiteCount >= Tracker::MaxCallsites - 1) { // table is full
+            tracker.droppedAllocs++;
+            atomic::unlock(&tracker.lock);
+            return;
+        }
+        callsite.file = file;
+        callsite.line = line;
+        callsite.arena = arenaIndex;
+        tracker.callsiteCount++;
+    }
+    callsite.frameAllocs++;
+    callsite.frameBytes += size;
+    callsite.frameWaste += waste;
+    callsite.totalBytes += size;
+    atomic::unlock(&tracker.lock);
+}
+// Should be called once per frame. Allocations from other threads land in this frame or the next
+void end_tracking_frame() {
+    atomic::lock(&tracker.lock);
+    for (u32 i = 0; i < Tracker::MaxCallsites; i++) {
+        TrackedCallsite& callsite = tracker.callsites[i];
+        if (!callsite.frameAllocs) { continue; }
+        TrackedFrame& entry =
+            tracker.timeline[tracker.timelineCount++ & (Tracker::TimelineCapacity - 1)];
+        entry = { tracker.frame, i, callsite.frameAllocs, callsite.frameBytes, callsite.frameWaste,
+                  tracker.arenas[callsite.arena].frameHighmark };
+        callsite.peakFrameBytes = math::max(callsite.peakFrameBytes, callsite.frameBytes);
+        callsite.frameAllocs = 0;
+        callsite.frameBytes = 0;
+        callsite.frameWaste = 0;
+    }
+    for (u32 i = 0; i <= Tracker::MaxArenas; i++) {
+        TrackedArena& arena = tracker.arenas[i];
+        arena.peakHighmark = math::max(arena.peakHighmark, arena.frameHighmark);
+        arena.frameHighmark = 0;
+    }
+    tracker.frame++;
+    atomic::unlock(&tracker.lock);
+}
+// Fills out with up to count callsites, sorted by their highest frame total
+u32 get_top_callsites(const TrackedCallsite** out, const u32 count) {
+    u32 outCount = 0;
+    for (u32 i = 0; i < Tracker::MaxCallsites; i++) {
+        const TrackedCallsite& callsite = tracker.callsites[i];
+        if (!callsite.file) { continue; }
+        u32 j = outCount < count ? outCount++ : count;
+        for (; j > 0 && out[j - 1]->peakFrameBytes < callsite.peakFrameBytes; j--) {
+            if (j < count) { out[j] = out[j - 1]; }
+        }
+        if (j < count) { out[j] = &callsite; }
+    }
+    return outCount;
+}
+#endif
+
 // Simple arena buffer header: only the current offset is stored, as well as the capacity
 // It can be used as a stack allocator by simply copying this header into a scoped variable
 // For more details, see: https://nullprogram.com/blog/2023/09/27/
@@ -13,10 +169,13 @@ void init_arena(Arena& arena, u8* mem, size_t capacity) {
     arena.curr = mem;
     arena.end = arena.curr + capacity;
 }
-void* alloc_arena(Arena& arena, ptrdiff_t size, ptrdiff_t align) {
+void* alloc_arena(Arena& arena, ptrdiff_t size, ptrdiff_t align __ARENA_CALLSITE_DECL) {
     assert((align & (align - 1)) == 0); // Alignment needs to be a power of two
     uintptr_t curr_aligned = ((uintptr_t)arena.curr + (align - 1)) & -align;
     if (curr_aligned + size <= (uintptr_t)arena.end) {
+        #if __ARENA_TRACKING
+        track_alloc(file, line, curr_aligned, size, curr_aligned - (uintptr_t)arena.curr);
+        #endif
         arena.curr = (u8*)(curr_aligned + size);
         return (void*)curr_aligned;
     }
@@ -46,9 +205,18 @@ void init_arena(PagedArena& arena, size_t capacity) {
     arena.end = reserve_pages(uintptr_t(arena.curr + capacity), (uintptr_t)arena.curr);
     arena.highmark = nullptr;
 }
-void* alloc_arena(PagedArena& arena, ptrdiff_t size, ptrdiff_t align) {
+#if __ARENA_TRACKING
+// Covers the whole reserved range, call it before the first allocation
+void track_arena(const char* name, const PagedArena& arena) {
+    track_arena(name, (uintptr_t)arena.curr, (uintptr_t)arena.curr + 4ULL * 1024ULL * 1024ULL * 1024ULL);
+}
+#endif
+void* alloc_arena(PagedArena& arena, ptrdiff_t size, ptrdiff_t align __ARENA_CALLSITE_DECL) {
     assert((align & (align - 1)) == 0); // Alignment needs to be a power of two
     uintptr_t curr_aligned = ((uintptr_t)arena.curr + (align - 1)) & -align;
+    #if __ARENA_TRACKING
+    track_alloc(file, line, curr_aligned, size, curr_aligned - (uintptr_t)arena.curr);
+    #endif
     uintptr_t end_aligned = curr_aligned + size;
     uintptr_t highmark = (uintptr_t)arena.end;
     if (arena.highmark) { highmark = math::max(*arena.highmark, highmark); };
@@ -64,12 +232,14 @@ void* alloc_arena(PagedArena& arena, ptrdiff_t size, ptrdiff_t align) {
     arena.curr = (u8*)end_aligned;
     return (void*)curr_aligned;
 }
-void* realloc_arena(PagedArena& arena, void* oldptr, ptrdiff_t oldsize, ptrdiff_t newsize, ptrdiff_t align) {
+void* realloc_arena(
+    PagedArena& arena, void* oldptr, ptrdiff_t oldsize, ptrdiff_t newsize, ptrdiff_t align
+    __ARENA_CALLSITE_DECL) {
     void* oldbuff = (void*)((uintptr_t)arena.curr - oldsize);
     if (oldbuff == oldptr) {
-        return alloc_arena(arena, newsize - oldsize, align);
+        return alloc_arena(arena, newsize - oldsize, align __ARENA_CALLSITE_ARGS);
     } else {
-        void* data = alloc_arena(arena, newsize, align);
+        void* data = alloc_arena(arena, newsize, align __ARENA_CALLSITE_ARGS);
         if (oldsize) memcpy(data, oldptr, oldsize);
         return data;
     }
@@ -83,6 +253,52 @@ void free_arena(PagedArena& arena, void* ptr, ptrdiff_t size) {
         arena.curr = (u8*)oldbuff;
     }
 }
+// Same as PagedArena, but any number of threads can allocate from it at once. The offset is
+// bumped with a compare-and-swap loop, so allocations never wait on each other, only retry if
+// another thread got there first. Committing more pages takes a spinlock, which is only hit
+// by allocations that go past the committed range (pages are committed in chunks, to keep that rare)
+// It can't be scoped by copy like PagedArena: reset it once no other thread is using it
+struct ConcurrentArena {
+    u8* base;
+    volatile s64 offset; // bytes allocated past base
+    volatile s64 committed; // bytes committed past base
+    volatile s32 commitLock;
+};
+const ptrdiff_t concurrentCommitChunk = 64 * 1024;
+void init_arena(ConcurrentArena& arena, size_t capacity) {
+    // reserve 4GB of virtual memory (we'll crash if we touch anything past that)
+    const size_t capacity_aligned = 4ULL * 1024ULL * 1024ULL * 1024ULL;
+    arena.base = (u8*)platform::mem_reserve(capacity_aligned);
+    arena.committed = reserve_pages(uintptr_t(arena.base + capacity), (uintptr_t)arena.base) - arena.base;
+    arena.offset = 0;
+    arena.commitLock = 0;
+}
+void* alloc_arena(ConcurrentArena& arena, ptrdiff_t size, ptrdiff_t align) {
+    assert((align & (align - 1)) == 0); // Alignment needs to be a power of two
+    s64 offset = atomic::load(&arena.offset);
+    uintptr_t curr_aligned;
+    s64 end;
+    while (true) {
+        curr_aligned = ((uintptr_t)arena.base + offset + (align - 1)) & -align;
+        end = (s64)(curr_aligned + size - (uintptr_t)arena.base);
+        const s64 prev = atomic::compare_exchange(&arena.offset, end, offset);
+        if (prev == offset) { break; }
+        offset = prev;
+    }
+    if (end > atomic::load(&arena.committed)) {
+        atomic::lock(&arena.commitLock);
+        const s64 committed = arena.committed; // another thread may have committed it while we waited
+        if (end > committed) {
+            const uintptr_t target = (uintptr_t)arena.base + math::max(end, committed + (s64)concurrentCommitChunk);
+            u8* committedEnd = reserve_pages(target, (uintptr_t)arena.base + committed);
+            atomic::store(&arena.committed, committedEnd - arena.base);
+        }
+        atomic::unlock(&arena.commitLock);
+    }
+    return (void*)curr_aligned;
+}
+void reset_arena(ConcurrentArena& arena) { atomic::store(&arena.offset, 0); } // pages stay committed
+
 #define ALLOC_BYTES(arena, type, size, align) (type*)allocator::alloc_arena(arena, size, align)
 #define ALLOC_ARRAY(arena, type, count) (type*)allocator::alloc_arena(arena, (count) * sizeof(type), alignof(type))
 
@@ -96,24 +312,26 @@ struct Buffer_t {
     ptrdiff_t len;
     ptrdiff_t cap;
 };
-void grow(Buffer_t& b, ptrdiff_t size, ptrdiff_t align, PagedArena& arena) {
+void grow(Buffer_t& b, ptrdiff_t size, ptrdiff_t align, PagedArena& arena __ARENA_CALLSITE_DECL) {
     ptrdiff_t doublecap = b.cap ? 2 * b.cap : 2;
     if (b.data + size * b.cap == arena.curr) {
-        alloc_arena(arena, size * b.cap, align);
+        alloc_arena(arena, size * b.cap, align __ARENA_CALLSITE_ARGS);
     } else {
-        u8* data = (u8*)alloc_arena(arena, doublecap * size, align);
+        u8* data = (u8*)alloc_arena(arena, doublecap * size, align __ARENA_CALLSITE_ARGS);
         if (b.len) { memcpy(data, b.data, size * b.len); }
         b.data = data;
     }
     b.cap = doublecap;
 }
-u8& push(Buffer_t& b, ptrdiff_t size, ptrdiff_t align, PagedArena& arena) {
-    if (b.len >= b.cap) { grow(b, size, align, arena); }
+u8& push(Buffer_t& b, ptrdiff_t size, ptrdiff_t align, PagedArena& arena __ARENA_CALLSITE_DECL) {
+    if (b.len >= b.cap) { grow(b, size, align, arena __ARENA_CALLSITE_ARGS); }
     return *(b.data + size * b.len++);
 }
-void reserve(Buffer_t& b, ptrdiff_t cap, ptrdiff_t size, ptrdiff_t align, PagedArena& arena) {
+void reserve(
+    Buffer_t& b, ptrdiff_t cap, ptrdiff_t size, ptrdiff_t align, PagedArena& arena
+    __ARENA_CALLSITE_DECL) {
     assert(b.cap == 0); // buffer is not empty
-    b.data = (u8*)alloc_arena(arena, cap * size, align);
+    b.data = (u8*)alloc_arena(arena, cap * size, align __ARENA_CALLSITE_ARGS);
     b.len = 0;
     b.cap = cap;
 }
@@ -124,14 +342,14 @@ struct Buffer {
     ptrdiff_t cap;
 };
 template<typename T>
-T& push(Buffer<T>& b, PagedArena& arena) {
-    if (b.len >= b.cap) { grow(*(Buffer_t*)&b, sizeof(T), alignof(T), arena); }
+T& push(Buffer<T>& b, PagedArena& arena __ARENA_CALLSITE_DECL) {
+    if (b.len >= b.cap) { grow(*(Buffer_t*)&b, sizeof(T), alignof(T), arena __ARENA_CALLSITE_ARGS); }
     return *(b.data + b.len++);
 }
 template<typename T>
-void reserve(Buffer<T>& b, ptrdiff_t cap, PagedArena& arena) {
+void reserve(Buffer<T>& b, ptrdiff_t cap, PagedArena& arena __ARENA_CALLSITE_DECL) {
     assert(b.cap == 0); // buffer is not empty
-    b.data = (T*)alloc_arena(arena, sizeof(T) * cap, alignof(T));
+    b.data = (T*)alloc_arena(arena, sizeof(T) * cap, alignof(T) __ARENA_CALLSITE_ARGS);
     b.len = 0;
     b.cap = cap;
 }
@@ -154,10 +372,11 @@ struct Pool {
     ptrdiff_t count;
 };
 template<typename T>
-void init_pool(Pool<T>& pool, ptrdiff_t cap, PagedArena& arena) {
+void init_pool(Pool<T>& pool, ptrdiff_t cap, PagedArena& arena __ARENA_CALLSITE_DECL) {
 	typedef typename Pool<T>::Slot Slot;
 	pool.cap = cap;
-    pool.data = (Slot*)allocator::alloc_arena(arena, sizeof(Slot) * cap, alignof(Slot));
+    pool.data = (Slot*)allocator::alloc_arena(
+        arena, sizeof(Slot) * cap, alignof(Slot) __ARENA_CALLSITE_ARGS);
     pool.firstAvailable = pool.data;
 	for (u32 i = 0; i < cap - 1; i++)
     { pool.data[i].state.next = &(pool.data[i+1]); pool.data[i].alive = 0; }
@@ -176,10 +395,10 @@ T&  alloc_pool(Pool<T>& pool) {
 template<typename T>
 void free_pool(Pool<T>& pool, T& slot) {
     typedef typename Pool<T>::Slot Slot;
-    assert((Slot*)slot >= &pool.data && (Slot*)slot < &pool.data + pool.cap); // object didn't come from this pool
+    assert((Slot*)&slot >= pool.data && (Slot*)&slot < pool.data + pool.cap); // object didn't come from this pool
     ((Slot*)&slot)->state.next = pool.firstAvailable;
     ((Slot*)&slot)->alive = 0;
-    pool.firstAvailable = (Slot*)slot;
+    pool.firstAvailable = (Slot*)&slot;
 	pool.count--;
 }
 template<typename T>
@@ -188,6 +407,84 @@ u32 get_pool_index(Pool<T>& pool, T& slot)
 template<typename T>
 T& get_pool_slot(Pool<T>& pool, const u32 index) { return pool.data[index].state.live; }
 
+// Packed pool: live values are kept contiguous in data[0, count), so hot loops only walk live data.
+// Freeing moves the last value into the hole, so pointers into the pool are only stable until the
+// next free. Handles go through a sparse slot indirection instead, and carry the slot's generation
+// so that handles to freed slots are caught. Handle 0 is reserved for 0 initialization
+struct PackedPoolMeta { enum {
+    SlotBits = 24, SlotMask = (1 << SlotBits) - 1, GenerationMask = 0xff, MaxSlots = SlotMask - 1 }; };
+template<typename T>
+struct PackedPool {
+    __DEBUGDEF(const char* name;)
+    T* data;
+    u32* denseToSparse; // slot of each value in data
+    u32* sparse; // index in data of each live slot, next available slot otherwise
+    u8* generations; // bumped every time a slot is freed
+    u32 firstAvailable;
+    u32 cap;
+    u32 count;
+};
+template<typename T>
+void init_packed_pool(PackedPool<T>& pool, const u32 cap, PagedArena& arena __ARENA_CALLSITE_DECL) {
+    assert(cap > 0 && cap <= PackedPoolMeta::MaxSlots);
+    pool.data = (T*)allocator::alloc_arena(
+        arena, sizeof(T) * cap, alignof(T) __ARENA_CALLSITE_ARGS);
+    pool.denseToSparse = (u32*)allocator::alloc_arena(
+        arena, sizeof(u32) * cap, alignof(u32) __ARENA_CALLSITE_ARGS);
+    pool.sparse = (u32*)allocator::alloc_arena(
+        arena, sizeof(u32) * cap, alignof(u32) __ARENA_CALLSITE_ARGS);
+    pool.generations = (u8*)allocator::alloc_arena(
+        arena, sizeof(u8) * cap, alignof(u8) __ARENA_CALLSITE_ARGS);
+    for (u32 i = 0; i < cap; i++) { pool.sparse[i] = i + 1; pool.generations[i] = 0; }
+    pool.firstAvailable = 0;
+    pool.cap = cap;
+    pool.count = 0;
+}
+template<typename T>
+T& alloc_packed_pool(PackedPool<T>& pool) {
+    assert(pool.firstAvailable < pool.cap); // can't regrow without messing up existing pointers to the pool
+    const u32 slot = pool.firstAvailable;
+    const u32 index = pool.count++;
+    pool.firstAvailable = pool.sparse[slot];
+    pool.sparse[slot] = index;
+    pool.denseToSparse[index] = slot;
+    return pool.data[index];
+}
+template<typename T>
+u32 get_packed_pool_handle(PackedPool<T>& pool, const T& value) {
+    const u32 index = (u32)(&value - pool.data);
+    assert(index < pool.count); // object didn't come from this pool
+    const u32 slot = pool.denseToSparse[index];
+    return (pool.generations[slot] << PackedPoolMeta::SlotBits) | (slot + 1);
+}
+template<typename T>
+bool is_packed_pool_handle_valid(PackedPool<T>& pool, const u32 handle) {
+    const u32 slot = (handle & PackedPoolMeta::SlotMask) - 1;
+    return handle != 0 && slot < pool.cap
+        && pool.generations[slot] == (handle >> PackedPoolMeta::SlotBits)
+        && pool.sparse[slot] < pool.count && pool.denseToSparse[pool.sparse[slot]] == slot;
+}
+template<typename T>
+T& get_packed_pool_slot(PackedPool<T>& pool, const u32 handle) {
+    assert(is_packed_pool_handle_valid(pool, handle)); // stale or uninitialized handle
+    return pool.data[pool.sparse[(handle & PackedPoolMeta::SlotMask) - 1]];
+}
+template<typename T>
+void free_packed_pool(PackedPool<T>& pool, const u32 handle) {
+    assert(is_packed_pool_handle_valid(pool, handle)); // stale or uninitialized handle
+    const u32 slot = (handle & PackedPoolMeta::SlotMask) - 1;
+    const u32 index = pool.sparse[slot];
+    const u32 last = --pool.count;
+    if (index != last) {
+        pool.data[index] = pool.data[last];
+        pool.denseToSparse[index] = pool.denseToSparse[last];
+        pool.sparse[pool.denseToSparse[index]] = index;
+    }
+    pool.generations[slot] = (pool.generations[slot] + 1) & PackedPoolMeta::GenerationMask;
+    pool.sparse[slot] = pool.firstAvailable;
+    pool.firstAvailable = slot;
+}
+
 }
 
 
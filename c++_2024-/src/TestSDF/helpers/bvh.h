@@ -1,8 +1,22 @@
 #ifndef __WASTELADNS_BVH_H__
 #define __WASTELADNS_BVH_H__
 
+// Node, triangle and vertex indices are u16 by default, to keep nodes small.
+// Define __BVH_WIDE_INDICES to 1 to build trees over more than 65535 nodes, vertices
+// or triangle indices (about 21k triangles)
+#ifndef __BVH_WIDE_INDICES
+#define __BVH_WIDE_INDICES 0
+#endif
+
 namespace bvh {
 
+#if __BVH_WIDE_INDICES
+typedef u32 Index;
+#else
+typedef u16 Index;
+#endif
+const u32 maxIndex = (u32)(Index)~0u;
+
 struct Node {
     union {
         struct { // for loading
@@ -15,9 +29,10 @@ struct Node {
             __m256 zcoords_256;
         };
     };
-    u16 lchildId;
-    u16 firstIndexId;
-    u16 sourceId;
+    f32 buildCost; // normalized SAH cost of the subtree when it was last built (see refit)
+    Index lchildId;
+    Index firstIndexId;
+    Index sourceId;
     bool isLeaf;
 };
 
@@ -48,17 +63,54 @@ struct Triangle {
     u32 firstVertexIndex;
     u32 sourceId;
 };
+force_inline void makeTriangle(
+    Triangle& tri, const f32* vertexPool, const Index* indexPool, const u32 triangleId) {
+    float3 a(
+        vertexPool[indexPool[triangleId * 3] * 3],
+        vertexPool[indexPool[triangleId * 3] * 3 + 1],
+        vertexPool[indexPool[triangleId * 3] * 3 + 2]);
+    float3 b(
+        vertexPool[indexPool[triangleId * 3 + 1] * 3],
+        vertexPool[indexPool[triangleId * 3 + 1] * 3 + 1],
+        vertexPool[indexPool[triangleId * 3 + 1] * 3 + 2]);
+    float3 c(
+        vertexPool[indexPool[triangleId * 3 + 2] * 3],
+        vertexPool[indexPool[triangleId * 3 + 2] * 3 + 1],
+        vertexPool[indexPool[triangleId * 3 + 2] * 3 + 2]);
+    tri.min = math::min(math::min(a, b), c);
+    tri.max = math::max(math::max(a, b), c);
+    tri.center = math::scale(math::add(tri.max, tri.min), 0.5f);
+    tri.firstVertexIndex = triangleId * 3;
+}
+struct BuildMode { enum Enum { Midpoint, SAH }; };
 struct BuildTreeContext {
     allocator::Buffer<Node>& nodes;
     allocator::PagedArena& persistentArena;
     const Triangle* trianglePool;
     const f32* vertexPool;
-    const u16* indexPool;
+    const Index* indexPool;
     u32 indexCount;
+    BuildMode::Enum mode;
+};
+// Collapsed 8-wide node: stores the bounds of up to 8 children as SoA lanes,
+// so a single pass per frustum plane classifies all of them
+struct WideNode {
+    __m256 minx_256;
+    __m256 miny_256;
+    __m256 minz_256;
+    __m256 maxx_256;
+    __m256 maxy_256;
+    __m256 maxz_256;
+    Index children[8]; // wide node id, or source id of the leaf (see leafMask)
+    u8 childCount;
+    u8 leafMask;
 };
 struct Tree {
-    Node* nodes;
-    u32 nodeCount;
+    Node* nodes; // binary tree, only kept if built with keepBinaryNodes: refit, stats and debug drawing need it
+    WideNode* wideNodes; // collapsed tree, used for queries
+    u32 nodeCount; // 0 if the binary tree wasn't kept
+    u32 wideNodeCount;
+    u32 wideNodeCap; // refit collapses into the same array, and only grows it past this
 };
 force_inline void emptyNode(Node& n) {
     n.min = float3( FLT_MAX,  FLT_MAX,  FLT_MAX);
@@ -68,57 +120,167 @@ force_inline void expandNodeBounds(Node& n, const Triangle& tri) {
     n.min = math::min(n.min, tri.min);
     n.max = math::max(n.max, tri.max);
 }
-void buildTreeRecursive(
-BuildTreeContext& ctx, u16* triangleIds, u32 triangleId_count, const u32 nodeId) {
+force_inline f32 halfSurfaceArea(const float3 min, const float3 max) {
+    const float3 e = math::subtract(max, min);
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+// Binned surface area heuristic: bucket the triangle centers along each axis,
+// and pick the bucket boundary that minimizes area(l) * count(l) + area(r) * count(r)
+// Triangles are partitioned in place, and the size of the left side is returned
+// (0 if no valid split was found)
+const u32 sahBinCount = 12;
+u32 splitTrianglesSAH(const BuildTreeContext& ctx, Index* triangleIds, const u32 triangleId_count) {
+    struct Bin {
+        float3 min;
+        float3 max;
+        u32 count;
+    };
+
+    float3 centerMin( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    float3 centerMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (u32 i = 0; i < triangleId_count; i++) {
+        const Triangle& tri = ctx.trianglePool[triangleIds[i]];
+        centerMin = math::min(centerMin, tri.center);
+        centerMax = math::max(centerMax, tri.center);
+    }
+
+    f32 bestCost = FLT_MAX;
+    u32 bestAxis = 0;
+    u32 bestBin = 0;
+    for (u32 axis = 0; axis < 3; axis++) {
+        const f32 extent = centerMax.v[axis] - centerMin.v[axis];
+        if (extent <= 0.f) { continue; }
+        const f32 binScale = sahBinCount / extent;
+
+        Bin bins[sahBinCount];
+        for (u32 b = 0; b < sahBinCount; b++) {
+            bins[b].min = float3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+            bins[b].max = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            bins[b].count = 0;
+        }
+        for (u32 i = 0; i < triangleId_count; i++) {
+            const Triangle& tri = ctx.trianglePool[triangleIds[i]];
+            const u32 b = math::min(
+                (u32)((tri.center.v[axis] - centerMin.v[axis]) * binScale), sahBinCount - 1);
+            bins[b].min = math::min(bins[b].min, tri.min);
+            bins[b].max = math::max(bins[b].max, tri.max);
+            bins[b].count++;
+        }
+
+        // sweep from the left to compute the left side of each split plane,
+        // then sweep from the right to evaluate the full cost
+        f32 lArea[sahBinCount - 1];
+        u32 lCount[sahBinCount - 1];
+        float3 accumMin( FLT_MAX,  FLT_MAX,  FLT_MAX);
+        float3 accumMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        u32 accumCount = 0;
+        for (u32 b = 0; b < sahBinCount - 1; b++) {
+            accumMin = math::min(accumMin, bins[b].min);
+            accumMax = math::max(accumMax, bins[b].max);
+            accumCount += bins[b].count;
+            lArea[b] = accumCount ? halfSurfaceArea(accumMin, accumMax) : 0.f;
+            lCount[b] = accumCount;
+        }
+        accumMin = float3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+        accumMax = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        accumCount = 0;
+        for (u32 b = sahBinCount - 1; b > 0; b--) {
+            accumMin = math::min(accumMin, bins[b].min);
+            accumMax = math::max(accumMax, bins[b].max);
+            accumCount += bins[b].count;
+            if (lCount[b - 1] == 0 || accumCount == 0) { continue; }
+            const f32 cost =
+                lArea[b - 1] * lCount[b - 1] + halfSurfaceArea(accumMin, accumMax) * accumCount;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b - 1;
+            }
+        }
+    }
+    if (bestCost == FLT_MAX) { return 0; }
+
+    // Partition triangles in place, using the same binning as above
+    const f32 binScale = sahBinCount / (centerMax.v[bestAxis] - centerMin.v[bestAxis]);
+    auto binId = [&](const Index triangleId) {
+        const Triangle& tri = ctx.trianglePool[triangleId];
+        return math::min(
+            (u32)((tri.center.v[bestAxis] - centerMin.v[bestAxis]) * binScale), sahBinCount - 1);
+    };
+    u32 lTriangleIdIdx = 0;
+    u32 rTriangleIdIdx = triangleId_count;
+    while (lTriangleIdIdx < rTriangleIdIdx) {
+        if (binId(triangleIds[lTriangleIdIdx]) <= bestBin) {
+            lTriangleIdIdx++;
+        } else {
+            rTriangleIdIdx--;
+            Index temp = triangleIds[lTriangleIdIdx];
+            triangleIds[lTriangleIdIdx] = triangleIds[rTriangleIdIdx];
+            triangleIds[rTriangleIdIdx] = temp;
+        }
+    }
+    return lTriangleIdIdx;
+}
+// Sets up the node as a leaf, or splits its triangles in place and pushes its two children
+// Returns the number of triangles on the left child (0 for leaves)
+u32 buildNode(
+BuildTreeContext& ctx, Index* triangleIds, u32 triangleId_count, const u32 nodeId) {
     ctx.nodes.data[nodeId].isLeaf = triangleId_count == 1;
     if (ctx.nodes.data[nodeId].isLeaf) {
         const Triangle& tri = ctx.trianglePool[triangleIds[0]];
         ctx.nodes.data[nodeId].firstIndexId = triangleIds[0] * 3;
         ctx.nodes.data[nodeId].sourceId = tri.sourceId;
+        return 0;
     } else {
-        ctx.nodes.data[nodeId].lchildId = (u32)ctx.nodes.len;
+        ctx.nodes.data[nodeId].lchildId = (Index)ctx.nodes.len;
         Node lchild = {};
         Node rchild = {};
         emptyNode(lchild);
         emptyNode(rchild);
 
-        // Choose the largest axis of the bounding box to split the triangles
-        float3 currExtents = math::subtract(ctx.nodes.data[nodeId].max, ctx.nodes.data[nodeId].min);
-        u8 widestCoord = 0;
-        if (currExtents.y > math::max(currExtents.x, currExtents.z)) {
-            widestCoord = 1;
-        } else if (currExtents.z > math::max(currExtents.x, currExtents.y)) {
-            widestCoord = 2;
-        }
-        f32 widestCoordCenter = 0.5f * 
-            (ctx.nodes.data[nodeId].max.v[widestCoord] + ctx.nodes.data[nodeId].min.v[widestCoord]);
-
-        // Partition triangles in place, on each side of the widest axis
-        u32 lTriangleIdIdx = 0;
-        u32 rTriangleIdIdx = triangleId_count - 1;
-        while (lTriangleIdIdx < rTriangleIdIdx) {
-            while (ctx.trianglePool[triangleIds[lTriangleIdIdx]].center.v[widestCoord] < widestCoordCenter
-                && lTriangleIdIdx <= triangleId_count - 2) { lTriangleIdIdx++; }
-            while (ctx.trianglePool[triangleIds[rTriangleIdIdx]].center.v[widestCoord] >= widestCoordCenter
-                && rTriangleIdIdx >= 1) { rTriangleIdIdx--; }
-            if (lTriangleIdIdx < rTriangleIdIdx) {
-                u32 temp = triangleIds[lTriangleIdIdx];
-                triangleIds[lTriangleIdIdx] = triangleIds[rTriangleIdIdx];
-                triangleIds[rTriangleIdIdx] = temp;
+        u32 lTriangleCount = 0;
+        if (ctx.mode == BuildMode::SAH) {
+            lTriangleCount = splitTrianglesSAH(ctx, triangleIds, triangleId_count);
+        } else {
+            // Choose the largest axis of the bounding box to split the triangles
+            float3 currExtents = math::subtract(ctx.nodes.data[nodeId].max, ctx.nodes.data[nodeId].min);
+            u8 widestCoord = 0;
+            if (currExtents.y > math::max(currExtents.x, currExtents.z)) {
+                widestCoord = 1;
+            } else if (currExtents.z > math::max(currExtents.x, currExtents.y)) {
+                widestCoord = 2;
             }
+            f32 widestCoordCenter = 0.5f * 
+                (ctx.nodes.data[nodeId].max.v[widestCoord] + ctx.nodes.data[nodeId].min.v[widestCoord]);
+
+            // Partition triangles in place, on each side of the widest axis
+            u32 lTriangleIdIdx = 0;
+            u32 rTriangleIdIdx = triangleId_count - 1;
+            while (lTriangleIdIdx < rTriangleIdIdx) {
+                while (ctx.trianglePool[triangleIds[lTriangleIdIdx]].center.v[widestCoord] < widestCoordCenter
+                    && lTriangleIdIdx <= triangleId_count - 2) { lTriangleIdIdx++; }
+                while (ctx.trianglePool[triangleIds[rTriangleIdIdx]].center.v[widestCoord] >= widestCoordCenter
+                    && rTriangleIdIdx >= 1) { rTriangleIdIdx--; }
+                if (lTriangleIdIdx < rTriangleIdIdx) {
+                    Index temp = triangleIds[lTriangleIdIdx];
+                    triangleIds[lTriangleIdIdx] = triangleIds[rTriangleIdIdx];
+                    triangleIds[rTriangleIdIdx] = temp;
+                }
+            }
+            lTriangleCount = lTriangleIdIdx;
         }
-        u32 lTriangleCount = lTriangleIdIdx;
         u32 rTriangleCount = triangleId_count - lTriangleCount;
 
         // One of the sides is empty (can happen, since the widest axis
         // is determined from bounding boxes, but the center of every
         // triangle may lie on one side)
         if (lTriangleCount == 0 || rTriangleCount == 0) {
-            lTriangleIdIdx = 0;
-            rTriangleIdIdx = triangleId_count - 1;
+            u32 lTriangleIdIdx = 0;
+            u32 rTriangleIdIdx = triangleId_count - 1;
             while (lTriangleIdIdx < rTriangleIdIdx) {
                 if ((lTriangleIdIdx & 1) != 0) {
-                    u16 rTriangle = triangleIds[rTriangleIdIdx];
+                    Index rTriangle = triangleIds[rTriangleIdIdx];
                     triangleIds[rTriangleIdIdx] = triangleIds[lTriangleIdIdx];
                     triangleIds[lTriangleIdIdx] = rTriangle;
                 }
@@ -145,74 +307,534 @@ BuildTreeContext& ctx, u16* triangleIds, u32 triangleId_count, const u32 nodeId)
         // this reallocate-emplace
         allocator::push(ctx.nodes, ctx.persistentArena) = lchild;
         allocator::push(ctx.nodes, ctx.persistentArena) = rchild;
-        buildTreeRecursive(
-            ctx, triangleIds, lTriangleCount,
-            ctx.nodes.data[nodeId].lchildId);
-        buildTreeRecursive(
-            ctx, triangleIds + lTriangleCount, rTriangleCount,
-            ctx.nodes.data[nodeId].lchildId + 1);
+        return lTriangleCount;
+    }
+}
+void buildTreeRecursive(
+BuildTreeContext& ctx, Index* triangleIds, u32 triangleId_count, const u32 nodeId) {
+    const u32 lTriangleCount = buildNode(ctx, triangleIds, triangleId_count, nodeId);
+    if (ctx.nodes.data[nodeId].isLeaf) { return; }
+    buildTreeRecursive(
+        ctx, triangleIds, lTriangleCount,
+        ctx.nodes.data[nodeId].lchildId);
+    buildTreeRecursive(
+        ctx, triangleIds + lTriangleCount, triangleId_count - lTriangleCount,
+        ctx.nodes.data[nodeId].lchildId + 1);
+}
+
+// Parallel build: the top of the tree is built serially, until subtrees are small enough to
+// become jobs. A subtree over n triangles always has 2n-1 nodes, so each job is handed its own
+// range of the (fully reserved) node array up front, and can push nodes without synchronization
+// or relinking afterwards.
+const u32 parallelBuildMinTriangles = 2048;
+struct BuildTreeTask {
+    allocator::Buffer<Node> nodes; // view over the shared array, limited to this subtree's range
+    const BuildTreeContext* ctx;
+    Index* triangleIds;
+    u32 triangleId_count;
+    u32 nodeId;
+};
+void buildTreeTask(jobs::Context&, void* data) {
+    BuildTreeTask& task = *(BuildTreeTask*)data;
+    BuildTreeContext ctx = {
+        task.nodes,
+        task.ctx->persistentArena,
+        task.ctx->trianglePool,
+        task.ctx->vertexPool,
+        task.ctx->indexPool,
+        task.ctx->indexCount,
+        task.ctx->mode
+    };
+    buildTreeRecursive(ctx, task.triangleIds, task.triangleId_count, task.nodeId);
+    assert(task.nodes.len == task.nodes.cap); // the subtree must fill its range exactly
+}
+void buildTreeTopRecursive(
+BuildTreeContext& ctx, allocator::Buffer<BuildTreeTask>& tasks, allocator::PagedArena& scratchArena,
+Index* triangleIds, u32 triangleId_count, const u32 nodeId, const u32 taskTriangleCount) {
+    if (triangleId_count <= taskTriangleCount) {
+        BuildTreeTask& task = allocator::push(tasks, scratchArena);
+        task = {};
+        task.ctx = &ctx;
+        task.triangleIds = triangleIds;
+        task.triangleId_count = triangleId_count;
+        task.nodeId = nodeId;
+        task.nodes.len = ctx.nodes.len;
+        task.nodes.cap = ctx.nodes.len + 2 * triangleId_count - 2; // root is already allocated
+        ctx.nodes.len = task.nodes.cap;
+        return;
+    }
+    const u32 lTriangleCount = buildNode(ctx, triangleIds, triangleId_count, nodeId);
+    buildTreeTopRecursive(
+        ctx, tasks, scratchArena, triangleIds, lTriangleCount,
+        ctx.nodes.data[nodeId].lchildId, taskTriangleCount);
+    buildTreeTopRecursive(
+        ctx, tasks, scratchArena, triangleIds + lTriangleCount, triangleId_count - lTriangleCount,
+        ctx.nodes.data[nodeId].lchildId + 1, taskTriangleCount);
+}
+// Collapse the binary tree into 8-wide nodes: starting from the node's children,
+// keep replacing the largest internal child by its own two children until 8 slots are used
+u32 collapseTreeRecursive(
+allocator::Buffer<WideNode>& wideNodes, allocator::PagedArena& persistentArena,
+const Node* nodes, const u32 nodeId) {
+    u32 slots[8];
+    u32 slotCount = 0;
+    if (nodes[nodeId].isLeaf) {
+        slots[slotCount++] = nodeId;
+    } else {
+        slots[slotCount++] = nodes[nodeId].lchildId;
+        slots[slotCount++] = nodes[nodeId].lchildId + 1u;
     }
+    while (slotCount < 8) {
+        s32 largestSlot = -1;
+        f32 largestArea = -1.f;
+        for (u32 i = 0; i < slotCount; i++) {
+            const Node& child = nodes[slots[i]];
+            if (child.isLeaf) { continue; }
+            const f32 area = halfSurfaceArea(child.min, child.max);
+            if (area > largestArea) { largestArea = area; largestSlot = i; }
+        }
+        if (largestSlot < 0) { break; }
+        const u32 expandedId = slots[largestSlot];
+        slots[largestSlot] = nodes[expandedId].lchildId;
+        slots[slotCount++] = nodes[expandedId].lchildId + 1u;
+    }
+
+    WideNode wideNode = {};
+    // unused lanes get inverted bounds, they're masked out during queries
+    f32* minx = (f32*)&wideNode.minx_256; f32* maxx = (f32*)&wideNode.maxx_256;
+    f32* miny = (f32*)&wideNode.miny_256; f32* maxy = (f32*)&wideNode.maxy_256;
+    f32* minz = (f32*)&wideNode.minz_256; f32* maxz = (f32*)&wideNode.maxz_256;
+    for (u32 i = 0; i < 8; i++) {
+        minx[i] = miny[i] = minz[i] = FLT_MAX;
+        maxx[i] = maxy[i] = maxz[i] = -FLT_MAX;
+    }
+    wideNode.childCount = (u8)slotCount;
+    for (u32 i = 0; i < slotCount; i++) {
+        const Node& child = nodes[slots[i]];
+        minx[i] = child.min.x; miny[i] = child.min.y; minz[i] = child.min.z;
+        maxx[i] = child.max.x; maxy[i] = child.max.y; maxz[i] = child.max.z;
+        if (child.isLeaf) {
+            wideNode.leafMask |= 1 << i;
+            wideNode.children[i] = child.sourceId;
+        }
+    }
+
+    // As in buildTreeRecursive, the buffer may move during the recursion,
+    // so we only access the node by index
+    const u32 wideNodeId = (u32)wideNodes.len;
+    allocator::push(wideNodes, persistentArena) = wideNode;
+    for (u32 i = 0; i < slotCount; i++) {
+        if (nodes[slots[i]].isLeaf) { continue; }
+        const u32 childId = collapseTreeRecursive(wideNodes, persistentArena, nodes, slots[i]);
+        wideNodes.data[wideNodeId].children[i] = (Index)childId;
+    }
+    return wideNodeId;
+}
+// Children are always stored after their parents (both in the serial and the parallel builds),
+// so walking the node array backwards visits the tree bottom-up.
+// Computes the normalized SAH cost of each subtree, sum(area(n)) / area(root), from nodes in
+// min/max form. The cost is stored as the node's buildCost if the node is set in storeMask
+// (or for all nodes if there's no mask), and the ratio to the stored buildCost is returned
+// in costRatios, if provided
+void updateSubtreeCosts(
+allocator::PagedArena scratchArena, Node* nodes, const u32 nodeCount,
+const bool* storeMask, f32* costRatios = nullptr) {
+    f32* areaSums = ALLOC_ARRAY(scratchArena, f32, nodeCount);
+    for (s32 n = nodeCount - 1; n >= 0; n--) {
+        Node& node = nodes[n];
+        const f32 area = halfSurfaceArea(node.min, node.max);
+        areaSums[n] = area;
+        if (!node.isLeaf) { areaSums[n] += areaSums[node.lchildId] + areaSums[node.lchildId + 1]; }
+        const f32 cost = area > 0.f ? areaSums[n] / area : 1.f;
+        if (!storeMask || storeMask[n]) { node.buildCost = cost; }
+        if (costRatios) { costRatios[n] = node.buildCost > 0.f ? cost / node.buildCost : 1.f; }
+    }
+}
+void loadQueryRegisters(Node* nodes, const u32 nodeCount) {
+    for (u32 n = 0; n < nodeCount; n++) {
+        Node& node = nodes[n];
+        minmax_to_ymm(
+            node.xcoords_256, node.ycoords_256, node.zcoords_256,
+            node.min, node.max);
+    };
 }
-void buildTree(
+// Without keepBinaryNodes, the binary tree is built in the scratch arena and only the wide
+// nodes are stored in the persistent one
+// Returns false, leaving the tree empty, if the mesh doesn't fit the index width
+bool buildTree(
 allocator::PagedArena& persistentArena, allocator::PagedArena scratchArena,
-Tree& bvh, f32* vertexPool, const u16* indexPool, const u32 indexCount,
-const u32* sourceIds) {
+Tree& bvh, f32* vertexPool, const Index* indexPool, const u32 indexCount,
+const u32* sourceIds, const BuildMode::Enum mode, const bool keepBinaryNodes) {
 
+    bvh = {};
     u32 triangleCount = indexCount / 3;
-    u16* triangleIds = ALLOC_ARRAY(scratchArena, u16, triangleCount);
+    if (triangleCount == 0) { return true; }
+    // a binary tree with one triangle per leaf has 2n-1 nodes
+    if (indexCount > maxIndex || 2 * triangleCount - 1 > maxIndex) {
+        char text[256];
+        io::format(
+            text, sizeof(text),
+            "bvh: %u triangles don't fit %u bit indices, define __BVH_WIDE_INDICES to build it\n",
+            triangleCount, (u32)sizeof(Index) * 8);
+        consoleLog(text);
+        return false;
+    }
+    Index* triangleIds = ALLOC_ARRAY(scratchArena, Index, triangleCount);
     Triangle* trianglePool = ALLOC_ARRAY(scratchArena, Triangle, triangleCount);
 
+    allocator::PagedArena& nodeArena = keepBinaryNodes ? persistentArena : scratchArena;
     allocator::Buffer<Node> nodes = {};
+    allocator::reserve(nodes, 2 * triangleCount - 1, nodeArena);
     Node root = {};
     emptyNode(root);
     for (u32 triangleId = 0; triangleId < triangleCount; triangleId++) {
         Triangle tri;
-        float3 a(
-            vertexPool[indexPool[triangleId * 3] * 3],
-            vertexPool[indexPool[triangleId * 3] * 3 + 1],
-            vertexPool[indexPool[triangleId * 3] * 3 + 2]);
-        float3 b(
-            vertexPool[indexPool[triangleId * 3 + 1] * 3],
-            vertexPool[indexPool[triangleId * 3 + 1] * 3 + 1],
-            vertexPool[indexPool[triangleId * 3 + 1] * 3 + 2]);
-        float3 c(
-            vertexPool[indexPool[triangleId * 3 + 2] * 3],
-            vertexPool[indexPool[triangleId * 3 + 2] * 3 + 1],
-            vertexPool[indexPool[triangleId * 3 + 2] * 3 + 2]);
-        tri.min = math::min(math::min(a, b), c);
-        tri.max = math::max(math::max(a, b), c);
-        tri.center = math::scale(math::add(tri.max, tri.min), 0.5f);
+        makeTriangle(tri, vertexPool, indexPool, triangleId);
         tri.sourceId = sourceIds[triangleId];
-        tri.firstVertexIndex = triangleId * 3;
         expandNodeBounds(root, tri);
         trianglePool[triangleId] = tri;
         triangleIds[triangleId] = triangleId;
     }
-    allocator::push(nodes, persistentArena) = root;
+    allocator::push(nodes, nodeArena) = root;
 
     BuildTreeContext context = {
         nodes,
-        persistentArena,
+        nodeArena,
         trianglePool,
         vertexPool,
         indexPool,
-        indexCount
+        indexCount,
+        mode
     };
-    buildTreeRecursive(context, triangleIds, triangleCount, 0);
+    if (jobs::pool.workerCount > 1 && triangleCount >= parallelBuildMinTriangles) {
+        // several jobs per worker, so stealing can even out unbalanced subtrees. Uneven SAH splits
+        // can make more tasks than a queue holds, jobs::push runs the extra ones right away
+        const u32 taskTriangleCount = triangleCount / (jobs::pool.workerCount * 8);
+        allocator::Buffer<BuildTreeTask> tasks = {};
+        buildTreeTopRecursive(
+            context, tasks, scratchArena, triangleIds, triangleCount, 0, taskTriangleCount);
+        jobs::Counter counter = {};
+        for (u32 i = 0; i < (u32)tasks.len; i++) {
+            tasks.data[i].nodes.data = nodes.data;
+            jobs::push(counter, buildTreeTask, &tasks.data[i], scratchArena);
+        }
+        jobs::wait(counter, scratchArena);
+    } else {
+        buildTreeRecursive(context, triangleIds, triangleCount, 0);
+    }
 
-    // Now that the bounds are set, load them into 256 registers so the queries run faster
-    for (u32 n = 0; n < (u32)nodes.len; n++) {
-        Node& node = nodes.data[n];
-        minmax_to_ymm(
-            node.xcoords_256, node.ycoords_256, node.zcoords_256,
-            node.min, node.max);
+    updateSubtreeCosts(scratchArena, nodes.data, (u32)nodes.len, nullptr);
+
+    // every wide node expands a different internal node, so refits that collapse differently
+    // never need more than one per internal node
+    allocator::Buffer<WideNode> wideNodes = {};
+    const u32 wideNodeReserve = keepBinaryNodes ? math::max(triangleCount - 1, 1u) : ((u32)nodes.len + 6) / 7;
+    allocator::reserve(wideNodes, wideNodeReserve, persistentArena);
+    collapseTreeRecursive(wideNodes, persistentArena, nodes.data, 0);
+
+    if (keepBinaryNodes) {
+        // Now that the bounds are set, load them into 256 registers so the queries run faster
+        loadQueryRegisters(nodes.data, (u32)nodes.len);
+        bvh.nodes = nodes.data;
+        bvh.nodeCount = (u32)nodes.len;
+    }
+    bvh.wideNodes = wideNodes.data;
+    bvh.wideNodeCount = (u32)wideNodes.len;
+    bvh.wideNodeCap = (u32)wideNodes.cap;
+    return true;
+}
+
+// Rebuilds the subtree under nodeId in place, from nodes in min/max form. The node's
+// descendants are stored contiguously after its left child, and a subtree over the same
+// triangles has the same node count, so the rebuild reuses the same range of the array
+// Returns the number of nodes in the subtree
+u32 rebuildSubtree(
+allocator::PagedArena scratchArena, Node* nodes, const u32 nodeCount, const u32 nodeId,
+const f32* vertexPool, const Index* indexPool, const BuildMode::Enum mode) {
+    const u32 triangleCount = (nodeCount + 1) / 2;
+    Triangle* trianglePool = ALLOC_ARRAY(scratchArena, Triangle, triangleCount);
+    Index* triangleIds = ALLOC_ARRAY(scratchArena, Index, triangleCount);
+    Index* nodeStack = ALLOC_ARRAY(scratchArena, Index, nodeCount);
+    u32 subtreeTriangleCount = 0;
+    u32 stackCount = 0;
+    nodeStack[stackCount++] = (Index)nodeId;
+    while (stackCount > 0) {
+        const Node& node = nodes[nodeStack[--stackCount]];
+        if (node.isLeaf) {
+            const u32 triangleId = node.firstIndexId / 3;
+            Triangle& tri = trianglePool[triangleId];
+            makeTriangle(tri, vertexPool, indexPool, triangleId);
+            tri.sourceId = node.sourceId;
+            triangleIds[subtreeTriangleCount++] = (Index)triangleId;
+        } else {
+            nodeStack[stackCount++] = node.lchildId;
+            nodeStack[stackCount++] = Index(node.lchildId + 1u);
+        }
+    }
+    if (subtreeTriangleCount == 1) { return 1; }
+
+    // view over the subtree's range, same as the parallel build tasks
+    allocator::Buffer<Node> subtreeNodes = {};
+    subtreeNodes.data = nodes;
+    subtreeNodes.len = nodes[nodeId].lchildId;
+    subtreeNodes.cap = subtreeNodes.len + 2 * subtreeTriangleCount - 2;
+    BuildTreeContext context = {
+        subtreeNodes,
+        scratchArena, // unused, the range is never grown
+        trianglePool,
+        vertexPool,
+        indexPool,
+        triangleCount * 3,
+        mode
+    };
+    buildTreeRecursive(context, triangleIds, subtreeTriangleCount, nodeId);
+    assert(subtreeNodes.len == subtreeNodes.cap);
+    return 2 * subtreeTriangleCount - 1;
+}
+
+// Updates every node's bounds bottom-up from new vertex positions, keeping the tree topology,
+// in linear time. Refitting degrades the tree as triangles move away from the ones they were
+// grouped with: if maxCostRatio > 0, the topmost subtrees whose normalized SAH cost has grown
+// past maxCostRatio times their cost when built are rebuilt.
+// Returns the number of rebuilt subtrees
+u32 refit(
+allocator::PagedArena& persistentArena, allocator::PagedArena scratchArena,
+Tree& bvh, const f32* vertexPool, const Index* indexPool,
+const f32 maxCostRatio, const BuildMode::Enum mode) {
+    assert(bvh.nodeCount || !bvh.wideNodeCount); // needs the binary tree, see keepBinaryNodes
+    if (bvh.nodeCount == 0) { return 0; }
+
+    // the query registers alias the min/max bounds: recompute every node in min/max form,
+    // children first, and load the registers back at the end
+    Node* nodes = bvh.nodes;
+    for (s32 n = bvh.nodeCount - 1; n >= 0; n--) {
+        Node& node = nodes[n];
+        if (node.isLeaf) {
+            Triangle tri;
+            makeTriangle(tri, vertexPool, indexPool, node.firstIndexId / 3);
+            node.min = tri.min;
+            node.max = tri.max;
+        } else {
+            const Node& lchild = nodes[node.lchildId];
+            const Node& rchild = nodes[node.lchildId + 1];
+            node.min = math::min(lchild.min, rchild.min);
+            node.max = math::max(lchild.max, rchild.max);
+        }
+    }
+
+    u32 rebuiltCount = 0;
+    if (maxCostRatio > 0.f) {
+        bool* rebuilt = ALLOC_ARRAY(scratchArena, bool, bvh.nodeCount);
+        memset(rebuilt, 0, bvh.nodeCount * sizeof(bool));
+        f32* costRatios = ALLOC_ARRAY(scratchArena, f32, bvh.nodeCount);
+        updateSubtreeCosts(scratchArena, nodes, bvh.nodeCount, rebuilt, costRatios);
+
+        Index* nodeStack = ALLOC_ARRAY(scratchArena, Index, bvh.nodeCount);
+        u32 stackCount = 0;
+        nodeStack[stackCount++] = 0;
+        while (stackCount > 0) {
+            const u32 nodeId = nodeStack[--stackCount];
+            const Node& node = nodes[nodeId];
+            if (node.isLeaf) { continue; }
+            if (costRatios[nodeId] > maxCostRatio) {
+                const u32 subtreeNodeCount = rebuildSubtree(
+                    scratchArena, nodes, bvh.nodeCount, nodeId, vertexPool, indexPool, mode);
+                rebuilt[nodeId] = true;
+                memset(&rebuilt[node.lchildId], 1, (subtreeNodeCount - 1) * sizeof(bool));
+                rebuiltCount++;
+            } else {
+                nodeStack[stackCount++] = node.lchildId;
+                nodeStack[stackCount++] = Index(node.lchildId + 1u);
+            }
+        }
+        if (rebuiltCount) {
+            updateSubtreeCosts(scratchArena, nodes, bvh.nodeCount, rebuilt);
+        }
+    }
+
+    // collapse again into the same array: the collapse expands children by area, so the wide node
+    // count can change with the new bounds alone. The array was reserved for the worst case
+    allocator::Buffer<WideNode> wideNodes = {};
+    wideNodes.data = bvh.wideNodes;
+    wideNodes.cap = bvh.wideNodeCap;
+    collapseTreeRecursive(wideNodes, persistentArena, nodes, 0);
+    bvh.wideNodes = wideNodes.data;
+    bvh.wideNodeCount = (u32)wideNodes.len;
+    bvh.wideNodeCap = (u32)wideNodes.cap;
+
+    loadQueryRegisters(nodes, bvh.nodeCount);
+    return rebuiltCount;
+}
+
+// Tree quality metrics, to compare build modes
+// The SAH cost uses unit traversal and intersection costs, relative to the root's area
+struct TreeStats {
+    u32 nodeCount;
+    u32 wideNodeCount;
+    u32 leafCount;
+    u32 maxDepth;
+    f32 sahCost;
+};
+void computeTreeStats(TreeStats& stats, allocator::PagedArena scratchArena, const Tree& bvh) {
+    stats = {};
+    if (bvh.nodeCount == 0) { return; }
+    stats.wideNodeCount = bvh.wideNodeCount;
+
+    struct StatsNode { Index nodeId; u16 depth; };
+    StatsNode* nodeStack = ALLOC_ARRAY(scratchArena, StatsNode, bvh.nodeCount);
+    u32 stackCount = 0;
+    nodeStack[stackCount++] = { 0, 0 };
+
+    float3 min, max;
+    ymm_to_minmax(min, max, bvh.nodes[0].xcoords_256, bvh.nodes[0].ycoords_256, bvh.nodes[0].zcoords_256);
+    const f32 rootArea = halfSurfaceArea(min, max);
+    const f32 invRootArea = rootArea > 0.f ? 1.f / rootArea : 0.f;
+    while (stackCount > 0) {
+        const StatsNode n = nodeStack[--stackCount];
+        const Node& node = bvh.nodes[n.nodeId];
+        ymm_to_minmax(min, max, node.xcoords_256, node.ycoords_256, node.zcoords_256);
+        stats.sahCost += halfSurfaceArea(min, max) * invRootArea;
+        stats.nodeCount++;
+        stats.maxDepth = math::max(stats.maxDepth, (u32)n.depth);
+        if (node.isLeaf) {
+            stats.leafCount++;
+        } else {
+            nodeStack[stackCount++] = { node.lchildId, u16(n.depth + 1u) };
+            nodeStack[stackCount++] = { Index(node.lchildId + 1u), u16(n.depth + 1u) };
+        }
+    }
+}
+
+#if __DEBUG
+// Checks refit against fresh builds, on copies of the tree and the vertices:
+// - refitting to the vertices the tree was built from gives back the built bounds and wide nodes,
+//   collapsed into the same wide array
+// - after swapping triangles around, every node still bounds its children, and the root
+//   matches a fresh build over the swapped triangles, with or without partial rebuilds
+// Returns the number of subtrees rebuilt after the swap, and the SAH costs of the tree refit
+// without rebuilds, with partial rebuilds, and built from scratch, in that order
+u32 validateRefit(
+f32 sahCosts[3], allocator::PagedArena scratchArena, const Tree& bvh,
+const f32* vertexPool, const Index* indexPool, const u32 indexCount,
+const u32* sourceIds, const f32 maxCostRatio, const BuildMode::Enum mode) {
+    if (bvh.nodeCount == 0) { return 0; }
+
+    // the four trees are stored in their own block, so that their arena doesn't overlap the
+    // scratch copies that refit and buildTree make. A tree has fewer wide nodes than binary nodes
+    const size_t treeBytes =
+        4 * bvh.nodeCount * (sizeof(Node) + sizeof(WideNode)) + 8 * alignof(Node);
+    u8* treeBlock = ALLOC_ARRAY(scratchArena, u8, treeBytes);
+    allocator::PagedArena treeArena = { treeBlock, treeBlock + treeBytes, nullptr };
+    auto copyTree = [&](Tree& copy, const u32 wideNodeCap) {
+        copy = bvh;
+        copy.nodes = ALLOC_ARRAY(treeArena, Node, bvh.nodeCount);
+        memcpy(copy.nodes, bvh.nodes, sizeof(Node) * bvh.nodeCount);
+        copy.wideNodes = ALLOC_ARRAY(treeArena, WideNode, wideNodeCap);
+        memcpy(copy.wideNodes, bvh.wideNodes, sizeof(WideNode) * bvh.wideNodeCount);
+        copy.wideNodeCap = wideNodeCap;
     };
+    auto checkBounds = [](const Tree& tree) {
+        for (u32 n = 0; n < tree.nodeCount; n++) {
+            const Node& node = tree.nodes[n];
+            if (node.isLeaf) { continue; }
+            const Node* children[2] = {
+                &tree.nodes[node.lchildId], &tree.nodes[node.lchildId + 1] };
+            float3 min, max, childMin, childMax;
+            ymm_to_minmax(min, max, node.xcoords_256, node.ycoords_256, node.zcoords_256);
+            for (u32 c = 0; c < 2; c++) {
+                ymm_to_minmax(
+                    childMin, childMax,
+                    children[c]->xcoords_256, children[c]->ycoords_256, children[c]->zcoords_256);
+                assert(min.x <= childMin.x && min.y <= childMin.y && min.z <= childMin.z);
+                assert(max.x >= childMax.x && max.y >= childMax.y && max.z >= childMax.z);
+            }
+        }
+    };
+
+    // refit to the same vertices, the array has exactly the capacity it was built with
+    {
+        Tree refitted;
+        copyTree(refitted, bvh.wideNodeCap);
+        const WideNode* wideNodes = refitted.wideNodes;
+        const u32 rebuiltCount =
+            refit(treeArena, scratchArena, refitted, vertexPool, indexPool, maxCostRatio, mode);
+        assert(rebuiltCount == 0 && refitted.wideNodes == wideNodes);
+        assert(refitted.wideNodeCount == bvh.wideNodeCount);
+        for (u32 n = 0; n < bvh.nodeCount; n++) {
+            assert(memcmp(
+                &refitted.nodes[n].xcoords_256, &bvh.nodes[n].xcoords_256,
+                3 * sizeof(__m256)) == 0);
+        }
+        for (u32 n = 0; n < bvh.wideNodeCount; n++) {
+            const WideNode& a = refitted.wideNodes[n];
+            const WideNode& b = bvh.wideNodes[n];
+            assert(memcmp(&a, &b, offsetof(WideNode, children)) == 0);
+            assert(memcmp(a.children, b.children, sizeof(a.children)) == 0);
+            assert(a.childCount == b.childCount && a.leafMask == b.leafMask);
+        }
+        (void)rebuiltCount;
+    }
 
-    bvh.nodes = nodes.data;
-    bvh.nodeCount = (u32)nodes.len;
+    // Unshare the vertices, so that triangles can move on their own, and swap every other leaf
+    // of the root's left subtree with one from the other half of it. Siblings end up far apart and
+    // their parents overlap, which a rebuild of that subtree fixes. The right subtree is untouched
+    f32* movedVertices = ALLOC_ARRAY(scratchArena, f32, indexCount * 3);
+    Index* movedIndices = ALLOC_ARRAY(scratchArena, Index, indexCount);
+    for (u32 i = 0; i < indexCount; i++) {
+        memcpy(&movedVertices[i * 3], &vertexPool[indexPool[i] * 3], sizeof(f32) * 3);
+        movedIndices[i] = (Index)i;
+    }
+    if (!bvh.nodes[0].isLeaf) {
+        Index* leaves = ALLOC_ARRAY(scratchArena, Index, bvh.nodeCount);
+        Index* nodeStack = ALLOC_ARRAY(scratchArena, Index, bvh.nodeCount);
+        u32 leafCount = 0;
+        u32 stackCount = 0;
+        nodeStack[stackCount++] = bvh.nodes[0].lchildId;
+        while (stackCount > 0) {
+            const Node& node = bvh.nodes[nodeStack[--stackCount]];
+            if (node.isLeaf) {
+                leaves[leafCount++] = Index(node.firstIndexId / 3);
+            } else {
+                nodeStack[stackCount++] = Index(node.lchildId + 1u);
+                nodeStack[stackCount++] = node.lchildId;
+            }
+        }
+        for (u32 i = 1; i < leafCount / 2; i += 2) {
+            f32* a = &movedVertices[leaves[i] * 9];
+            f32* b = &movedVertices[leaves[i + leafCount / 2] * 9];
+            f32 tmp[9];
+            memcpy(tmp, a, sizeof(tmp)); memcpy(a, b, sizeof(tmp)); memcpy(b, tmp, sizeof(tmp));
+        }
+    }
+    Tree refitOnly, partial, fresh = {};
+    copyTree(refitOnly, bvh.wideNodeCap);
+    refit(treeArena, scratchArena, refitOnly, movedVertices, movedIndices, 0.f, mode);
+    copyTree(partial, bvh.nodeCount);
+    const u32 rebuiltCount =
+        refit(treeArena, scratchArena, partial, movedVertices, movedIndices, maxCostRatio, mode);
+    buildTree(
+        treeArena, scratchArena, fresh, movedVertices, movedIndices, indexCount, sourceIds, mode, true);
+    assert(treeArena.curr <= treeBlock + treeBytes);
+    checkBounds(refitOnly);
+    checkBounds(partial);
+    // the root bounds all triangles, whatever the topology
+    assert(memcmp(
+        &partial.nodes[0].xcoords_256, &fresh.nodes[0].xcoords_256, 3 * sizeof(__m256)) == 0);
+    assert(memcmp(
+        &refitOnly.nodes[0].xcoords_256, &fresh.nodes[0].xcoords_256, 3 * sizeof(__m256)) == 0);
+
+    const Tree* trees[3] = { &refitOnly, &partial, &fresh };
+    for (u32 i = 0; i < 3; i++) {
+        TreeStats stats;
+        computeTreeStats(stats, scratchArena, *trees[i]);
+        sahCosts[i] = stats.sahCost;
+    }
+    return rebuiltCount;
 }
+#endif
 
 struct FrustumStatus { enum Enum { In, Intersecting, Out }; };
+struct Frustum_256Signs { bool x, y, z; };
 FrustumStatus::Enum queryIsBoxVisibleInFrustum_256(
     const m256_4* planes, const u32 numPlanes, const __m256 vx, const __m256 vy, const __m256 vz) {
 
@@ -237,7 +859,7 @@ void findTrianglesIntersectingFrustum(
     allocator::PagedArena scratchArena,
     bool* sourceVisibility, const Tree & bvh,
     const m256_4* planes_256, const u32 numPlanes) {
-    struct FrustumQueryNode { u16 nodeId; FrustumStatus::Enum frustumStatus; };
+    struct FrustumQueryNode { Index nodeId; FrustumStatus::Enum frustumStatus; };
 
     FrustumQueryNode* nodeStack = ALLOC_ARRAY(scratchArena, FrustumQueryNode, bvh.nodeCount);
     u32 stackCount = 0;
@@ -259,7 +881,7 @@ void findTrianglesIntersectingFrustum(
             if (n.frustumStatus == FrustumStatus::In) {
                 lStatus = rStatus = n.frustumStatus;
                 nodeStack[stackCount++] = { bvh.nodes[n.nodeId].lchildId, lStatus };
-                nodeStack[stackCount++] = { u16(bvh.nodes[n.nodeId].lchildId + 1u), rStatus };
+                nodeStack[stackCount++] = { Index(bvh.nodes[n.nodeId].lchildId + 1u), rStatus };
             } else {
                 // test each child against the frustum, cull if fully not visible
                 lStatus = queryIsBoxVisibleInFrustum_256(
@@ -270,13 +892,82 @@ void findTrianglesIntersectingFrustum(
                     nodeStack[stackCount++] = { bvh.nodes[n.nodeId].lchildId, lStatus };
                 }
                 if (rStatus != FrustumStatus::Out) {
-                    nodeStack[stackCount++] = { u16(bvh.nodes[n.nodeId].lchildId + 1u), rStatus };
+                    nodeStack[stackCount++] = { Index(bvh.nodes[n.nodeId].lchildId + 1u), rStatus };
                 }
             }
         }
     }
 }
 
+// Classifies the 8 children of a wide node against the frustum, using the corner
+// closest to and furthest from each plane. Returns the bitmask of children
+// fully outside, and the bitmask of those intersecting any plane
+force_inline void queryAreChildrenVisibleInFrustum_256(
+    u32& outMask, u32& intersectingMask,
+    const WideNode& node, const m256_4* planes, const Frustum_256Signs* signs, const u32 numPlanes) {
+    outMask = 0;
+    intersectingMask = 0;
+    for (u32 p = 0; p < numPlanes; p++) {
+        const __m256 farx = signs[p].x ? node.maxx_256 : node.minx_256;
+        const __m256 fary = signs[p].y ? node.maxy_256 : node.miny_256;
+        const __m256 farz = signs[p].z ? node.maxz_256 : node.minz_256;
+        const __m256 nearx = signs[p].x ? node.minx_256 : node.maxx_256;
+        const __m256 neary = signs[p].y ? node.miny_256 : node.maxy_256;
+        const __m256 nearz = signs[p].z ? node.minz_256 : node.maxz_256;
+        const __m256 fardot = _mm256_fmadd_ps(farz, planes[p].vz,
+            _mm256_fmadd_ps(fary, planes[p].vy, _mm256_fmadd_ps(farx, planes[p].vx, planes[p].vw)));
+        const __m256 neardot = _mm256_fmadd_ps(nearz, planes[p].vz,
+            _mm256_fmadd_ps(neary, planes[p].vy, _mm256_fmadd_ps(nearx, planes[p].vx, planes[p].vw)));
+        outMask |= _mm256_movemask_ps(fardot);
+        intersectingMask |= _mm256_movemask_ps(neardot);
+    }
+    const u32 childMask = (1u << node.childCount) - 1;
+    outMask &= childMask;
+    intersectingMask &= childMask & ~outMask;
+}
+
+void findTrianglesIntersectingFrustum_wide(
+    allocator::PagedArena scratchArena,
+    bool* sourceVisibility, const Tree & bvh,
+    const m256_4* planes_256, const u32 numPlanes) {
+    struct FrustumQueryNode { Index nodeId; FrustumStatus::Enum frustumStatus; };
+
+    // cache which corner of each box is furthest along each plane's normal
+    Frustum_256Signs* signs = ALLOC_ARRAY(scratchArena, Frustum_256Signs, numPlanes);
+    for (u32 p = 0; p < numPlanes; p++) {
+        signs[p].x = ((f32*)&planes_256[p].vx)[0] >= 0.f;
+        signs[p].y = ((f32*)&planes_256[p].vy)[0] >= 0.f;
+        signs[p].z = ((f32*)&planes_256[p].vz)[0] >= 0.f;
+    }
+
+    FrustumQueryNode* nodeStack = ALLOC_ARRAY(scratchArena, FrustumQueryNode, bvh.wideNodeCount);
+    u32 stackCount = 0;
+    nodeStack[stackCount++] = { 0, FrustumStatus::Intersecting };
+
+    while (stackCount > 0) {
+        FrustumQueryNode n = nodeStack[--stackCount];
+        const WideNode& node = bvh.wideNodes[n.nodeId];
+        // if the parent node was fully visible in the frustum,
+        // add the children without testing, and propagate the frustum result
+        u32 outMask = 0, intersectingMask = 0;
+        if (n.frustumStatus != FrustumStatus::In) {
+            queryAreChildrenVisibleInFrustum_256(
+                outMask, intersectingMask, node, planes_256, signs, numPlanes);
+        }
+        for (u32 i = 0; i < node.childCount; i++) {
+            const u32 childBit = 1 << i;
+            if (outMask & childBit) { continue; }
+            if (node.leafMask & childBit) {
+                sourceVisibility[node.children[i]] = true;
+            } else {
+                FrustumStatus::Enum status =
+                    (intersectingMask & childBit) ? FrustumStatus::Intersecting : FrustumStatus::In;
+                nodeStack[stackCount++] = { node.children[i], status };
+            }
+        }
+    }
+}
+
 }; // namespace BVH
 
 #endif // __WASTELADNS_BVH_H__
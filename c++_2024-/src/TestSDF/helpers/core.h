@@ -5,6 +5,7 @@
 #include <math.h>
 #include <stdlib.h> // rand, mbstowcs_s
 #include <stdint.h> // int8_t, int16_t, int32_t, etc
+#include <stddef.h> // size_t, ptrdiff_t
 #include <assert.h>
 #include <stdio.h> // printf
 
@@ -12,9 +13,11 @@
 #include "core_win.h"
 #elif __MACOS
 #include "core_mac.h"
+#elif __LINUX
+#include "core_linux.h"
 #endif
 
-#if __DEBUG
+#if __DEBUG || __COOK_ASSETS
  // for last time modified file queries
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -42,6 +45,8 @@ typedef double f64;
 #define force_inline __forceinline
 #elif __clang__
 # define force_inline __attribute__((always_inline))
+#elif __GNUC__
+# define force_inline inline __attribute__((always_inline))
 #endif
 
 #if _MSC_VER
@@ -63,4 +68,35 @@ struct m256_4 {
     __m256 vw;
 };
 
+// sequentially consistent atomics, add returns the previous value
+namespace atomic {
+#if _MSC_VER
+force_inline s32 add(volatile s32* v, s32 value) { return _InterlockedExchangeAdd((volatile long*)v, value); }
+force_inline s64 add(volatile s64* v, s64 value) { return _InterlockedExchangeAdd64((volatile long long*)v, value); }
+force_inline s32 compare_exchange(volatile s32* v, s32 desired, s32 expected) {
+    return _InterlockedCompareExchange((volatile long*)v, desired, expected); }
+force_inline s64 compare_exchange(volatile s64* v, s64 desired, s64 expected) {
+    return _InterlockedCompareExchange64((volatile long long*)v, desired, expected); }
+force_inline s32 load(volatile s32* v) { return _InterlockedOr((volatile long*)v, 0); }
+force_inline s64 load(volatile s64* v) { return _InterlockedOr64((volatile long long*)v, 0); }
+force_inline void store(volatile s32* v, s32 value) { _InterlockedExchange((volatile long*)v, value); }
+force_inline void store(volatile s64* v, s64 value) { _InterlockedExchange64((volatile long long*)v, value); }
+#else
+force_inline s32 add(volatile s32* v, s32 value) { return __atomic_fetch_add(v, value, __ATOMIC_SEQ_CST); }
+force_inline s64 add(volatile s64* v, s64 value) { return __atomic_fetch_add(v, value, __ATOMIC_SEQ_CST); }
+force_inline s32 compare_exchange(volatile s32* v, s32 desired, s32 expected) {
+    __atomic_compare_exchange_n(v, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected; }
+force_inline s64 compare_exchange(volatile s64* v, s64 desired, s64 expected) {
+    __atomic_compare_exchange_n(v, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected; }
+force_inline s32 load(volatile s32* v) { return __atomic_load_n(v, __ATOMIC_SEQ_CST); }
+force_inline s64 load(volatile s64* v) { return __atomic_load_n(v, __ATOMIC_SEQ_CST); }
+force_inline void store(volatile s32* v, s32 value) { __atomic_store_n(v, value, __ATOMIC_SEQ_CST); }
+force_inline void store(volatile s64* v, s64 value) { __atomic_store_n(v, value, __ATOMIC_SEQ_CST); }
+#endif
+force_inline void lock(volatile s32* v) { while (compare_exchange(v, 1, 0) != 0) { _mm_pause(); } }
+force_inline void unlock(volatile s32* v) { store(v, 0); }
+}
+
 #endif // __WASTELADNS_CORE_H__
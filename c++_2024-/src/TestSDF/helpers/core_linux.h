@@ -0,0 +1,72 @@
+#ifndef __WASTELADNS_CORE_LINUX_H__
+#define __WASTELADNS_CORE_LINUX_H__
+
+#include <string.h> // memcpy, memset, strlen
+#include <stdarg.h> // va_list
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <fcntl.h> // open
+#include <unistd.h> // sysconf
+#include <time.h> // clock_gettime, nanosleep
+#include <pthread.h>
+#include <semaphore.h>
+
+#define consoleLog(a) printf("%s", a)
+
+typedef int errno_t; // not exposed by glibc
+
+namespace platform {
+
+#if __NULLRHI
+const char* name = "LINUX+NULL";
+#endif
+
+void* mem_reserve(size_t size) {
+    return mmap(0, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+}
+void mem_commit(void* ptr, size_t size) { /* no-op, OS will commit memory pages as needed */ }
+
+struct Thread {
+    void (*func)(void*);
+    void* data;
+    pthread_t handle;
+};
+void* thread_entry(void* param) {
+    Thread& thread = *(Thread*)param;
+    thread.func(thread.data);
+    return nullptr;
+}
+void thread_start(Thread& thread) { pthread_create(&thread.handle, nullptr, thread_entry, &thread); }
+typedef sem_t Semaphore;
+void semaphore_init(Semaphore& s) { sem_init(&s, 0, 0); }
+void semaphore_signal(Semaphore& s, int count) { while (count-- > 0) { sem_post(&s); } }
+void semaphore_wait(Semaphore& s) { while (sem_wait(&s) != 0) {} } // retry on EINTR
+int core_count() { return (int)sysconf(_SC_NPROCESSORS_ONLN); }
+double time_seconds() { // monotonic
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+// read only file contents, mapped copy-on-write so they can be patched in place
+struct MappedFile {
+    void* data;
+    size_t size;
+};
+bool file_map(MappedFile& file, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    file = {};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(0, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) { file.data = data; file.size = st.st_size; }
+    }
+    close(fd); // the mapping keeps its own reference to the file
+    return file.data != nullptr;
+}
+void file_unmap(MappedFile& file) { munmap(file.data, file.size); file = {}; }
+}
+
+#define __popcnt __builtin_popcount
+
+#endif // __WASTELADNS_CORE_LINUX_H__
@@ -12,6 +12,10 @@
 #import <Cocoa/Cocoa.h>
 #import <mach/mach_time.h> // for mach_absolute_time
 #import <IOKit/hid/IOHIDLib.h>
+#import <pthread.h>
+#import <dispatch/dispatch.h> // dispatch_semaphore
+#import <sys/stat.h> // fstat
+#import <fcntl.h> // open
 
 #define consoleLog(a) printf("%s", a)
 
@@ -23,6 +27,46 @@ void* mem_reserve(size_t size) {
     return mmap(0, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
 }
 void mem_commit(void* ptr, size_t size) { /* no-op, OS will commit memory pages as needed */ }
+
+struct Thread {
+    void (*func)(void*);
+    void* data;
+    pthread_t handle;
+};
+void* thread_entry(void* param) {
+    Thread& thread = *(Thread*)param;
+    thread.func(thread.data);
+    return nullptr;
+}
+void thread_start(Thread& thread) { pthread_create(&thread.handle, nullptr, thread_entry, &thread); }
+typedef dispatch_semaphore_t Semaphore;
+void semaphore_init(Semaphore& s) { s = dispatch_semaphore_create(0); }
+void semaphore_signal(Semaphore& s, int count) { while (count-- > 0) { dispatch_semaphore_signal(s); } }
+void semaphore_wait(Semaphore& s) { dispatch_semaphore_wait(s, DISPATCH_TIME_FOREVER); }
+int core_count() { return (int)sysconf(_SC_NPROCESSORS_ONLN); }
+double time_seconds() { // monotonic
+    mach_timebase_info_data_t ticks_to_nanos;
+    mach_timebase_info(&ticks_to_nanos);
+    return mach_absolute_time() * ticks_to_nanos.numer / (1e9 * ticks_to_nanos.denom);
+}
+// read only file contents, mapped copy-on-write so they can be patched in place
+struct MappedFile {
+    void* data;
+    size_t size;
+};
+bool file_map(MappedFile& file, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    file = {};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(0, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) { file.data = data; file.size = st.st_size; }
+    }
+    close(fd); // the mapping keeps its own reference to the file
+    return file.data != nullptr;
+}
+void file_unmap(MappedFile& file) { munmap(file.data, file.size); file = {}; }
 }
 
 #define __popcnt __builtin_popcount
@@ -19,6 +19,8 @@
 #include <timeapi.h> // for timeBeginPeriod // Wall time: 1.123ms
 #include <synchapi.h> // for Sleep // Wall time: 1.737ms
 #include <memoryapi.h> // for VirtualAlloc // Wall time: 2.469ms
+#include <fileapi.h> // for CreateFileA
+#include <handleapi.h> // for CloseHandle
 
 #if __DX11
     // types defined by winuser.h->libloaderapi.h->minwinbase.h,
@@ -54,6 +56,7 @@
 #include <profileapi.h> // QueryPerformance funcs
 #include <debugapi.h> // OutputDebugString
 #include <sysinfoapi.h> // GetSystemInfo and SYSTEM_INFO::dwPageSize
+#include <processthreadsapi.h> // CreateThread
 
 // end of of windows shenanigans ----------------------------------------------------------------------
 
@@ -62,5 +65,59 @@
 namespace platform {
 void* mem_reserve(size_t size) { return VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS); }
 void mem_commit(void* ptr, size_t size) { VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE); }
+
+struct Thread {
+    void (*func)(void*);
+    void* data;
+    HANDLE handle;
+};
+DWORD WINAPI thread_entry(LPVOID param) {
+    Thread& thread = *(Thread*)param;
+    thread.func(thread.data);
+    return 0;
+}
+void thread_start(Thread& thread) { thread.handle = CreateThread(0, 0, thread_entry, &thread, 0, 0); }
+typedef HANDLE Semaphore;
+void semaphore_init(Semaphore& s) { s = CreateSemaphoreExW(0, 0, 0x7fffffff, 0, 0, SEMAPHORE_ALL_ACCESS); }
+void semaphore_signal(Semaphore& s, int count) { ReleaseSemaphore(s, count, 0); }
+void semaphore_wait(Semaphore& s) { WaitForSingleObject(s, INFINITE); }
+int core_count() { SYSTEM_INFO info; GetSystemInfo(&info); return (int)info.dwNumberOfProcessors; }
+double time_seconds() { // monotonic
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return counter.QuadPart / (double)frequency.QuadPart;
+}
+// read only file contents, mapped copy-on-write so they can be patched in place
+struct MappedFile {
+    void* data;
+    size_t size;
+    HANDLE file;
+    HANDLE mapping;
+};
+bool file_map(MappedFile& file, const char* path) {
+    file = {};
+    file.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file.file == INVALID_HANDLE_VALUE) { file = {}; return false; }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file.file, &size) && size.QuadPart > 0) {
+        file.mapping = CreateFileMappingW(file.file, 0, PAGE_WRITECOPY, 0, 0, 0);
+        if (file.mapping) { file.data = MapViewOfFile(file.mapping, FILE_MAP_COPY, 0, 0, 0); }
+    }
+    if (!file.data) {
+        if (file.mapping) { CloseHandle(file.mapping); }
+        CloseHandle(file.file);
+        file = {};
+        return false;
+    }
+    file.size = (size_t)size.QuadPart;
+    return true;
+}
+void file_unmap(MappedFile& file) {
+    UnmapViewOfFile(file.data);
+    CloseHandle(file.mapping);
+    CloseHandle(file.file);
+    file = {};
+}
 }
 #endif // __WASTELADNS_CORE_WIN64_H__
@@ -30,7 +30,7 @@ struct PS_src {
         ps_params.shader_length = countof(shader::g_PS); \
         __DEBUGDEF(ps_params.srcFile = shader::srcFile;) \
         __DEBUGDEF(ps_params.binFile = shader::binFile;)
-#elif __GL33
+#elif __GL33 || __NULLRHI // the null backend takes the gl33 sources, never compiled
 #include "shader_src_gl33/shader_output_gl33.h"
 #define POPULATE_SHADER_PARAMS(params, shader) \
         params.shader_name = shader::name; \
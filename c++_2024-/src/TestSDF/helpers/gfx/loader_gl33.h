@@ -288,6 +288,8 @@ typedef void (APIENTRYP PFNGLGETATTACHEDSHADERSPROC)(GLuint program, GLsizei max
 PFNGLGETATTACHEDSHADERSPROC glGetAttachedShaders = nullptr;
 typedef void (APIENTRYP PFNGLGENBUFFERSPROC)(GLsizei n, GLuint* buffers);
 PFNGLGENBUFFERSPROC glGenBuffers = nullptr;
+typedef void (APIENTRYP PFNGLDELETEBUFFERSPROC)(GLsizei n, const GLuint* buffers);
+PFNGLDELETEBUFFERSPROC glDeleteBuffers = nullptr;
 typedef void (APIENTRYP PFNGLBINDBUFFERPROC)(GLenum target, GLuint buffer);
 PFNGLBINDBUFFERPROC glBindBuffer = nullptr;
 typedef void (APIENTRYP PFNGLBUFFERDATAPROC)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
@@ -403,6 +405,7 @@ void loadGLExtensions() {
     glUseProgram = (PFNGLUSEPROGRAMPROC)getGLProcAddress("glUseProgram");
     glGetAttachedShaders = (PFNGLGETATTACHEDSHADERSPROC)getGLProcAddress("glGetAttachedShaders");
     glGenBuffers = (PFNGLGENBUFFERSPROC)getGLProcAddress("glGenBuffers");
+    glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)getGLProcAddress("glDeleteBuffers");
     glBindBuffer = (PFNGLBINDBUFFERPROC)getGLProcAddress("glBindBuffer");
     glBufferData = (PFNGLBUFFERDATAPROC)getGLProcAddress("glBufferData");
     glGetAttribLocation = (PFNGLGETATTRIBLOCATIONPROC)getGLProcAddress("glGetAttribLocation");
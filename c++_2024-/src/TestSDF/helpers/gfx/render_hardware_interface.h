@@ -91,6 +91,13 @@ struct TextureFromFileParams {
     const char* path;
 };
 void create_texture_from_file(RscTexture& t, const TextureFromFileParams& params);
+struct TextureFromMemoryParams {
+    const u8* data; // 4 components per pixel, as decoded by stbi_load_arena
+    s32 width;
+    s32 height;
+    s32 channels; // in the source image
+};
+void create_texture_from_memory(RscTexture& t, const TextureFromMemoryParams& params);
 struct TextureRenderTargetCreateParams {
     s32 width;
     s32 height;
@@ -229,6 +236,7 @@ struct CBufferCreateParams {
     u32 byteWidth;
 };
 void create_cbuffer(RscCBuffer& cb, const CBufferCreateParams& params);
+void destroy_cbuffer(RscCBuffer& cb);
 force_inline void update_cbuffer(RscCBuffer& cb, const void* data);
 force_inline void bind_cbuffers(const RscShaderSet& ss, const RscCBuffer* cb, const u32 count);
 
@@ -249,6 +257,8 @@ force_inline void end_event() {}
 #include "rhi_dx11.h"
 #elif __GL33
 #include "rhi_gl33.h"
+#elif __NULLRHI
+#include "rhi_null.h"
 #endif
 
 #endif // __WASTELADNS_RHI_H__
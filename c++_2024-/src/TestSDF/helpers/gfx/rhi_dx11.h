@@ -307,9 +307,9 @@ void set_VP(const ViewportParams& params) {
     d3dcontext->RSSetViewports(1, &viewport);
 }
 
-void create_texture_from_file(RscTexture& t, const TextureFromFileParams& params) {
-    s32 w, h, channels;
-    u8* data = stbi_load_arena(params.path, &w, &h, &channels, 4, params.arena);
+void create_texture_from_memory(RscTexture& t, const TextureFromMemoryParams& params) {
+    const s32 w = params.width, h = params.height, channels = params.channels;
+    const u8* data = params.data;
     if (data) {
         DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
         u32 typeSize = 4;
@@ -392,9 +392,13 @@ void create_texture_from_file(RscTexture& t, const TextureFromFileParams& params
         samplerDesc.MaxLOD = maxlod;
 
         d3ddev->CreateSamplerState(&samplerDesc, &t.samplerState);
-        stbi_image_free(data);
     }
 }
+void create_texture_from_file(RscTexture& t, const TextureFromFileParams& params) {
+    s32 w, h, channels;
+    u8* data = stbi_load_arena(params.path, &w, &h, &channels, 4, params.arena);
+    create_texture_from_memory(t, { data, w, h, channels });
+}
 void create_texture_empty(RscTexture& t, const TextureRenderTargetCreateParams& params) {
 
     DXGI_FORMAT format = (DXGI_FORMAT)params.format;
@@ -725,6 +729,10 @@ void create_cbuffer(RscCBuffer& cb, const CBufferCreateParams& params) {
 
     cb.impl = bufferObject;
 }
+void destroy_cbuffer(RscCBuffer& cb) {
+    if (cb.impl) { cb.impl->Release(); }
+    cb.impl = nullptr;
+}
 void update_cbuffer(RscCBuffer& cb, const void* data) {
     d3dcontext->UpdateSubresource(cb.impl, 0, nullptr, data, 0, 0); // todo: this should probably be map/unmap
 }
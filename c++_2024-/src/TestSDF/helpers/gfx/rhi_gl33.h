@@ -227,9 +227,9 @@ void set_VP(const ViewportParams& params) {
     glViewport((GLint)params.topLeftX, (GLint)params.topLeftY, (GLsizei)params.width, (GLsizei)params.height);
 }
     
-void create_texture_from_file(RscTexture& t, const TextureFromFileParams& params) {
-    s32 w, h, channels;
-    u8* data = stbi_load_arena(params.path, &w, &h, &channels, 4, params.arena);
+void create_texture_from_memory(RscTexture& t, const TextureFromMemoryParams& params) {
+    const s32 w = params.width, h = params.height, channels = params.channels;
+    const u8* data = params.data;
     if (data) {
         GLenum format = GL_RGBA;
         GLenum type = GL_UNSIGNED_BYTE;
@@ -262,10 +262,13 @@ void create_texture_from_file(RscTexture& t, const TextureFromFileParams& params
         glBindTexture(GL_TEXTURE_2D, 0);
 
         t.id = texId;
-            
-        stbi_image_free(data);
     }
 }
+void create_texture_from_file(RscTexture& t, const TextureFromFileParams& params) {
+    s32 w, h, channels;
+    u8* data = stbi_load_arena(params.path, &w, &h, &channels, 4, params.arena);
+    create_texture_from_memory(t, { data, w, h, channels });
+}
 void create_texture_empty(RscTexture& t, const TextureRenderTargetCreateParams& params) {
     GLuint texId;
     glGenTextures(1, &texId);
@@ -628,6 +631,10 @@ void create_cbuffer(RscCBuffer& cb, const CBufferCreateParams& params) {
     cb.id = buffer;
 	cb.byteWidth = params.byteWidth;
 }
+void destroy_cbuffer(RscCBuffer& cb) {
+    glDeleteBuffers(1, &cb.id);
+    cb.id = 0;
+}
 void update_cbuffer(RscCBuffer& cb, const void* data) {
     glBindBuffer(GL_UNIFORM_BUFFER, cb.id);
     glBufferSubData(GL_UNIFORM_BUFFER, 0, cb.byteWidth, data);
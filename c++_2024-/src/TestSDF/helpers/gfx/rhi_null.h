@@ -0,0 +1,440 @@
+#ifndef __WASTELADNS_RHI_NULL_H__
+#define __WASTELADNS_RHI_NULL_H__
+
+// Null backend: nothing reaches a GPU, every bind, draw and cbuffer update is recorded into a
+// command log instead, along with per-frame counters. Meant for headless CPU profiling.
+// Matches GL33's clip space conventions, since it reuses the GL33 shader sources.
+namespace gfx {
+const auto generate_matrix_ortho = camera::generate_matrix_ortho_zneg1to1;
+const auto generate_matrix_persp = camera::generate_matrix_persp_zneg1to1;
+const auto add_oblique_plane_to_persp = camera::add_oblique_plane_to_persp_zneg1to1;
+const auto extract_frustum_planes_from_vp = camera::extract_frustum_planes_from_vp_zneg1to1;
+const f32 min_z = -1.f;
+}
+
+// definitions
+namespace gfx {
+namespace rhi { // render hardware interface
+
+enum class Type : u32 { Float };
+enum class InternalTextureFormat : u32 { V4_8, V316 };
+enum class TextureFormat : u32 { V4_8, V4_16 };
+enum class RenderTargetClearFlags : u32 { Stencil = 1, Depth = 2, Color = 4 };
+enum class RenderTargetWriteMask : u32 { All = 1, None = 0 };
+enum class RasterizerFillMode : u32 { Fill, Line };
+enum class RasterizerCullMode : u32 { CullFront, CullBack, CullNone };
+enum class CompFunc : u32 { Never, Always, Less, LessEqual, Equal, NotEqual, Greater, GreaterEqual };
+enum class DepthWriteMask : u32 { All = 1, Zero = 0 };
+enum class StencilOp : u32 { Keep, Zero, Replace, Invert, Incr, Decr };
+enum class BufferMemoryUsage : u32 { GPU, CPU };
+enum class BufferAccessType : u32 { GPU, CPU };
+enum class BufferItemType : u32 { U16, U32 };
+enum class BufferTopologyType : u32 { Triangles, Lines };
+enum class BufferAttributeFormat : u32 { R32G32B32_FLOAT, R32G32_FLOAT, R8G8B8A8_SINT, R8G8B8A8_UNORM };
+
+// every resource gets a unique id at creation, which is what the command log refers to
+struct RscTexture { u32 id; };
+
+struct RscMainRenderTarget { u32 id; };
+struct RscRenderTarget {
+    RscTexture textures[RenderTarget_MaxCount];
+    RscTexture depthStencil;
+    u32 id;
+    u32 count;
+};
+
+struct RscVertexShader { u32 id; };
+struct RscPixelShader { u32 id; };
+struct RscShaderSet { u32 id; };
+
+struct VertexAttribDesc {
+    const char* name;
+    size_t offset;
+    size_t stride;
+    BufferAttributeFormat format;
+};
+VertexAttribDesc make_vertexAttribDesc(const char* name, size_t offset, size_t stride, BufferAttributeFormat format) {
+    return VertexAttribDesc{ name, offset, stride, format };
+}
+struct RscInputLayout {};
+
+struct RscBlendState { u32 id; };
+struct RscRasterizerState { u32 id; };
+struct RscDepthStencilState { u32 id; };
+
+struct RscVertexBuffer {
+    u32 id;
+    u32 vertexCount;
+    BufferTopologyType type;
+};
+struct RscIndexedVertexBuffer {
+    u32 id;
+    u32 indexCount;
+    u32 indexOffset;
+    BufferTopologyType type;
+};
+
+struct RscCBuffer {
+    u32 id;
+    u32 byteWidth;
+};
+
+// Command log: 8 bytes per call, the payload depends on the command type
+// (bind count, instance count, stencil ref, event index...)
+struct Command {
+    struct Type { enum Enum : u8 {
+          BindRT, ClearRT, SetVP, BindTextures, BindShader, BindBlendState, BindRS, SetScissor
+        , BindDS, BindVertexBuffer, UpdateVertexBuffer, DrawVertexBuffer, DrawIndexed
+        , DrawInstancedIndexed, DrawFullscreen, UpdateCBuffer, BindCBuffers
+        , StartEvent, EndEvent, Count
+    }; };
+    u8 type;
+    u8 pad;
+    u16 arg;
+    u32 id;
+};
+const char* commandNames[Command::Type::Count] = {
+      "BindRT", "ClearRT", "SetVP", "BindTextures", "BindShader", "BindBlendState", "BindRS", "SetScissor"
+    , "BindDS", "BindVertexBuffer", "UpdateVertexBuffer", "DrawVertexBuffer", "DrawIndexed"
+    , "DrawInstancedIndexed", "DrawFullscreen", "UpdateCBuffer", "BindCBuffers"
+    , "StartEvent", "EndEvent"
+};
+
+struct FrameStats {
+    u32 commandCount[Command::Type::Count];
+    u32 drawCalls;
+    u32 instances;
+    u32 stateChanges; // binds that changed the bound resource
+    u32 redundantBinds; // binds of the resource already bound
+    u64 primitives;
+    u64 cbufferBytes;
+};
+
+// Per-event scope CPU timings, aggregated by event name
+// Scopes are inclusive of their children, depth and parent are taken from the first time a name
+// is seen, so parents always come before their children
+struct EventTiming {
+    enum { MaxNameLength = 32, NoParent = ~0u };
+    char name[MaxNameLength];
+    u64 cycles;
+    u32 calls;
+    u32 depth;
+    u32 parent;
+};
+
+struct Recorder {
+    struct BindSlot { enum Enum { RT, Shader, BlendState, RS, DS, VertexBuffer, Count }; };
+    enum { MaxBoundArray = 8, MaxEventDepth = 32, MaxEvents = 64 };
+
+    Command* commands;
+    u32 commandCount;
+    u32 commandCap;
+    u32 droppedCommands; // past commandCap, still counted in stats
+    u32 nextId;
+    u32 liveCBuffers; // created and not yet destroyed, to catch leaks
+    FrameStats stats;
+
+    // bound state, to tell actual state changes from redundant binds
+    u32 bound[BindSlot::Count];
+    u32 boundTextures[MaxBoundArray];
+    u32 boundCBuffers[MaxBoundArray];
+    u32 boundTextureCount;
+    u32 boundCBufferCount;
+    u32 stencilRef;
+
+    struct OpenEvent { u64 start; u32 index; };
+    OpenEvent eventStack[MaxEventDepth];
+    u32 eventDepth;
+    EventTiming events[MaxEvents]; // the last one collects every name past the limit
+    u32 eventCount;
+};
+Recorder recorder = {};
+
+} // rhi
+} // gfx
+
+// recorder functions
+namespace gfx {
+namespace rhi { // render hardware interface
+
+void init_recorder(allocator::PagedArena& arena, const u32 maxCommands) {
+    recorder = {};
+    recorder.commands = ALLOC_ARRAY(arena, Command, maxCommands);
+    recorder.commandCap = maxCommands;
+    recorder.nextId = 1; // 0 is never bound
+}
+// clears the command log and counters, bound state is kept like on a real device
+void reset_recorder_frame() {
+    recorder.commandCount = 0;
+    recorder.droppedCommands = 0;
+    recorder.stats = {};
+}
+void reset_recorder_events() {
+    recorder.eventCount = 0;
+}
+force_inline u32 record_id() { return recorder.nextId++; }
+force_inline void record(const Command::Type::Enum type, const u32 id, const u32 arg) {
+    recorder.stats.commandCount[type]++;
+    if (recorder.commandCount < recorder.commandCap) {
+        Command& c = recorder.commands[recorder.commandCount++];
+        c.type = type;
+        c.pad = 0;
+        c.arg = (u16)math::min(arg, 0xffffu);
+        c.id = id;
+    } else {
+        recorder.droppedCommands++;
+    }
+}
+force_inline void record_bind(const Recorder::BindSlot::Enum slot, const Command::Type::Enum type, const u32 id) {
+    record(type, id, 0);
+    if (recorder.bound[slot] != id) { recorder.bound[slot] = id; recorder.stats.stateChanges++; }
+    else { recorder.stats.redundantBinds++; }
+}
+force_inline void record_bind_array(
+u32* bound, u32& boundCount, const Command::Type::Enum type, const u32* ids, const u32 count) {
+    record(type, count ? ids[0] : 0, count);
+    bool changed = count != boundCount;
+    for (u32 i = 0; i < count && i < Recorder::MaxBoundArray; i++) {
+        changed = changed || bound[i] != ids[i];
+        bound[i] = ids[i];
+    }
+    boundCount = count;
+    if (changed) { recorder.stats.stateChanges++; }
+    else { recorder.stats.redundantBinds++; }
+}
+force_inline void record_draw(const Command::Type::Enum type, const u32 id, const u32 count, const u32 instances, const BufferTopologyType topology) {
+    record(type, id, instances);
+    recorder.stats.drawCalls++;
+    recorder.stats.instances += instances;
+    recorder.stats.primitives += (u64)(count / (topology == BufferTopologyType::Triangles ? 3 : 2)) * instances;
+}
+
+void print_command_log() {
+    for (u32 i = 0; i < recorder.commandCount; i++) {
+        const Command& c = recorder.commands[i];
+        if (c.type == Command::Type::StartEvent) {
+            printf("%6d %-20s %s\n", i, commandNames[c.type], recorder.events[c.arg].name);
+        } else {
+            printf("%6d %-20s id:%-6d arg:%d\n", i, commandNames[c.type], c.id, c.arg);
+        }
+    }
+    if (recorder.droppedCommands) { printf("(%d commands dropped)\n", recorder.droppedCommands); }
+}
+
+} // rhi
+} // gfx
+
+// functions
+namespace gfx {
+namespace rhi { // render hardware interface
+
+void create_main_RT(RscMainRenderTarget& rt, const MainRenderTargetParams& params) {
+    rt.id = record_id();
+}
+void bind_main_RT(RscMainRenderTarget& rt) {
+    record_bind(Recorder::BindSlot::RT, Command::Type::BindRT, rt.id);
+}
+void create_texture_empty(RscTexture& t, const TextureRenderTargetCreateParams& params) {
+    t.id = record_id();
+}
+void create_RT(RscRenderTarget& rt, const RenderTargetParams& params) {
+    rt.id = record_id();
+    rt.depthStencil = {};
+    if (params.flags & RenderTargetParams::Flags::ReadDepth) { rt.depthStencil.id = record_id(); }
+    for (u32 i = 0; i < params.count; i++) {
+        gfx::rhi::TextureRenderTargetCreateParams texParams;
+        texParams.width = params.width;
+        texParams.height = params.height;
+        texParams.format = params.textureFormat;
+        texParams.internalFormat = params.textureInternalFormat;
+        texParams.type = params.textureFormatType;
+        create_texture_empty(rt.textures[i], texParams);
+    }
+    rt.count = params.count;
+}
+void bind_RT(const RscRenderTarget& rt) {
+    record_bind(Recorder::BindSlot::RT, Command::Type::BindRT, rt.id);
+}
+void clear_RT(const RscRenderTarget& rt, u32 flags) {
+    record(Command::Type::ClearRT, rt.id, flags);
+}
+void clear_RT(const RscRenderTarget& rt, u32 flags, Color32 color) {
+    record(Command::Type::ClearRT, rt.id, flags | u32(RenderTargetClearFlags::Color));
+}
+void copy_RT_to_main_RT(RscMainRenderTarget& dst, const RscRenderTarget& src, const RenderTargetCopyParams& params) {}
+
+void set_VP(const ViewportParams& params) {
+    record(Command::Type::SetVP, 0, 0);
+}
+
+// no file is read, texture contents don't matter to the recorder
+void create_texture_from_file(RscTexture& t, const TextureFromFileParams& params) {
+    t.id = record_id();
+}
+void create_texture_from_memory(RscTexture& t, const TextureFromMemoryParams& params) {
+    t.id = record_id();
+}
+void bind_textures(const RscTexture* textures, const u32 count) {
+    u32 ids[Recorder::MaxBoundArray];
+    for (u32 i = 0; i < count && i < countof(ids); i++) { ids[i] = textures[i].id; }
+    record_bind_array(
+        recorder.boundTextures, recorder.boundTextureCount, Command::Type::BindTextures, ids, count);
+}
+
+ShaderResult create_shader_vs(RscVertexShader& vs, const VertexShaderRuntimeCompileParams& params) {
+    vs.id = record_id();
+    ShaderResult result = {};
+    result.compiled = true;
+    return result;
+}
+ShaderResult create_shader_ps(RscPixelShader& ps, const PixelShaderRuntimeCompileParams& params) {
+    ps.id = record_id();
+    ShaderResult result = {};
+    result.compiled = true;
+    return result;
+}
+#if __DEBUG
+ShaderResult recompile_shaderfile_vs(RscShaderSet& shader, const char* path) {
+    ShaderResult result = {};
+    result.compiled = true;
+    return result;
+}
+ShaderResult recompile_shaderfile_ps(RscShaderSet& shader, const char* path) {
+    ShaderResult result = {};
+    result.compiled = true;
+    return result;
+}
+#endif // __DEBUG
+ShaderResult create_shader_set(RscShaderSet& ss, const ShaderSetRuntimeCompileParams& params) {
+    ss.id = record_id();
+    ShaderResult result = {};
+    result.compiled = true;
+    return result;
+}
+void bind_shader(const RscShaderSet& ss) {
+    record_bind(Recorder::BindSlot::Shader, Command::Type::BindShader, ss.id);
+}
+
+void create_blend_state(RscBlendState& bs, const BlendStateParams& params) {
+    bs.id = record_id();
+}
+void bind_blend_state(const RscBlendState& bs) {
+    record_bind(Recorder::BindSlot::BlendState, Command::Type::BindBlendState, bs.id);
+}
+
+void create_RS(RscRasterizerState& rs, const RasterizerStateParams& params) {
+    rs.id = record_id();
+}
+void bind_RS(const RscRasterizerState& rs) {
+    record_bind(Recorder::BindSlot::RS, Command::Type::BindRS, rs.id);
+}
+void set_scissor(const u32 left, const u32 top, const u32 right, const u32 bottom) {
+    record(Command::Type::SetScissor, 0, 0);
+}
+void create_DS(RscDepthStencilState& ds, const DepthStencilStateParams& params) {
+    ds.id = record_id();
+}
+void bind_DS(const RscDepthStencilState& ds, const u32 stencilRef = 0) {
+    // a new stencil ref is a state change on its own, even with the same state object
+    if (recorder.stencilRef != stencilRef) { recorder.bound[Recorder::BindSlot::DS] = 0; }
+    recorder.stencilRef = stencilRef;
+    record_bind(Recorder::BindSlot::DS, Command::Type::BindDS, ds.id);
+}
+
+void create_vertex_buffer(RscVertexBuffer& t, const VertexBufferDesc& params, const VertexAttribDesc* attrs, const u32 attr_count) {
+    t.id = record_id();
+    t.type = params.type;
+    t.vertexCount = params.vertexCount;
+}
+void update_vertex_buffer(RscVertexBuffer& b, const BufferUpdateParams& params) {
+    record(Command::Type::UpdateVertexBuffer, b.id, 0);
+    b.vertexCount = params.vertexCount;
+}
+void bind_vertex_buffer(const RscVertexBuffer& b) {
+    record_bind(Recorder::BindSlot::VertexBuffer, Command::Type::BindVertexBuffer, b.id);
+}
+void draw_vertex_buffer(const RscVertexBuffer& b) {
+    record_draw(Command::Type::DrawVertexBuffer, b.id, b.vertexCount, 1, b.type);
+}
+
+void create_indexed_vertex_buffer(RscIndexedVertexBuffer& t, const IndexedVertexBufferDesc& params, const VertexAttribDesc* attrs, const u32 attr_count) {
+    t.id = record_id();
+    t.type = params.type;
+    t.indexCount = params.indexCount;
+    t.indexOffset = 0;
+}
+void update_indexed_vertex_buffer(RscIndexedVertexBuffer& b, const IndexedBufferUpdateParams& params) {
+    record(Command::Type::UpdateVertexBuffer, b.id, 0);
+    b.indexCount = params.indexCount;
+}
+void bind_indexed_vertex_buffer(const RscIndexedVertexBuffer& b) {
+    record_bind(Recorder::BindSlot::VertexBuffer, Command::Type::BindVertexBuffer, b.id);
+}
+void draw_indexed_vertex_buffer(const RscIndexedVertexBuffer& b) {
+    record_draw(Command::Type::DrawIndexed, b.id, b.indexCount, 1, b.type);
+}
+void draw_instances_indexed_vertex_buffer(const RscIndexedVertexBuffer& b, const u32 instanceCount) {
+    record_draw(Command::Type::DrawInstancedIndexed, b.id, b.indexCount, instanceCount, b.type);
+}
+
+void draw_fullscreen() {
+    record_draw(Command::Type::DrawFullscreen, 0, 3, 1, BufferTopologyType::Triangles);
+}
+
+void create_cbuffer(RscCBuffer& cb, const CBufferCreateParams& params) {
+    cb.id = record_id();
+    cb.byteWidth = params.byteWidth;
+    recorder.liveCBuffers++;
+}
+void destroy_cbuffer(RscCBuffer& cb) {
+    assert(cb.id && recorder.liveCBuffers > 0);
+    cb.id = 0;
+    recorder.liveCBuffers--;
+}
+void update_cbuffer(RscCBuffer& cb, const void* data) {
+    record(Command::Type::UpdateCBuffer, cb.id, 0);
+    recorder.stats.cbufferBytes += cb.byteWidth;
+}
+void bind_cbuffers(const RscShaderSet&, const RscCBuffer* cb, const u32 count) {
+    u32 ids[Recorder::MaxBoundArray];
+    for (u32 i = 0; i < count && i < countof(ids); i++) { ids[i] = cb[i].id; }
+    record_bind_array(
+        recorder.boundCBuffers, recorder.boundCBufferCount, Command::Type::BindCBuffers, ids, count);
+}
+
+#if __PROFILE
+void start_event(const char* name) {
+    u32 index = 0;
+    for (; index < recorder.eventCount; index++) {
+        if (strncmp(recorder.events[index].name, name, EventTiming::MaxNameLength - 1) == 0) { break; }
+    }
+    if (index == recorder.eventCount) {
+        if (recorder.eventCount < Recorder::MaxEvents) {
+            EventTiming& e = recorder.events[recorder.eventCount++];
+            e = {};
+            const char* label = recorder.eventCount < Recorder::MaxEvents ? name : "(other)";
+            io::strncpy(e.name, label, EventTiming::MaxNameLength - 1);
+            e.depth = recorder.eventDepth;
+            e.parent = recorder.eventDepth ?
+                recorder.eventStack[recorder.eventDepth - 1].index : (u32)EventTiming::NoParent;
+        } else {
+            index = Recorder::MaxEvents - 1;
+        }
+    }
+    record(Command::Type::StartEvent, 0, index);
+    assert(recorder.eventDepth < Recorder::MaxEventDepth);
+    recorder.eventStack[recorder.eventDepth++] = { __rdtsc(), index };
+}
+void end_event() {
+    assert(recorder.eventDepth > 0);
+    const Recorder::OpenEvent& open = recorder.eventStack[--recorder.eventDepth];
+    EventTiming& e = recorder.events[open.index];
+    e.cycles += __rdtsc() - open.start;
+    e.calls++;
+    record(Command::Type::EndEvent, 0, open.index);
+}
+#endif
+
+}
+}
+#endif // __WASTELADNS_RHI_NULL_H__
@@ -5,6 +5,8 @@
 #include "input_defs_win.h"
 #elif __MACOS
 #include "input_defs_mac.h"
+#elif __LINUX
+#include "input_defs_linux.h"
 #endif
 
 namespace input {
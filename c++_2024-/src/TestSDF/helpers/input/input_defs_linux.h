@@ -0,0 +1,146 @@
+#ifndef __WASTELADNS_INPUT_DEFS_LINUX_H__
+#define __WASTELADNS_INPUT_DEFS_LINUX_H__
+
+namespace input {
+namespace keyboard {
+
+    // Linux evdev keycodes, as found in linux/input-event-codes.h (KEY_*). These match the
+    // Windows scancodes for the main block of the keyboard, but extended keys (arrows, navigation,
+    // right modifiers, etc) get their own codes instead of an extended bit.
+    struct Keys {
+        enum Enum : s32 {
+              SPACE = 0x039
+            , APOSTROPHE = 0x028 /* ' */
+            , COMMA = 0x033 /* , */
+            , MINUS = 0x00C /* - */
+            , PERIOD = 0x034 /* . */
+            , SLASH = 0x035 /* / */
+            , SEMICOLON = 0x027 /* ; */
+            , EQUAL = 0x00D /* = */
+            , NUM0 = 0x00B
+            , NUM1 = 0x002
+            , NUM2 = 0x003
+            , NUM3 = 0x004
+            , NUM4 = 0x005
+            , NUM5 = 0x006
+            , NUM6 = 0x007
+            , NUM7 = 0x008
+            , NUM8 = 0x009
+            , NUM9 = 0x00A
+            , A = 0x01E
+            , B = 0x030
+            , C = 0x02E
+            , D = 0x020
+            , E = 0x012
+            , F = 0x021
+            , G = 0x022
+            , H = 0x023
+            , I = 0x017
+            , J = 0x024
+            , K = 0x025
+            , L = 0x026
+            , M = 0x032
+            , N = 0x031
+            , O = 0x018
+            , P = 0x019
+            , Q = 0x010
+            , R = 0x013
+            , S = 0x01F
+            , T = 0x014
+            , U = 0x016
+            , V = 0x02F
+            , W = 0x011
+            , X = 0x02D
+            , Y = 0x015
+            , Z = 0x02C
+            , LEFT_BRACKET = 0x01A /* [ */
+            , BACKSLASH = 0x02B /* \ */
+            , RIGHT_BRACKET = 0x01B /* ] */
+            , GRAVE_ACCENT = 0x029 /* ` */
+            , WORLD_2 = 0x056
+            , ESCAPE = 0x001
+            , ENTER = 0x01C
+            , TAB = 0x00F
+            , BACKSPACE = 0x00E
+            , INSERT = 0x06E
+            , DELETE = 0x06F
+            , RIGHT = 0x06A
+            , LEFT = 0x069
+            , DOWN = 0x06C
+            , UP = 0x067
+            , PAGE_UP = 0x068
+            , PAGE_DOWN = 0x06D
+            , HOME = 0x066
+            , END = 0x06B
+            , CAPS_LOCK = 0x03A
+            , SCROLL_LOCK = 0x046
+            , NUM_LOCK = 0x045
+            , PRINT_SCREEN = 0x063
+            , F1 = 0x03B
+            , F2 = 0x03C
+            , F3 = 0x03D
+            , F4 = 0x03E
+            , F5 = 0x03F
+            , F6 = 0x040
+            , F7 = 0x041
+            , F8 = 0x042
+            , F9 = 0x043
+            , F10 = 0x044
+            , F11 = 0x057
+            , F12 = 0x058
+            , F13 = 0x0B7
+            , F14 = 0x0B8
+            , F15 = 0x0B9
+            , F16 = 0x0BA
+            , F17 = 0x0BB
+            , F18 = 0x0BC
+            , F19 = 0x0BD
+            , F20 = 0x0BE
+            , F21 = 0x0BF
+            , F22 = 0x0C0
+            , F23 = 0x0C1
+            , F24 = 0x0C2
+            , KP_0 = 0x052
+            , KP_1 = 0x04F
+            , KP_2 = 0x050
+            , KP_3 = 0x051
+            , KP_4 = 0x04B
+            , KP_5 = 0x04C
+            , KP_6 = 0x04D
+            , KP_7 = 0x047
+            , KP_8 = 0x048
+            , KP_9 = 0x049
+            , KP_DECIMAL = 0x053
+            , KP_DIVIDE = 0x062
+            , KP_ADD = 0x04E
+            , KP_SUBTRACT = 0x04A
+            , KP_ENTER = 0x060
+            , KP_MULTIPLY = 0x037
+            , LEFT_SHIFT = 0x02A
+            , LEFT_CONTROL = 0x01D
+            , LEFT_ALT = 0x038
+            , LEFT_SUPER = 0x07D
+            , RIGHT_SHIFT = 0x036
+            , RIGHT_CONTROL = 0x061
+            , RIGHT_ALT = 0x064
+            , RIGHT_SUPER = 0x07E
+            , MENU = 0x07F
+            , PAUSE = 0x077
+            , COUNT = 0x0C3
+            , INVALID = -1
+        };
+    };
+} // keyboard
+namespace mouse {
+    struct Keys {
+        enum Enum : s32 {
+              BUTTON_LEFT = 0
+            , BUTTON_RIGHT
+            , BUTTON_MIDDLE
+            , COUNT
+        };
+    };
+} // mouse
+} // input
+
+#endif // __WASTELADNS_INPUT_DEFS_LINUX_H__
@@ -62,6 +62,24 @@ struct DeviceInfo {
 typedef IOHIDDeviceRef DeviceHandle;
 }
 }
+#elif __LINUX
+namespace input {
+namespace gamepad {
+// no pad support yet, the linux entry point is headless
+struct SliderInfo {
+    u32 usage;
+    u64 min;
+    u64 max;
+};
+struct DeviceInfo {
+    SliderInfo sliders_info[9];
+    u32 keys_count;
+    u32 sliders_count;
+    bool loaded;
+};
+typedef u64 DeviceHandle;
+}
+}
 #endif 
 
 namespace input {
@@ -30,6 +30,7 @@ namespace io {
     int strncpy(char* dst, const char* src, size_t num) { return ::strncpy(dst, src, num) != 0; }
 #endif
     const auto fclose = ::fclose;
+    const auto fprintf = ::fprintf;
     const auto fgetc = ::fgetc;
     const auto ftell = ::ftell;
 
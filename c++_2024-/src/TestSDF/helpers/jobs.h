@@ -0,0 +1,277 @@
+#ifndef __WASTELADNS_JOBS_H__
+#define __WASTELADNS_JOBS_H__
+
+namespace jobs {
+
+// Minimal work-stealing job system. Each thread (main thread included) owns a queue:
+// jobs are pushed and popped from the back of the owner's queue, and idle threads steal
+// from the front of the others. Queues are guarded by a spinlock, contention is expected to
+// be low since jobs are coarse.
+// Every worker has its own scratch arena, and each job gets a copy of it, so its
+// allocations are scoped to the job (same as passing a PagedArena by copy elsewhere)
+// Only the owning thread allocates from a worker's scratch arena, so their highmarks need no
+// synchronization. Allocations that must outlive the job can go to a shared ConcurrentArena
+// Jobs that may take longer than a frame go to a separate background queue, which only the
+// worker threads take jobs from, see push_background. Jobs pushed from a background job go there
+// too, so the main thread doesn't run parts of a background job while waiting on its own jobs
+
+const u32 maxWorkers = 16;
+const u32 queueCapacity = 1024; // power of two
+
+struct Context {
+    allocator::PagedArena scratchArena;
+    u32 workerId;
+};
+typedef void (*JobFunc)(Context&, void*);
+struct Counter {
+    volatile s32 pending;
+};
+struct Job {
+    JobFunc func;
+    void* data;
+    Counter* counter;
+    bool background; // pushed to the background queue
+};
+struct Queue {
+    Job jobs[queueCapacity];
+    u32 head; // steal end
+    u32 tail; // owner end
+    volatile s32 lock;
+};
+struct Worker {
+    Queue queue;
+    allocator::PagedArena scratchArena;
+    __DEBUGDEF(uintptr_t scratchArenaHighmark;)
+    platform::Thread thread;
+    u32 id;
+};
+struct Pool {
+    Worker workers[maxWorkers];
+    Queue background;
+    platform::Semaphore semaphore;
+    u32 workerCount;
+};
+
+Pool pool;
+thread_local u32 workerId = 0; // the main thread is worker 0
+thread_local bool inBackgroundJob = false; // whether the job this thread is running is a background one
+
+bool pop(Job& job, Queue& q) {
+    bool found = false;
+    atomic::lock(&q.lock);
+    if (q.tail != q.head) {
+        q.tail--;
+        job = q.jobs[q.tail & (queueCapacity - 1)];
+        found = true;
+    }
+    atomic::unlock(&q.lock);
+    return found;
+}
+bool steal(Job& job, Queue& q) {
+    bool found = false;
+    atomic::lock(&q.lock);
+    if (q.tail != q.head) {
+        job = q.jobs[q.head & (queueCapacity - 1)];
+        q.head++;
+        found = true;
+    }
+    atomic::unlock(&q.lock);
+    return found;
+}
+bool find(Job& job) {
+    if (pop(job, pool.workers[workerId].queue)) { return true; }
+    for (u32 i = 1; i < pool.workerCount; i++) {
+        u32 victim = (workerId + i) % pool.workerCount;
+        if (steal(job, pool.workers[victim].queue)) { return true; }
+    }
+    if (workerId != 0 && steal(job, pool.background)) { return true; }
+    return false;
+}
+void run(const Job& job, allocator::PagedArena scratchArena) {
+    Context ctx = { scratchArena, workerId };
+    const bool wasInBackgroundJob = inBackgroundJob; // jobs run from wait nest
+    inBackgroundJob = job.background;
+    job.func(ctx, job.data);
+    inBackgroundJob = wasInBackgroundJob;
+    atomic::add(&job.counter->pending, -1);
+}
+// Adds the job to a queue the caller has locked, and unlocks it
+void enqueue_locked(Queue& q, Counter& counter, JobFunc func, void* data, const bool background) {
+    q.jobs[q.tail & (queueCapacity - 1)] = { func, data, &counter, background };
+    q.tail++;
+    atomic::unlock(&q.lock);
+    platform::semaphore_signal(pool.semaphore, 1);
+}
+
+void workerLoop(void* data) {
+    Worker& worker = *(Worker*)data;
+    workerId = worker.id;
+    while (true) {
+        Job job;
+        if (find(job)) { run(job, worker.scratchArena); }
+        else { platform::semaphore_wait(pool.semaphore); }
+    }
+}
+
+// workerCount includes the calling thread, which becomes worker 0
+void init(u32 workerCount, size_t scratchArenaSize) {
+    pool.workerCount = math::clamp(workerCount, 1u, maxWorkers);
+    platform::semaphore_init(pool.semaphore);
+    pool.background.head = pool.background.tail = 0;
+    pool.background.lock = 0;
+    for (u32 i = 0; i < pool.workerCount; i++) {
+        Worker& worker = pool.workers[i];
+        worker.id = i;
+        worker.queue.head = worker.queue.tail = 0;
+        worker.queue.lock = 0;
+        allocator::init_arena(worker.scratchArena, scratchArenaSize);
+        __DEBUGDEF(
+            worker.scratchArenaHighmark = (uintptr_t)worker.scratchArena.curr;
+            worker.scratchArena.highmark = &worker.scratchArenaHighmark;)
+        #if __ARENA_TRACKING
+        allocator::track_arena("worker scratch", worker.scratchArena);
+        #endif
+    }
+    for (u32 i = 1; i < pool.workerCount; i++) {
+        Worker& worker = pool.workers[i];
+        worker.thread.func = workerLoop;
+        worker.thread.data = &worker;
+        platform::thread_start(worker.thread);
+    }
+}
+
+// If the queue is full, the job runs right away on the calling thread instead, with the caller's
+// scratch arena (as in wait)
+// From a background job on a worker thread, the job goes to the background queue
+void push(Counter& counter, JobFunc func, void* data, allocator::PagedArena scratchArena) {
+    atomic::add(&counter.pending, 1);
+    const bool background = inBackgroundJob && workerId != 0;
+    Queue& q = background ? pool.background : pool.workers[workerId].queue;
+    atomic::lock(&q.lock);
+    if (q.tail - q.head >= queueCapacity) {
+        atomic::unlock(&q.lock);
+        run({ func, data, &counter, background }, scratchArena);
+        return;
+    }
+    enqueue_locked(q, counter, func, data, background);
+}
+
+// For jobs that may take longer than a frame: the main thread never runs them, so it can't end up
+// stuck in one while waiting on its own jobs. Poll the counter to know when they are done
+// Without worker threads, or if the background queue is full, the job runs right away on the
+// calling thread
+void push_background(Counter& counter, JobFunc func, void* data) {
+    atomic::add(&counter.pending, 1);
+    if (pool.workerCount == 1) {
+        run({ func, data, &counter, false }, pool.workers[0].scratchArena);
+        return;
+    }
+    Queue& q = pool.background;
+    atomic::lock(&q.lock);
+    if (q.tail - q.head >= queueCapacity) {
+        atomic::unlock(&q.lock);
+        run({ func, data, &counter, false }, pool.workers[0].scratchArena);
+        return;
+    }
+    enqueue_locked(q, counter, func, data, true);
+}
+
+// Runs pending jobs on the calling thread until the counter reaches zero
+// Jobs run here get the caller's scratch arena, so they allocate past whatever the caller is using
+void wait(Counter& counter, allocator::PagedArena scratchArena) {
+    while (atomic::load(&counter.pending) > 0) {
+        Job job;
+        if (find(job)) { run(job, scratchArena); }
+        else { _mm_pause(); }
+    }
+}
+
+#if __DEBUG
+// Adds up the scratch arenas of the worker threads (worker 0 is the main thread, whose jobs use
+// the caller's arena). Highmarks are read while workers may be writing them, so they may lag
+struct ScratchUsage {
+    ptrdiff_t highmark; // bytes
+    ptrdiff_t committed; // bytes
+    ptrdiff_t maxWorkerHighmark; // bytes
+};
+ScratchUsage get_scratch_usage() {
+    ScratchUsage usage = {};
+    for (u32 i = 1; i < pool.workerCount; i++) {
+        const Worker& worker = pool.workers[i];
+        const uintptr_t highmark = *(volatile uintptr_t*)&worker.scratchArenaHighmark;
+        const ptrdiff_t used = (ptrdiff_t)(highmark - (uintptr_t)worker.scratchArena.curr);
+        usage.highmark += used;
+        usage.committed += (ptrdiff_t)(math::max((uintptr_t)worker.scratchArena.end, highmark)
+                                       - (uintptr_t)worker.scratchArena.curr);
+        usage.maxWorkerHighmark = math::max(usage.maxWorkerHighmark, used);
+    }
+    return usage;
+}
+
+// Every job makes lots of small allocations from one shared ConcurrentArena and fills them
+// with its id, then checks that no other job wrote over them
+struct ConcurrentArenaTask {
+    allocator::ConcurrentArena* arena;
+    u32 id;
+    u32 allocCount;
+    u32 corrupted;
+};
+void concurrentArenaTask(Context&, void* data) {
+    ConcurrentArenaTask& task = *(ConcurrentArenaTask*)data;
+    u32** allocs = (u32**)allocator::alloc_arena(*task.arena, task.allocCount * sizeof(u32*), alignof(u32*));
+    for (u32 i = 0; i < task.allocCount; i++) {
+        const u32 count = 1 + (i * 7) % 32;
+        const ptrdiff_t align = ptrdiff_t(4) << (i % 4);
+        allocs[i] = (u32*)allocator::alloc_arena(*task.arena, count * sizeof(u32), align);
+        assert(((uintptr_t)allocs[i] & (align - 1)) == 0);
+        for (u32 k = 0; k < count; k++) { allocs[i][k] = task.id; }
+    }
+    task.corrupted = 0;
+    for (u32 i = 0; i < task.allocCount; i++) {
+        const u32 count = 1 + (i * 7) % 32;
+        for (u32 k = 0; k < count; k++) { task.corrupted += allocs[i][k] != task.id; }
+    }
+}
+void benchmarkConcurrentArena(allocator::PagedArena scratchArena) {
+    static allocator::ConcurrentArena arena = {};
+    if (!arena.base) { allocator::init_arena(arena, 1024 * 1024); }
+    const u32 taskCount = pool.workerCount * 4;
+    const u32 allocCount = 20000;
+    ConcurrentArenaTask* tasks = ALLOC_ARRAY(scratchArena, ConcurrentArenaTask, taskCount);
+    allocator::reset_arena(arena);
+    u64 start = __rdtsc();
+    {
+        Counter counter = {};
+        for (u32 i = 0; i < taskCount; i++) {
+            tasks[i] = { &arena, i + 1, allocCount, 0 };
+            push(counter, concurrentArenaTask, &tasks[i], scratchArena);
+        }
+        wait(counter, scratchArena);
+    }
+    const u64 cyclesConcurrent = __rdtsc() - start;
+    u32 corrupted = 0;
+    for (u32 i = 0; i < taskCount; i++) { corrupted += tasks[i].corrupted; }
+
+    // the same jobs one after the other on this thread, for reference
+    allocator::reset_arena(arena);
+    start = __rdtsc();
+    {
+        Context ctx = { scratchArena, workerId };
+        for (u32 i = 0; i < taskCount; i++) {
+            tasks[i] = { &arena, i + 1, allocCount, 0 };
+            concurrentArenaTask(ctx, &tasks[i]);
+        }
+    }
+    const u64 cyclesSerial = __rdtsc() - start;
+    io::debuglog(
+        "concurrent arena: %d jobs x %d allocations on %d workers %.3f Mcycles, on one thread %.3f Mcycles, "
+        "%.3fMB committed, %d corrupted values\n",
+        taskCount, allocCount, pool.workerCount, cyclesConcurrent / 1000000.f, cyclesSerial / 1000000.f,
+        atomic::load(&arena.committed) / (1024.f * 1024.f), corrupted);
+    assert(corrupted == 0);
+}
+#endif
+
+} // jobs
+
+#endif // __WASTELADNS_JOBS_H__
@@ -2,4 +2,6 @@
 #include "main_win.h"
 #elif __MACOS
 #include "main_mac.mm"
+#elif __LINUX
+#include "main_linux.h"
 #endif
\ No newline at end of file
@@ -0,0 +1,218 @@
+// Headless entry point: no window, no input devices, and rendering goes through the null rhi.
+// Runs a fixed number of frames with a scripted orbit camera and prints CPU timings
+// of game::update, along with the recorded draw call and state change counts.
+// usage: app-linux [frame count] [-log (print the command log of the last frame)]
+//                  [-cook (with __COOK_ASSETS, re-cook every asset from its fbx source and exit)]
+//                  [-rooms N (build the next room in the background every N frames, and print the swap cost)]
+// With __ARENA_TRACKING, the per frame arena allocations by callsite are written to arena_timeline.csv
+
+f64 time_now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+
+    u32 frameCount = 600;
+    bool printLog = false;
+    bool cook = false;
+    u32 roomInterval = 0;
+    for (s32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-log") == 0) { printLog = true; }
+        else if (strcmp(argv[i], "-cook") == 0) { cook = true; }
+        else if (strcmp(argv[i], "-rooms") == 0 && i + 1 < argc) {
+            roomInterval = math::max((u32)atoi(argv[++i]), 1u);
+        }
+        else { frameCount = math::max((u32)atoi(argv[i]), 1u); }
+    }
+    const u32 warmupFrames = math::min(10u, frameCount - 1);
+
+    platform::state = {};
+    {
+        platform::LaunchConfig config;
+        game::loadLaunchConfig(config);
+        platform::state.screen.window_width = config.window_width;
+        platform::state.screen.window_height = config.window_height;
+        platform::state.screen.width = config.game_width;
+        platform::state.screen.height = config.game_height;
+        platform::state.screen.desiredRatio = platform::state.screen.width / (f32)platform::state.screen.height;
+        platform::state.screen.fullscreen = false;
+        platform::state.screen.window_scale = 1.f;
+    }
+
+    // Initialize page size, for virtual memory allocators
+    allocator::pagesize = sysconf(_SC_PAGESIZE);
+
+    if (cook) {
+        #if __COOK_ASSETS
+        allocator::PagedArena cookArena, cookScratchArena;
+        allocator::init_arena(cookArena, 16 * 1024 * 1024);
+        allocator::init_arena(cookScratchArena, 64 * 1024 * 1024);
+        const f64 cookStart = time_now();
+        const u32 cooked = cook_assets(cookArena, cookScratchArena);
+        printf("cooked %d/%d assets in %.2fms\n",
+               cooked, (u32)countof(assets), (time_now() - cookStart) * 1000.);
+        return cooked == countof(assets) ? 0 : 1;
+        #else
+        printf("-cook needs __COOK_ASSETS\n");
+        return 1;
+        #endif
+    }
+
+    allocator::PagedArena recorderArena;
+    allocator::init_arena(recorderArena, 8 * 1024 * 1024);
+    gfx::rhi::init_recorder(recorderArena, 1024 * 1024);
+
+    // game time is simulated at the target framerate, so every run updates the same frames
+    // regardless of how long they take to process
+    platform::state.time.running = 0.0;
+    platform::state.time.now = platform::state.time.start = 0.0;
+
+    const f64 loadStart = time_now();
+    game::Instance game;
+    platform::GameConfig config;
+    game::start(game, config);
+    const f64 loadTime = time_now() - loadStart;
+
+    struct Totals {
+        gfx::rhi::FrameStats stats;
+        u64 cycles;
+        u64 minCycles;
+        u64 maxCycles;
+        f64 seconds;
+    };
+    Totals totals = {};
+    totals.minCycles = ~0ull;
+
+    const f32 mousex = platform::state.screen.window_width * 0.5f;
+    const f32 mousey = platform::state.screen.window_height * 0.5f;
+    u32 frame = 0;
+    for (; frame < frameCount && !config.quit; frame++) {
+        // scripted input: orbit the camera with the left mouse button held down, while
+        // tilting up and down and slowly zooming in and out
+        {
+            ::input::mouse::State& mouse = platform::state.input.mouse;
+            memcpy(mouse.last, mouse.curr, sizeof(u8) * ::input::mouse::Keys::COUNT);
+            memcpy(
+                platform::state.input.keyboard.last, platform::state.input.keyboard.current,
+                sizeof(u8) * ::input::keyboard::Keys::COUNT);
+            const f32 t = (f32)platform::state.time.running;
+            mouse.curr[::input::mouse::Keys::BUTTON_LEFT] = 1;
+            mouse.x = mousex;
+            mouse.y = mousey;
+            mouse.dx = 3.f;
+            mouse.dy = 2.f * math::sin(t);
+            mouse.scrolldx = 0.f;
+            mouse.scrolldy = 0.2f * math::sin(0.5f * t);
+        }
+
+        if (frame == warmupFrames) {
+            totals = {};
+            totals.minCycles = ~0ull;
+            gfx::rhi::reset_recorder_events();
+            __PROFILEONLY(profiler::reset_totals();)
+        }
+        gfx::rhi::reset_recorder_frame();
+        if (roomInterval && frame % roomInterval == 0) {
+            game::request_room(game, (game.roomId + 1) % countof(game::roomDefinitions));
+        }
+
+        const f64 start = time_now();
+        const u64 startCycles = __rdtsc();
+        game::update(game, config);
+        const u64 cycles = __rdtsc() - startCycles;
+        totals.seconds += time_now() - start;
+
+        totals.cycles += cycles;
+        totals.minCycles = math::min(totals.minCycles, cycles);
+        totals.maxCycles = math::max(totals.maxCycles, cycles);
+        const gfx::rhi::FrameStats& stats = gfx::rhi::recorder.stats;
+        for (u32 i = 0; i < gfx::rhi::Command::Type::Count; i++) {
+            totals.stats.commandCount[i] += stats.commandCount[i];
+        }
+        totals.stats.drawCalls += stats.drawCalls;
+        totals.stats.instances += stats.instances;
+        totals.stats.stateChanges += stats.stateChanges;
+        totals.stats.redundantBinds += stats.redundantBinds;
+        totals.stats.primitives += stats.primitives;
+        totals.stats.cbufferBytes += stats.cbufferBytes;
+
+        platform::state.time.now = config.nextFrame;
+        platform::state.time.running = platform::state.time.now - platform::state.time.start;
+    }
+
+    if (printLog) { gfx::rhi::print_command_log(); }
+    #if __ARENA_TRACKING
+    allocator::end_tracking_frame();
+    allocator::write_tracking_csv("arena_timeline.csv");
+    #endif
+
+    // rdtsc runs at a fixed rate, calibrate it against the wall clock over the whole run
+    const u32 measured = frame - warmupFrames;
+    const f64 cyclesToMs = totals.cycles > 0 ? 1000. * totals.seconds / totals.cycles : 0.;
+    const f64 invFrames = 1. / math::max(measured, 1u);
+    printf("%s, %d frames (%d warmup), %d workers, scene load %.2fms\n",
+           platform::name, measured, warmupFrames, jobs::pool.workerCount, loadTime * 1000.);
+    printf("update: avg %.3fms min %.3fms max %.3fms\n",
+           totals.cycles * invFrames * cyclesToMs,
+           totals.minCycles * cyclesToMs, totals.maxCycles * cyclesToMs);
+    if (roomInterval) {
+        printf("room swaps: %d, last %.3fms max %.3fms, live cbuffers %d\n",
+               game.streaming.swapCount, game.streaming.lastSwapMs, game.streaming.maxSwapMs,
+               gfx::rhi::recorder.liveCBuffers);
+    }
+
+    #if __PROFILE
+    // cpu zones, on every thread; both these and the render events are timed with rdtsc
+    printf("update stages (avg per frame, inclusive):\n");
+    for (u32 i = 0; i < profiler::state.stageCount; i++) {
+        const profiler::Stage& stage = profiler::state.stages[i];
+        printf("  %*s%-*s %8.3fms %6.1f calls%s\n",
+               stage.depth * 2, "", 32 - stage.depth * 2, stage.name,
+               stage.totalCycles * invFrames * cyclesToMs, stage.totalCalls * invFrames,
+               stage.workerId ? " (jobs)" : "");
+    }
+    #endif
+
+    printf("render events (avg per frame, inclusive):\n");
+    u64 eventCycles = 0;
+    // depth first over the parent links, so that children are listed under their parents
+    u32 eventStack[gfx::rhi::Recorder::MaxEvents];
+    u32 eventStackCount = 0;
+    for (u32 i = gfx::rhi::recorder.eventCount; i > 0; i--) {
+        if (gfx::rhi::recorder.events[i - 1].parent == gfx::rhi::EventTiming::NoParent) {
+            eventStack[eventStackCount++] = i - 1;
+        }
+    }
+    while (eventStackCount) {
+        const u32 i = eventStack[--eventStackCount];
+        for (u32 j = gfx::rhi::recorder.eventCount - 1; j > i; j--) {
+            if (gfx::rhi::recorder.events[j].parent == i) { eventStack[eventStackCount++] = j; }
+        }
+        const gfx::rhi::EventTiming& e = gfx::rhi::recorder.events[i];
+        if (e.depth == 0) { eventCycles += e.cycles; }
+        printf("  %*s%-*s %8.3fms %6.1f calls\n",
+               e.depth * 2, "", 32 - e.depth * 2, e.name,
+               e.cycles * invFrames * cyclesToMs, e.calls * invFrames);
+    }
+    printf("  %-32s %8.3fms\n", "(outside render events)",
+           (totals.cycles - math::min(eventCycles, totals.cycles)) * invFrames * cyclesToMs);
+
+    printf("per frame:\n");
+    printf("  draw calls %.1f, instances %.1f, primitives %.1f\n",
+           totals.stats.drawCalls * invFrames, totals.stats.instances * invFrames,
+           totals.stats.primitives * invFrames);
+    printf("  state changes %.1f, redundant binds %.1f\n",
+           totals.stats.stateChanges * invFrames, totals.stats.redundantBinds * invFrames);
+    printf("  cbuffer updates %.1f (%.1fKB)\n",
+           totals.stats.commandCount[gfx::rhi::Command::Type::UpdateCBuffer] * invFrames,
+           totals.stats.cbufferBytes * invFrames / 1024.);
+    for (u32 i = 0; i < gfx::rhi::Command::Type::Count; i++) {
+        if (totals.stats.commandCount[i] == 0) { continue; }
+        printf("  %-24s %.1f\n",
+               gfx::rhi::commandNames[i], totals.stats.commandCount[i] * invFrames);
+    }
+
+    return 0;
+}
@@ -13,6 +13,8 @@ const f32 eps32 = 1.19e-07f;
 const f64 eps64 = 2.22e-16;
 const f32 e32 = 2.7182818284590452353602874713527f;
 const f64 e64 = 2.7182818284590452353602874713527;
+const f32 sqrt2_32 = 1.4142135623730950488016887242097f;
+const f64 sqrt2_64 = 1.4142135623730950488016887242097;
 constexpr unsigned floorlog2(unsigned x) { return x == 1 ? 0 : 1 + floorlog2(x >> 1); }
 constexpr unsigned ceillog2(unsigned x) { return x == 1 ? 0 : floorlog2(x - 1) + 1; }
 }
@@ -50,7 +52,7 @@ force_inline u32 clamp(u32 x, u32 a, u32 b) { return min(max(x, a), b); }
 force_inline s32 clamp(s32 x, s32 a, s32 b) { return min(max(x, a), b); }
 force_inline u64 clamp(u64 x, u64 a, u64 b) { return min(max(x, a), b); }
 force_inline s64 clamp(s64 x, s64 a, s64 b) { return min(max(x, a), b); }
-#ifndef _MSC_VER // outside of msvc, uintptr_t / ptrdiff_t types are not implicitly convertible to u64 / s64
+#if !_MSC_VER && !__LINUX // on macos, uintptr_t / ptrdiff_t types are not implicitly convertible to u64 / s64 (on linux they are the same type)
 force_inline uintptr_t min(uintptr_t a, uintptr_t b) { return (b < a) ? b : a; }
 force_inline uintptr_t max(uintptr_t a, uintptr_t b) { return (a < b) ? b : a; }
 force_inline uintptr_t clamp(uintptr_t x, uintptr_t a, uintptr_t b) { return min(max(x, a), b); }
@@ -61,6 +63,8 @@ force_inline ptrdiff_t clamp(ptrdiff_t x, ptrdiff_t a, ptrdiff_t b) { return min
 
 force_inline f32 ceil(f32 a) { return ::ceilf(a); }
 force_inline f64 ceil(f64 a) { return ::ceil(a); }
+force_inline f32 floor(f32 a) { return ::floorf(a); }
+force_inline f64 floor(f64 a) { return ::floor(a); }
 force_inline f32 sqrt(f32 a) { return ::sqrtf(a); }
 force_inline f64 sqrt(f64 a) { return ::sqrt(a); }
 force_inline f32 rsqrt(f32 a) { return 1.f / ::sqrtf(a); }   // todo: ensure this
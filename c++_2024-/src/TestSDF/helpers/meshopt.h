@@ -0,0 +1,221 @@
+#ifndef __WASTELADNS_MESHOPT_H__
+#define __WASTELADNS_MESHOPT_H__
+
+namespace meshopt {
+
+// Reorders indexed triangle lists for the gpu's post-transform vertex cache and for overdraw,
+// following Tipsify ("Fast Triangle Reordering for Vertex Locality and Reduced Overdraw",
+// Sander, Nehab and Barczak 2007), and then reorders the vertices in the order the indices first
+// use them, so that vertex fetches walk the buffer forward. Meant to run on import, in linear time
+// (other than the cluster sort)
+// The cache is modeled as a FIFO of cacheSize vertices. ACMR is the number of vertices transformed
+// per triangle (0.5 at best, 3 at worst), ATVR the number of transforms per vertex (1 at best)
+
+const u32 cacheSize = 16;
+const u32 invalidVertex = ~0u;
+
+struct CacheStats {
+    f32 acmr;
+    f32 atvr;
+};
+void compute_cache_stats(
+    CacheStats& stats, const u32* indices, const u32 indexCount, const u32 vertexCount,
+    allocator::PagedArena scratchArena) {
+    u32* cacheTime = ALLOC_ARRAY(scratchArena, u32, vertexCount);
+    memset(cacheTime, 0, sizeof(u32) * vertexCount);
+    u32 time = cacheSize + 1;
+    u32 transforms = 0;
+    for (u32 i = 0; i < indexCount; i++) {
+        const u32 v = indices[i];
+        if (time - cacheTime[v] > cacheSize) { cacheTime[v] = time++; transforms++; }
+    }
+    stats.acmr = indexCount ? transforms * 3.f / indexCount : 0.f;
+    stats.atvr = vertexCount ? transforms / (f32)vertexCount : 0.f;
+}
+
+struct Cluster {
+    f32 sortKey;
+    u32 start; // into the tipsified triangle order
+    u32 count;
+};
+s64 compareClusters(const void* a, const void* b) { // highest key first
+    const f32 ka = ((const Cluster*)a)->sortKey, kb = ((const Cluster*)b)->sortKey;
+    return ka > kb ? -1 : (ka < kb ? 1 : 0);
+}
+
+// Tipsify fans around a vertex, emitting all its remaining triangles, and then moves to the
+// vertex among the ones just emitted that will still be in the cache after fanning around it, or
+// back through the recent ones when there are none (a dead end)
+// The output is split in clusters at dead ends, and at triangles that miss the cache on all their
+// vertices: in both cases the cluster starts off a cold cache, so clusters can be reordered for
+// little cache cost. Clusters facing away from the mesh center go first, since they are the most
+// likely to occlude the rest
+// Vertex positions are read as the float3 at the start of each vertex, as in all renderer layouts
+void optimize_triangle_order(
+    u32* indices, const u32 indexCount, const u8* vertexData, const u32 vertexSize,
+    const u32 vertexCount, allocator::PagedArena scratchArena) {
+
+    const u32 triangleCount = indexCount / 3;
+    if (!triangleCount) { return; }
+
+    // vertex to triangle adjacency
+    u32* liveTriangles = ALLOC_ARRAY(scratchArena, u32, vertexCount);
+    u32* adjacencyOffsets = ALLOC_ARRAY(scratchArena, u32, vertexCount + 1);
+    u32* adjacency = ALLOC_ARRAY(scratchArena, u32, indexCount);
+    memset(liveTriangles, 0, sizeof(u32) * vertexCount);
+    for (u32 i = 0; i < indexCount; i++) { liveTriangles[indices[i]]++; }
+    adjacencyOffsets[0] = 0;
+    for (u32 v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+    {
+        u32* fill = ALLOC_ARRAY(scratchArena, u32, vertexCount);
+        memcpy(fill, adjacencyOffsets, sizeof(u32) * vertexCount);
+        for (u32 i = 0; i < indexCount; i++) { adjacency[fill[indices[i]]++] = i / 3; }
+    }
+
+    u32* cacheTime = ALLOC_ARRAY(scratchArena, u32, vertexCount);
+    memset(cacheTime, 0, sizeof(u32) * vertexCount);
+    u8* emitted = ALLOC_ARRAY(scratchArena, u8, triangleCount);
+    memset(emitted, 0, sizeof(u8) * triangleCount);
+    u32* deadEnd = ALLOC_ARRAY(scratchArena, u32, indexCount);
+    u32* candidates = ALLOC_ARRAY(scratchArena, u32, indexCount);
+    u32* order = ALLOC_ARRAY(scratchArena, u32, triangleCount);
+    Cluster* clusters = ALLOC_ARRAY(scratchArena, Cluster, triangleCount);
+    u32 deadEndCount = 0, orderCount = 0, clusterCount = 0;
+    u32 time = cacheSize + 1;
+    u32 cursor = 0;
+    bool clusterBoundary = true;
+    u32 fanning = 0;
+    while (fanning != invalidVertex) {
+        u32 candidateCount = 0;
+        for (u32 a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+            const u32 t = adjacency[a];
+            if (emitted[t]) { continue; }
+            u32 misses = 0;
+            for (u32 k = 0; k < 3; k++) {
+                const u32 v = indices[t * 3 + k];
+                deadEnd[deadEndCount++] = v;
+                candidates[candidateCount++] = v;
+                liveTriangles[v]--;
+                if (time - cacheTime[v] > cacheSize) { cacheTime[v] = time++; misses++; }
+            }
+            if (clusterBoundary || misses == 3) {
+                if (clusterCount) {
+                    Cluster& prev = clusters[clusterCount - 1];
+                    prev.count = orderCount - prev.start;
+                }
+                clusters[clusterCount++] = { 0.f, orderCount, 0 };
+                clusterBoundary = false;
+            }
+            emitted[t] = 1;
+            order[orderCount++] = t;
+        }
+
+        // prefer the vertex that entered the cache first, as long as fanning around it
+        // won't push it out
+        u32 next = invalidVertex;
+        s32 bestPriority = -1;
+        for (u32 c = 0; c < candidateCount; c++) {
+            const u32 v = candidates[c];
+            if (!liveTriangles[v]) { continue; }
+            s32 priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = (s32)(time - cacheTime[v]);
+            }
+            if (priority > bestPriority) { bestPriority = priority; next = v; }
+        }
+        if (next == invalidVertex) {
+            clusterBoundary = true;
+            while (deadEndCount) {
+                const u32 v = deadEnd[--deadEndCount];
+                if (liveTriangles[v]) { next = v; break; }
+            }
+            for (; next == invalidVertex && cursor < vertexCount; cursor++) {
+                if (liveTriangles[cursor]) { next = cursor; }
+            }
+        }
+        fanning = next;
+    }
+    assert(orderCount == triangleCount);
+    clusters[clusterCount - 1].count = orderCount - clusters[clusterCount - 1].start;
+
+    // overdraw: sort the clusters by how much they face away from the mesh centroid
+    // triangle cross products are their normal times twice their area, so they add up to area
+    // weighted normals, and weigh the centroids
+    {
+        float3* clusterCentroids = ALLOC_ARRAY(scratchArena, float3, clusterCount);
+        float3* clusterNormals = ALLOC_ARRAY(scratchArena, float3, clusterCount);
+        float3 meshCentroid(0.f, 0.f, 0.f);
+        f32 meshArea = 0.f;
+        for (u32 c = 0; c < clusterCount; c++) {
+            const Cluster& cluster = clusters[c];
+            float3 centroid(0.f, 0.f, 0.f);
+            float3 normal(0.f, 0.f, 0.f);
+            f32 area = 0.f;
+            for (u32 o = cluster.start; o < cluster.start + cluster.count; o++) {
+                const u32* tri = &indices[order[o] * 3];
+                const float3& v0 = *(const float3*)(vertexData + (size_t)tri[0] * vertexSize);
+                const float3& v1 = *(const float3*)(vertexData + (size_t)tri[1] * vertexSize);
+                const float3& v2 = *(const float3*)(vertexData + (size_t)tri[2] * vertexSize);
+                const float3 n = math::cross(math::subtract(v1, v0), math::subtract(v2, v0));
+                const f32 triArea = math::mag(n);
+                centroid = math::add(
+                    centroid, math::scale(math::add(math::add(v0, v1), v2), triArea / 3.f));
+                normal = math::add(normal, n);
+                area += triArea;
+            }
+            meshCentroid = math::add(meshCentroid, centroid);
+            meshArea += area;
+            clusterCentroids[c] = area > math::eps32 ? math::invScale(centroid, area) : centroid;
+            clusterNormals[c] = normal;
+        }
+        if (meshArea > math::eps32) { meshCentroid = math::invScale(meshCentroid, meshArea); }
+        for (u32 c = 0; c < clusterCount; c++) {
+            float3& normal = clusterNormals[c];
+            clusters[c].sortKey = math::normalizeSafe(normal) ?
+                math::dot(math::subtract(clusterCentroids[c], meshCentroid), normal) : 0.f;
+        }
+        if (clusterCount > 1) {
+            qsort(clusters, 0, (s32)clusterCount - 1, sizeof(Cluster), compareClusters);
+        }
+    }
+
+    u32* src = ALLOC_ARRAY(scratchArena, u32, triangleCount * 3);
+    memcpy(src, indices, sizeof(u32) * triangleCount * 3);
+    u32 dst = 0;
+    for (u32 c = 0; c < clusterCount; c++) {
+        const Cluster& cluster = clusters[c];
+        for (u32 o = cluster.start; o < cluster.start + cluster.count; o++) {
+            const u32* tri = &src[order[o] * 3];
+            indices[dst++] = tri[0];
+            indices[dst++] = tri[1];
+            indices[dst++] = tri[2];
+        }
+    }
+}
+
+// Moves the vertices into the order in which the indices first reference them, and remaps the
+// indices. Unreferenced vertices are dropped, returns the new vertex count
+u32 optimize_vertex_order(
+    u8* vertexData, const u32 vertexSize, const u32 vertexCount,
+    u32* indices, const u32 indexCount, allocator::PagedArena scratchArena) {
+    u32* remap = ALLOC_ARRAY(scratchArena, u32, vertexCount);
+    memset(remap, 0xff, sizeof(u32) * vertexCount);
+    u8* dst = ALLOC_ARRAY(scratchArena, u8, (size_t)vertexCount * vertexSize);
+    u32 count = 0;
+    for (u32 i = 0; i < indexCount; i++) {
+        const u32 v = indices[i];
+        if (remap[v] == invalidVertex) {
+            memcpy(dst + (size_t)count * vertexSize, vertexData + (size_t)v * vertexSize, vertexSize);
+            remap[v] = count++;
+        }
+        indices[i] = remap[v];
+    }
+    memcpy(vertexData, dst, (size_t)count * vertexSize);
+    return count;
+}
+
+}
+
+#endif // __WASTELADNS_MESHOPT_H__
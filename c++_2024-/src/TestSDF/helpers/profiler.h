@@ -0,0 +1,212 @@
+#ifndef __WASTELADNS_PROFILER_H__
+#define __WASTELADNS_PROFILER_H__
+
+#if __PROFILE
+namespace profiler {
+
+// Hierarchical CPU timing zones, the CPU side of gfx::rhi::start_event / end_event. Calls should
+// be wrapped in __PROFILEONLY, so that they compile out along with this file when __PROFILE is 0
+// Each thread writes the zones it closes to its own ring, indexed by jobs::workerId. The owner is
+// the only writer, and it publishes each zone by bumping the ring's write count once the zone
+// is written, so recording takes no locks. Rings are read on the main thread in end_frame;
+// zones recorded by workers while it reads may get overwritten if the ring wraps around, which
+// is acceptable for a debug view. Timestamps are rdtsc, calibrated against platform::time_seconds
+
+const u32 ringCapacity = 4096; // zones, power of two
+const u32 maxZoneDepth = 32;
+const u32 maxStages = 64;
+const u32 stageHistoryCount = 60; // frames of the rolling average
+
+struct Zone {
+    const char* name; // not copied, zones should be named with string literals
+    u64 start;
+    u64 end;
+    u32 depth;
+};
+struct Ring {
+    Zone zones[ringCapacity];
+    volatile s64 written;
+    s64 read; // main thread only
+    const char* openNames[maxZoneDepth];
+    u64 openStarts[maxZoneDepth];
+    u32 depth;
+};
+// every zone with the same name adds to the same stage, over all threads and calls in a frame
+struct Stage {
+    const char* name;
+    u64 cycles[stageHistoryCount];
+    u64 firstStart; // stages are listed in the order their first zones started
+    u32 calls;
+    u32 depth; // of the first zone seen, for display
+    u32 workerId; // of the first zone seen
+    u64 totalCycles; // since the last reset_totals, for runs longer than the history
+    u32 totalCalls;
+};
+struct State {
+    Ring rings[jobs::maxWorkers];
+    Stage stages[maxStages];
+    u32 stageCount;
+    u32 frameCount;
+    u64 startCycles;
+    f64 startSeconds;
+    f64 cyclesPerSecond;
+};
+
+State state;
+
+void init() {
+    state.stageCount = 0;
+    state.frameCount = 0;
+    state.startCycles = __rdtsc();
+    state.startSeconds = platform::time_seconds();
+    state.cyclesPerSecond = 0.;
+}
+
+force_inline void start_zone(const char* name) {
+    Ring& ring = state.rings[jobs::workerId];
+    assert(ring.depth < maxZoneDepth);
+    ring.openNames[ring.depth] = name;
+    ring.openStarts[ring.depth++] = __rdtsc();
+}
+force_inline void end_zone() {
+    const u64 end = __rdtsc();
+    Ring& ring = state.rings[jobs::workerId];
+    assert(ring.depth > 0);
+    ring.depth--;
+    const s64 written = ring.written;
+    Zone& zone = ring.zones[written & (ringCapacity - 1)];
+    zone.name = ring.openNames[ring.depth];
+    zone.start = ring.openStarts[ring.depth];
+    zone.end = end;
+    zone.depth = ring.depth;
+    atomic::store(&ring.written, written + 1);
+}
+
+// Adds the zones closed since the last call to the per stage history, and refines the rdtsc rate.
+// Should be called once per frame from the main thread, with no zones open on it
+void end_frame() {
+    assert(state.rings[0].depth == 0);
+    const f64 elapsedSeconds = platform::time_seconds() - state.startSeconds;
+    if (elapsedSeconds > 0.) { state.cyclesPerSecond = (__rdtsc() - state.startCycles) / elapsedSeconds; }
+
+    const u32 historyIdx = state.frameCount % stageHistoryCount;
+    const u32 prevStageCount = state.stageCount;
+    for (u32 i = 0; i < state.stageCount; i++) {
+        state.stages[i].cycles[historyIdx] = 0;
+        state.stages[i].calls = 0;
+    }
+    for (u32 w = 0; w < jobs::pool.workerCount; w++) {
+        Ring& ring = state.rings[w];
+        const s64 written = atomic::load(&ring.written);
+        for (s64 z = math::max(ring.read, written - (s64)ringCapacity); z < written; z++) {
+            const Zone& zone = ring.zones[z & (ringCapacity - 1)];
+            u32 s = 0;
+            for (; s < state.stageCount; s++) {
+                const char* name = state.stages[s].name;
+                if (name == zone.name || strcmp(name, zone.name) == 0) { break; }
+            }
+            if (s == state.stageCount) {
+                if (state.stageCount == maxStages) { continue; }
+                Stage& stage = state.stages[state.stageCount++];
+                stage = {};
+                stage.name = zone.name;
+                stage.firstStart = zone.start;
+                stage.depth = zone.depth;
+                stage.workerId = w;
+            }
+            state.stages[s].cycles[historyIdx] += zone.end - zone.start;
+            state.stages[s].calls++;
+            state.stages[s].totalCycles += zone.end - zone.start;
+            state.stages[s].totalCalls++;
+        }
+        ring.read = written;
+    }
+    // parents start before their children, so new stages sorted by start follow the hierarchy
+    for (u32 i = math::max(prevStageCount, 1u); i < state.stageCount; i++) {
+        const Stage stage = state.stages[i];
+        u32 j = i;
+        for (; j > prevStageCount && state.stages[j - 1].firstStart > stage.firstStart; j--) {
+            state.stages[j] = state.stages[j - 1];
+        }
+        state.stages[j] = stage;
+    }
+    state.frameCount++;
+}
+
+void reset_totals() {
+    for (u32 i = 0; i < state.stageCount; i++) {
+        state.stages[i].totalCycles = 0;
+        state.stages[i].totalCalls = 0;
+    }
+}
+
+// Average over the last stageHistoryCount frames, miscalculated until the history is full
+f64 get_stage_ms(const Stage& stage) {
+    if (state.cyclesPerSecond <= 0.) { return 0.; }
+    u64 cycles = 0;
+    for (u32 i = 0; i < stageHistoryCount; i++) { cycles += stage.cycles[i]; }
+    return 1000. * cycles / (stageHistoryCount * state.cyclesPerSecond);
+}
+
+// Writes every zone still in the rings as Chrome trace events (chrome://tracing, or Perfetto),
+// one track per worker. Should be called from the main thread, between frames
+bool write_chrome_trace(const char* path) {
+    FILE* f;
+    if (io::fopen(&f, path, "w") != 0 || !f) { return false; }
+    const f64 cyclesToUs = state.cyclesPerSecond > 0. ? 1000000. / state.cyclesPerSecond : 0.;
+    io::fprintf(f, "{\"traceEvents\":[\n");
+    for (u32 w = 0; w < jobs::pool.workerCount; w++) {
+        io::fprintf(f,
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s %d\"}},\n", w, w ? "worker" : "main", w);
+    }
+    u32 zoneCount = 0;
+    for (u32 w = 0; w < jobs::pool.workerCount; w++) {
+        Ring& ring = state.rings[w];
+        const s64 written = atomic::load(&ring.written);
+        for (s64 z = math::max((s64)0, written - (s64)ringCapacity); z < written; z++) {
+            const Zone& zone = ring.zones[z & (ringCapacity - 1)];
+            io::fprintf(f,
+                "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                zoneCount++ ? ",\n" : "", zone.name, w,
+                (s64)(zone.start - state.startCycles) * cyclesToUs,
+                (zone.end - zone.start) * cyclesToUs);
+        }
+    }
+    io::fprintf(f, "\n]}\n");
+    io::fclose(f);
+    return true;
+}
+
+}
+#endif
+
+#if __ARENA_TRACKING
+namespace allocator {
+// Writes the frames still in the arena tracking timeline, one row per callsite and arena that
+// allocated in each frame, with how far into that arena the frame's allocations reached (the
+// highest of them across frames is the size the arena needs). Lives here rather than in
+// allocator.h, which is included before io.h
+bool write_tracking_csv(const char* path) {
+    FILE* f;
+    if (io::fopen(&f, path, "w") != 0 || !f) { return false; }
+    io::fprintf(f, "frame,arena,arena id,arena highmark,file,line,allocations,bytes,alignment waste\n");
+    const u64 first =
+        tracker.timelineCount > Tracker::TimelineCapacity ?
+            tracker.timelineCount - Tracker::TimelineCapacity : 0;
+    for (u64 i = first; i < tracker.timelineCount; i++) {
+        const TrackedFrame& entry = tracker.timeline[i & (Tracker::TimelineCapacity - 1)];
+        const TrackedCallsite& callsite = tracker.callsites[entry.callsite];
+        const TrackedArena& arena = tracker.arenas[callsite.arena];
+        io::fprintf(f, "%u,%s,%u,%llu,%s,%u,%u,%llu,%llu\n", entry.frame,
+            arena.name ? arena.name : "untracked", callsite.arena, (unsigned long long)entry.arenaHighmark,
+            callsite.file, callsite.line,
+            entry.allocs, (unsigned long long)entry.bytes, (unsigned long long)entry.waste);
+    }
+    io::fclose(f);
+    return true;
+}
+}
+#endif
+
+#endif // __WASTELADNS_PROFILER_H__
@@ -3,7 +3,7 @@
 
 // STB
 
-allocator::PagedArena* Allocator_stb_arena = nullptr;
+thread_local allocator::PagedArena* Allocator_stb_arena = nullptr; // per thread, so images can be decoded by jobs
 struct Allocator_stb {
 	static void* malloc(size_t size) {
 		return allocator::alloc_arena(*Allocator_stb_arena, size, 16);
@@ -26,6 +26,10 @@
 	#endif
 #endif
 
+#define __BVH_WIDE_INDICES 0 // u32 bvh indices, for mirror meshes over ~21k triangles
+#define __ARENA_TRACKING 0 // per callsite arena allocation stats, see allocator.h
+#define __COOK_ASSETS __DEBUG // re-cook stale assets at load, and the offline cooker, see scene.h
+
 #include "helpers/core.h"
 #include "helpers/math.h"
 #include "helpers/allocator.h"
@@ -34,6 +38,8 @@
 #include "libs.h"
 
 #include "helpers/io.h"
+#include "helpers/jobs.h"
+#include "helpers/profiler.h"
 #include "helpers/easing.h"
 #include "helpers/vec.h"
 #include "helpers/angle.h"
@@ -41,6 +47,7 @@
 #include "helpers/transform.h"
 #include "helpers/color.h"
 #include "helpers/bvh.h"
+#include "helpers/meshopt.h"
 #include "helpers/input/input.h"
 #include "helpers/platform.h"
 #include "helpers/easing.h"
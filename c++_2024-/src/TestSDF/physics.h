@@ -25,18 +25,142 @@ struct ObjectType { enum Enum {
 static_assert(ObjectType::Bits < 16, "check");
 typedef u32 Handle;
 
+// How the candidate collision pairs are found every substep. All of them produce the same pairs
+// (in different orders): balls whose circles overlap in xy, and balls whose xy box overlaps an
+// obstacle's (every ball and obstacle pair for BruteForce)
+// BruteForce pairs every ball with everything, as a reference for the others
+// Walls aren't part of it: a ball behind a wall is pushed back out at any distance, so every
+// ball is tested against every wall (there are only a few of them)
+struct BroadphaseType { enum Enum { BruteForce, SpatialHash, SortAndSweep, Count }; };
+const char* broadphaseNames[] = { "brute force", "spatial hash", "sort and sweep" };
+static_assert(countof(broadphaseNames) == BroadphaseType::Count, "check");
+
+// Structure of arrays storage of the balls, for the AVX kernels. Arrays are padded to a multiple
+// of 8 balls, padding balls have zero radius and mass and are never written back
+struct BallsSoA {
+    f32* posx;
+    f32* posy;
+    f32* posz;
+    f32* velx;
+    f32* vely;
+    f32* velz;
+    f32* radius;
+    f32* mass;
+};
+force_inline u32 soaCapacity(const u32 count) { return (count + 7) & ~7u; }
+
 struct Scene {
     float3 gravity;
-    f32 dt;
+    f32 dt; // accumulated time that hasn't been simulated yet, less than a substep after each update
+    f32 substepLength;
+    u32 maxSubsteps; // per update, time past this budget is dropped
+    u32 substepCount; // run by the last update
     float2 bounds;
-	f32 restitution;
-	u32 wall_count;
-	u32 obstacle_count;
-	u32 ball_count;
-	StaticObject_Line walls[8];
-	StaticObject_Sphere obstacles[8];
-	DynamicObject_Sphere balls[8];
+    f32 restitution;
+    u32 wall_count;
+    u32 obstacle_count;
+    u32 ball_count;
+    u32 wall_cap;
+    u32 obstacle_cap;
+    u32 ball_cap;
+    StaticObject_Line* walls;
+    StaticObject_Sphere* obstacles;
+    DynamicObject_Sphere* balls;
+    u32* sweepOrder; // balls sorted by min x, kept across substeps for BroadphaseType::SortAndSweep
+    u32 sweepCount; // balls in sweepOrder, it's rebuilt if it doesn't match ball_count
+    // with simd set, soa holds the balls and the balls array may be out of date: it's only
+    // synced back when the scalar path runs again. soa is rebuilt from the balls array
+    // whenever soaCount doesn't match ball_count
+    BallsSoA soa;
+    u32 soaCount;
+    float3* prevPos; // ball positions before the last substep, to interpolate from
+    u32 prevCount; // balls in prevPos
+    BroadphaseType::Enum broadphase;
+    bool simd;
 };
+void init_scene(
+    Scene& scene, const u32 maxWalls, const u32 maxObstacles, const u32 maxBalls,
+    allocator::PagedArena& arena) {
+    scene.wall_cap = maxWalls;
+    scene.obstacle_cap = maxObstacles;
+    scene.ball_cap = maxBalls;
+    scene.walls = ALLOC_ARRAY(arena, StaticObject_Line, maxWalls);
+    scene.obstacles = ALLOC_ARRAY(arena, StaticObject_Sphere, maxObstacles);
+    scene.balls = ALLOC_ARRAY(arena, DynamicObject_Sphere, maxBalls);
+    scene.sweepOrder = ALLOC_ARRAY(arena, u32, maxBalls);
+    scene.prevPos = ALLOC_ARRAY(arena, float3, maxBalls);
+    const u32 soaCap = soaCapacity(maxBalls);
+    f32** soaArrays[] = {
+        &scene.soa.posx, &scene.soa.posy, &scene.soa.posz, &scene.soa.velx, &scene.soa.vely, &scene.soa.velz,
+        &scene.soa.radius, &scene.soa.mass };
+    for (u32 i = 0; i < countof(soaArrays); i++) {
+        *soaArrays[i] = ALLOC_ARRAY(arena, f32, soaCap);
+        memset(*soaArrays[i], 0, soaCap * sizeof(f32));
+    }
+    scene.wall_count = scene.obstacle_count = scene.ball_count = scene.sweepCount = scene.soaCount = 0;
+    scene.prevCount = scene.substepCount = 0;
+    scene.dt = 0.f;
+    scene.substepLength = 1 / 60.f;
+    scene.maxSubsteps = 4;
+    scene.broadphase = BroadphaseType::SpatialHash;
+    scene.simd = true; // faster than the scalar path at every count, see benchmarkSolver
+}
+void ballsToSoA(BallsSoA& soa, const DynamicObject_Sphere* balls, const u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        const DynamicObject_Sphere& b = balls[i];
+        soa.posx[i] = b.pos.x; soa.posy[i] = b.pos.y; soa.posz[i] = b.pos.z;
+        soa.velx[i] = b.vel.x; soa.vely[i] = b.vel.y; soa.velz[i] = b.vel.z;
+        soa.radius[i] = b.radius;
+        soa.mass[i] = b.mass;
+    }
+    for (u32 i = count; i < soaCapacity(count); i++) {
+        soa.posx[i] = soa.posy[i] = soa.posz[i] = soa.velx[i] = soa.vely[i] = soa.velz[i] = 0.f;
+        soa.radius[i] = soa.mass[i] = 0.f;
+    }
+}
+void ballsFromSoA(DynamicObject_Sphere* balls, const BallsSoA& soa, const u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        DynamicObject_Sphere& b = balls[i];
+        b.pos = float3(soa.posx[i], soa.posy[i], soa.posz[i]);
+        b.vel = float3(soa.velx[i], soa.vely[i], soa.velz[i]);
+    }
+}
+force_inline DynamicObject_Sphere loadBall(const BallsSoA& soa, const u32 i) {
+    DynamicObject_Sphere b;
+    b.pos = float3(soa.posx[i], soa.posy[i], soa.posz[i]);
+    b.vel = float3(soa.velx[i], soa.vely[i], soa.velz[i]);
+    b.radius = soa.radius[i];
+    b.mass = soa.mass[i];
+    return b;
+}
+force_inline void storeBall(BallsSoA& soa, const u32 i, const DynamicObject_Sphere& b) {
+    soa.posx[i] = b.pos.x; soa.posy[i] = b.pos.y; soa.posz[i] = b.pos.z;
+    soa.velx[i] = b.vel.x; soa.vely[i] = b.vel.y; soa.velz[i] = b.vel.z;
+}
+force_inline float3 get_ball_pos(const Scene& scene, const u32 i) {
+    if (i < scene.soaCount) { return float3(scene.soa.posx[i], scene.soa.posy[i], scene.soa.posz[i]); }
+    return scene.balls[i].pos;
+}
+// Position between the last two substeps, by the time left in the accumulator. It lags up to a
+// substep behind, but moves smoothly no matter how many substeps each frame runs
+force_inline float3 get_ball_render_pos(const Scene& scene, const u32 i) {
+    const float3 pos = get_ball_pos(scene, i);
+    if (i >= scene.prevCount) { return pos; }
+    return math::lerp(scene.dt / scene.substepLength, scene.prevPos[i], pos);
+}
+
+force_inline StaticObject_Line& add_wall(Scene& scene) {
+    assert(scene.wall_count < scene.wall_cap);
+    return scene.walls[scene.wall_count++];
+}
+force_inline StaticObject_Sphere& add_obstacle(Scene& scene) {
+    assert(scene.obstacle_count < scene.obstacle_cap);
+    return scene.obstacles[scene.obstacle_count++];
+}
+force_inline DynamicObject_Sphere& add_ball(Scene& scene) {
+    assert(scene.ball_count < scene.ball_cap);
+    return scene.balls[scene.ball_count++];
+}
 force_inline Handle handleFromObject(StaticObject_Line& w, Scene& scene) {
 	return (u32(&w - scene.walls) << ObjectType::Bits) | ObjectType::StaticLine;
 }
@@ -62,116 +186,846 @@ void updatePositionFromHandle(Scene& scene, Handle& handle, const float3 pos, co
 	else if (type == ObjectType::DynamicSphere) {
 		u32 index = handle >> ObjectType::Bits;
 		DynamicObject_Sphere& b = scene.balls[index];
+		if (index < scene.soaCount) { b = loadBall(scene.soa, index); }
 		b.vel = math::invScale(math::subtract(pos, b.pos), dt);
 		b.pos = pos;
+		if (index < scene.soaCount) { storeBall(scene.soa, index, b); }
 	}
 }
 
-void updatePhysics(Scene& scene, f32 game_dt)
-{
-    const f32 substep_length = 1 / 60.f; // todo: understepping?
-    scene.dt += game_dt;
-    u32 steps = (u32)math::ceil(scene.dt / substep_length);
-    for (u32 s = 0; s < steps; s++) {
-		f32 dt;
-		if (scene.dt < substep_length * 1.01f) { dt = scene.dt; s++; scene.dt = 0.f; }
-		else { dt = substep_length; scene.dt -= substep_length; }
-		for (u32 i = 0; i < scene.ball_count; i++) {
-			physics::DynamicObject_Sphere& b1 = scene.balls[i];
-
-			b1.vel = math::add(b1.vel, math::scale(scene.gravity, dt));
-			b1.pos = math::add(b1.pos, math::scale(b1.vel, dt));
-
-			for (u32 j = i + 1; j < scene.ball_count; j++) {
-				physics::DynamicObject_Sphere& b2 = scene.balls[j];
-
-				float3 collisionDir = math::subtract(b2.pos, b1.pos);
-				collisionDir.z = 0.f;
-				f32 dist = math::mag(collisionDir);
-				if (dist < math::eps32 || dist > b1.radius + b2.radius) continue;
-
-				collisionDir = math::invScale(collisionDir, dist);
-				f32 correction = (b1.radius + b2.radius - dist) / 2.f;
-				b1.pos = math::add(b1.pos, math::scale(collisionDir, -correction));
-				b2.pos = math::add(b2.pos, math::scale(collisionDir, correction));
-				f32 v1 = math::dot(b1.vel, collisionDir);
-				f32 v2 = math::dot(b2.vel, collisionDir);
-				f32 m1 = b1.mass;
-				f32 m2 = b2.mass;
-				f32 nextv1 = (m1 * v1 + m2 * v2 - m2 * (v1 - v2) * scene.restitution) / (m1 + m2);
-				f32 nextv2 = (m1 * v1 + m2 * v2 - m1 * (v2 - v1) * scene.restitution) / (m1 + m2);
-				b1.vel = math::add(b1.vel, math::scale(collisionDir, nextv1 - v1));
-				b2.vel = math::add(b2.vel, math::scale(collisionDir, nextv2 - v2));
-			}
+struct Pair {
+    u32 a; // ball
+    u32 b; // ball (greater than a) or obstacle
+};
+struct Pairs {
+    allocator::Buffer<Pair> balls;
+    allocator::Buffer<Pair> obstacles;
+};
+struct Box2D {
+    float2 min;
+    float2 max;
+};
+force_inline Box2D boxFromObject(const StaticObject_Sphere& o) {
+    return { float2(o.pos.x - o.radius, o.pos.y - o.radius),
+             float2(o.pos.x + o.radius, o.pos.y + o.radius) };
+}
+// Strided xy positions and radii of the balls, so the broadphase reads either storage
+struct BallView {
+    const f32* x;
+    const f32* y;
+    const f32* radius;
+    u32 stride; // in floats
+    u32 count;
+};
+force_inline f32 ballX(const BallView& v, const u32 i) { return v.x[i * v.stride]; }
+force_inline f32 ballY(const BallView& v, const u32 i) { return v.y[i * v.stride]; }
+force_inline f32 ballRadius(const BallView& v, const u32 i) { return v.radius[i * v.stride]; }
+force_inline BallView viewFromBalls(const Scene& scene) {
+    const u32 stride = sizeof(DynamicObject_Sphere) / sizeof(f32);
+    return { &scene.balls[0].pos.x, &scene.balls[0].pos.y, &scene.balls[0].radius, stride, scene.ball_count };
+}
+force_inline BallView viewFromBalls(const BallsSoA& soa, const u32 count) {
+    return { soa.posx, soa.posy, soa.radius, 1, count };
+}
+force_inline bool overlaps(const BallView& v, const u32 i, const Box2D& box) {
+    const f32 x = ballX(v, i), y = ballY(v, i), r = ballRadius(v, i);
+    return x + r >= box.min.x && x - r <= box.max.x
+        && y + r >= box.min.y && y - r <= box.max.y;
+}
+force_inline bool overlaps(const BallView& v, const u32 i, const u32 j) {
+    const f32 dx = ballX(v, j) - ballX(v, i), dy = ballY(v, j) - ballY(v, i);
+    const f32 r = ballRadius(v, i) + ballRadius(v, j);
+    return dx * dx + dy * dy <= r * r;
+}
 
-			for (u32 j = 0; j < scene.obstacle_count; j++) {
-				physics::StaticObject_Sphere& o = scene.obstacles[j];
+void findPairsBruteForce(Pairs& pairs, const Scene& scene, const BallView& balls, allocator::PagedArena& arena) {
+    for (u32 i = 0; i < balls.count; i++) {
+        for (u32 j = i + 1; j < balls.count; j++) {
+            if (overlaps(balls, i, j)) { allocator::push(pairs.balls, arena) = { i, j }; }
+        }
+    }
+    for (u32 j = 0; j < scene.obstacle_count; j++) {
+        for (u32 i = 0; i < balls.count; i++) { allocator::push(pairs.obstacles, arena) = { i, j }; }
+    }
+}
+
+// Uniform grid in xy, with cells as wide as the biggest ball, so that overlapping balls are
+// at most one cell apart. Cells are hashed into twice as many buckets as balls, and the balls
+// are counting sorted by bucket
+struct SpatialHash {
+    u32* bucketStart; // bucketCount + 1 offsets into ballIds
+    u32* ballIds; // sorted by bucket
+    s32* cells; // x and y cell of each ball
+    f32 invCellSize;
+    u32 bucketMask;
+};
+force_inline u32 hashCell(const s32 x, const s32 y) { return ((u32)x * 73856093u) ^ ((u32)y * 19349663u); }
+force_inline s32 cellCoord(const f32 v, const f32 invCellSize) { return (s32)math::floor(v * invCellSize); }
+void buildSpatialHash(
+    SpatialHash& hash, const BallView& balls, const f32 cellSize, allocator::PagedArena& arena) {
+    u32 bucketCount = 2;
+    while (bucketCount < balls.count * 2) { bucketCount *= 2; }
+    hash.bucketMask = bucketCount - 1;
+    hash.invCellSize = 1.f / cellSize;
+    hash.bucketStart = ALLOC_ARRAY(arena, u32, bucketCount + 1);
+    hash.ballIds = ALLOC_ARRAY(arena, u32, balls.count);
+    hash.cells = ALLOC_ARRAY(arena, s32, balls.count * 2);
+    u32* ballBuckets = ALLOC_ARRAY(arena, u32, balls.count);
+    memset(hash.bucketStart, 0, (bucketCount + 1) * sizeof(u32));
+    for (u32 i = 0; i < balls.count; i++) {
+        const s32 x = cellCoord(ballX(balls, i), hash.invCellSize), y = cellCoord(ballY(balls, i), hash.invCellSize);
+        hash.cells[i * 2] = x;
+        hash.cells[i * 2 + 1] = y;
+        ballBuckets[i] = hashCell(x, y) & hash.bucketMask;
+        hash.bucketStart[ballBuckets[i] + 1]++;
+    }
+    for (u32 b = 0; b < bucketCount; b++) { hash.bucketStart[b + 1] += hash.bucketStart[b]; }
+    // fill each bucket back to front, so each ends at its start offset
+    for (u32 i = 0; i < balls.count; i++) {
+        hash.ballIds[hash.bucketStart[ballBuckets[i] + 1] - 1] = i;
+        hash.bucketStart[ballBuckets[i] + 1]--;
+    }
+    for (u32 b = 0; b < bucketCount; b++) { hash.bucketStart[b] = hash.bucketStart[b + 1]; }
+    hash.bucketStart[bucketCount] = balls.count;
+}
+// visit(ballId) gets each ball whose center is in the cell, skipping others sharing its bucket
+template<typename _Visit>
+void visitCell(const SpatialHash& hash, const s32 x, const s32 y, _Visit&& visit) {
+    const u32 bucket = hashCell(x, y) & hash.bucketMask;
+    for (u32 k = hash.bucketStart[bucket]; k < hash.bucketStart[bucket + 1]; k++) {
+        const u32 id = hash.ballIds[k];
+        if (hash.cells[id * 2] == x && hash.cells[id * 2 + 1] == y) { visit(id); }
+    }
+}
+void findPairsSpatialHash(
+    Pairs& pairs, const Scene& scene, const BallView& balls, const f32 maxRadius,
+    allocator::PagedArena& arena) {
+    SpatialHash hash;
+    buildSpatialHash(hash, balls, math::max(2.f * maxRadius, 0.001f), arena);
+    for (u32 i = 0; i < balls.count; i++) {
+        const s32 x = hash.cells[i * 2], y = hash.cells[i * 2 + 1];
+        for (s32 dy = -1; dy <= 1; dy++) {
+            for (s32 dx = -1; dx <= 1; dx++) {
+                visitCell(hash, x + dx, y + dy, [&](const u32 j) {
+                    if (j > i && overlaps(balls, i, j)) {
+                        allocator::push(pairs.balls, arena) = { i, j };
+                    }
+                });
+            }
+        }
+    }
+    // obstacles visit the cells their box touches, grown by the biggest ball,
+    // or all the balls if that's cheaper
+    for (u32 j = 0; j < scene.obstacle_count; j++) {
+        const Box2D box = boxFromObject(scene.obstacles[j]);
+        const s32 x0 = cellCoord(box.min.x - maxRadius, hash.invCellSize);
+        const s32 y0 = cellCoord(box.min.y - maxRadius, hash.invCellSize);
+        const s32 x1 = cellCoord(box.max.x + maxRadius, hash.invCellSize);
+        const s32 y1 = cellCoord(box.max.y + maxRadius, hash.invCellSize);
+        const u64 cellCount = (u64)(x1 - x0 + 1) * (u64)(y1 - y0 + 1);
+        if (cellCount > balls.count) {
+            for (u32 i = 0; i < balls.count; i++) {
+                if (overlaps(balls, i, box)) { allocator::push(pairs.obstacles, arena) = { i, j }; }
+            }
+            continue;
+        }
+        for (s32 y = y0; y <= y1; y++) {
+            for (s32 x = x0; x <= x1; x++) {
+                visitCell(hash, x, y, [&](const u32 i) {
+                    if (overlaps(balls, i, box)) { allocator::push(pairs.obstacles, arena) = { i, j }; }
+                });
+            }
+        }
+    }
+}
 
-				float3 collisionDir = math::subtract(b1.pos, o.pos);
-				collisionDir.z = 0.f;
-				f32 dist = math::mag(collisionDir);
-				if (dist < math::eps32 || dist > b1.radius + o.radius) continue;
+// Balls stay sorted by the left side of their box across substeps. Since they barely move
+// between substeps, an insertion sort is close to linear
+s64 compareSweepKeys(const void* a, const void* b) {
+    const u64 ka = *(const u64*)a, kb = *(const u64*)b;
+    return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+force_inline u32 sortableFloat(const f32 v) { // flips the bits so that unsigned order matches float order
+    u32 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+void findPairsSortAndSweep(
+    Pairs& pairs, Scene& scene, const BallView& balls, const f32 maxRadius,
+    allocator::PagedArena& arena) {
+    const u32 count = balls.count;
+    u32* order = scene.sweepOrder;
+    auto minX = [&](const u32 i) { return ballX(balls, i) - ballRadius(balls, i); };
+    if (scene.sweepCount != count) { // full sort
+        u64* keys = ALLOC_ARRAY(arena, u64, count);
+        for (u32 i = 0; i < count; i++) { keys[i] = ((u64)sortableFloat(minX(i)) << 32) | i; }
+        if (count > 1) { qsort(keys, 0, count - 1, sizeof(u64), compareSweepKeys); }
+        for (u32 i = 0; i < count; i++) { order[i] = (u32)keys[i]; }
+        scene.sweepCount = count;
+    } else {
+        for (u32 i = 1; i < count; i++) {
+            const u32 id = order[i];
+            const f32 key = minX(id);
+            u32 j = i;
+            for (; j > 0 && minX(order[j - 1]) > key; j--) { order[j] = order[j - 1]; }
+            order[j] = id;
+        }
+    }
+    f32* sortedMinX = ALLOC_ARRAY(arena, f32, count);
+    for (u32 i = 0; i < count; i++) { sortedMinX[i] = minX(order[i]); }
 
-				collisionDir = math::invScale(collisionDir, dist);
-				f32 correction = b1.radius + o.radius - dist;
-				b1.pos = math::add(b1.pos, math::scale(collisionDir, correction));
-				f32 v1 = math::dot(b1.vel, collisionDir);
-				f32 v2 = math::dot(o.vel, collisionDir);
-				b1.vel = math::add(b1.vel, math::scale(collisionDir, (v2 - v1) * scene.restitution));
-			}
+    for (u32 i = 0; i < count; i++) {
+        const u32 a = order[i];
+        const f32 maxX = ballX(balls, a) + ballRadius(balls, a);
+        for (u32 k = i + 1; k < count && sortedMinX[k] <= maxX; k++) {
+            const u32 b = order[k];
+            if (overlaps(balls, a, b)) {
+                allocator::push(pairs.balls, arena) = { math::min(a, b), math::max(a, b) };
+            }
+        }
+    }
+    // obstacles look for the first ball that may reach them, no ball is wider than
+    // 2 * maxRadius, and sweep from there
+    for (u32 j = 0; j < scene.obstacle_count; j++) {
+        const Box2D box = boxFromObject(scene.obstacles[j]);
+        const f32 start = box.min.x - 2.f * maxRadius;
+        u32 lo = 0, hi = count;
+        while (lo < hi) {
+            const u32 mid = (lo + hi) / 2;
+            if (sortedMinX[mid] < start) { lo = mid + 1; } else { hi = mid; }
+        }
+        for (u32 k = lo; k < count && sortedMinX[k] <= box.max.x; k++) {
+            if (overlaps(balls, order[k], box)) { allocator::push(pairs.obstacles, arena) = { order[k], j }; }
+        }
+    }
+}
+
+void findPairs(
+    Pairs& pairs, Scene& scene, const BallView& balls, const BroadphaseType::Enum type, const f32 maxRadius,
+    allocator::PagedArena& arena) {
+    pairs = {};
+    switch (type) {
+    case BroadphaseType::BruteForce: findPairsBruteForce(pairs, scene, balls, arena); break;
+    case BroadphaseType::SpatialHash: findPairsSpatialHash(pairs, scene, balls, maxRadius, arena); break;
+    case BroadphaseType::SortAndSweep: findPairsSortAndSweep(pairs, scene, balls, maxRadius, arena); break;
+    default: break;
+    }
+}
+
+void resolveCollision(Scene& scene, DynamicObject_Sphere& b1, DynamicObject_Sphere& b2) {
+	float3 collisionDir = math::subtract(b2.pos, b1.pos);
+	collisionDir.z = 0.f;
+	f32 dist = math::mag(collisionDir);
+	if (dist < math::eps32 || dist > b1.radius + b2.radius) return;
+
+	collisionDir = math::invScale(collisionDir, dist);
+	f32 correction = (b1.radius + b2.radius - dist) / 2.f;
+	b1.pos = math::add(b1.pos, math::scale(collisionDir, -correction));
+	b2.pos = math::add(b2.pos, math::scale(collisionDir, correction));
+	f32 v1 = math::dot(b1.vel, collisionDir);
+	f32 v2 = math::dot(b2.vel, collisionDir);
+	f32 m1 = b1.mass;
+	f32 m2 = b2.mass;
+	f32 nextv1 = (m1 * v1 + m2 * v2 - m2 * (v1 - v2) * scene.restitution) / (m1 + m2);
+	f32 nextv2 = (m1 * v1 + m2 * v2 - m1 * (v2 - v1) * scene.restitution) / (m1 + m2);
+	b1.vel = math::add(b1.vel, math::scale(collisionDir, nextv1 - v1));
+	b2.vel = math::add(b2.vel, math::scale(collisionDir, nextv2 - v2));
+}
+void resolveCollision(Scene& scene, DynamicObject_Sphere& b1, const StaticObject_Sphere& o) {
+	float3 collisionDir = math::subtract(b1.pos, o.pos);
+	collisionDir.z = 0.f;
+	f32 dist = math::mag(collisionDir);
+	if (dist < math::eps32 || dist > b1.radius + o.radius) return;
+
+	collisionDir = math::invScale(collisionDir, dist);
+	f32 correction = b1.radius + o.radius - dist;
+	b1.pos = math::add(b1.pos, math::scale(collisionDir, correction));
+	f32 v1 = math::dot(b1.vel, collisionDir);
+	f32 v2 = math::dot(o.vel, collisionDir);
+	b1.vel = math::add(b1.vel, math::scale(collisionDir, (v2 - v1) * scene.restitution));
+}
+force_inline float3 closestPointOnWall(const float3 pos, const StaticObject_Line& w) {
+	float3 ab = math::subtract(w.end, w.start);
+	f32 t = math::max(0.f, 
+		math::min(1.f,
+			(math::dot(math::subtract(pos, w.start), ab)) / math::dot(ab, ab)));
+	return math::add(w.start, math::scale(ab, t));
+}
+// Balls in front of the wall touch it within their radius, balls behind it are pushed back to
+// the front from any distance, so one that tunneled through doesn't stay out
+void resolveCollision(Scene& scene, DynamicObject_Sphere& b1, const StaticObject_Line& w) {
+	// distance to wall
+	float3 ab = math::subtract(w.end, w.start);
+	float3 col = closestPointOnWall(b1.pos, w);
+	float3 d = math::subtract(b1.pos, col);
+	d.z = 0.f;
+	f32 dist = math::mag(d);
+	float3 normal(-ab.y, ab.x, ab.z);
+
+	// push out
+	if (dist == 0.f) {
+		d = normal;
+		dist = math::mag(normal);
+	}
+	d = math::invScale(d, dist);
+	if (math::dot(d, normal) >= 0.f) { // outside the wall
+		if (dist > b1.radius) return;
+		b1.pos = math::add(b1.pos, math::scale(d, b1.radius - dist));
+	} else { // inside the wall
+		b1.pos = math::add(b1.pos, math::scale(d, -(b1.radius + dist)));
+	}
 
+	// update velocity
+	f32 v = math::dot(b1.vel, d);
+	f32 vnew = math::abs(v) * scene.restitution;
+	b1.vel = math::add(b1.vel, math::scale(d, vnew - v));
+}
+void resolveBounds(Scene& scene, DynamicObject_Sphere& b1) {
+	if ((b1.pos.x + b1.radius) > scene.bounds.x) {
+		b1.pos.x = scene.bounds.x - b1.radius;
+		b1.vel.x = -b1.vel.x;
+	}
+	if ((b1.pos.x - b1.radius) < -scene.bounds.x) {
+		b1.pos.x = -scene.bounds.x + b1.radius;
+		b1.vel.x = -b1.vel.x;
+	}
+	if ((b1.pos.y + b1.radius) > scene.bounds.y) {
+		b1.pos.y = scene.bounds.y - b1.radius;
+		b1.vel.y = -b1.vel.y;
+	}
+	if ((b1.pos.y - b1.radius) < -scene.bounds.y) {
+		b1.pos.y = -scene.bounds.y + b1.radius;
+		b1.vel.y = -b1.vel.y;
+	}
+}
+
+// returns the biggest radius
+f32 integrateBalls(DynamicObject_Sphere* balls, const u32 count, const float3& gravity, const f32 dt) {
+	f32 maxRadius = 0.f;
+	for (u32 i = 0; i < count; i++) {
+		DynamicObject_Sphere& b1 = balls[i];
+		b1.vel = math::add(b1.vel, math::scale(gravity, dt));
+		b1.pos = math::add(b1.pos, math::scale(b1.vel, dt));
+		maxRadius = math::max(maxRadius, b1.radius);
+	}
+	return maxRadius;
+}
+
+// The kernels below mirror the scalar functions above operation by operation (multiplies and
+// adds are kept separate, no fma), so they only differ from them by the compiler's own contractions
+
+// returns the biggest radius
+f32 integrateBalls_256(BallsSoA& soa, const u32 count, const float3& gravity, const f32 dt) {
+    const __m256 dt8 = _mm256_set1_ps(dt);
+    const __m256 gx = _mm256_set1_ps(gravity.x * dt);
+    const __m256 gy = _mm256_set1_ps(gravity.y * dt);
+    const __m256 gz = _mm256_set1_ps(gravity.z * dt);
+    __m256 maxRadius = _mm256_setzero_ps();
+    for (u32 i = 0; i < count; i += 8) {
+        const __m256 vx = _mm256_add_ps(_mm256_loadu_ps(soa.velx + i), gx);
+        const __m256 vy = _mm256_add_ps(_mm256_loadu_ps(soa.vely + i), gy);
+        const __m256 vz = _mm256_add_ps(_mm256_loadu_ps(soa.velz + i), gz);
+        _mm256_storeu_ps(soa.velx + i, vx);
+        _mm256_storeu_ps(soa.vely + i, vy);
+        _mm256_storeu_ps(soa.velz + i, vz);
+        _mm256_storeu_ps(soa.posx + i, _mm256_add_ps(_mm256_loadu_ps(soa.posx + i), _mm256_mul_ps(vx, dt8)));
+        _mm256_storeu_ps(soa.posy + i, _mm256_add_ps(_mm256_loadu_ps(soa.posy + i), _mm256_mul_ps(vy, dt8)));
+        _mm256_storeu_ps(soa.posz + i, _mm256_add_ps(_mm256_loadu_ps(soa.posz + i), _mm256_mul_ps(vz, dt8)));
+        maxRadius = _mm256_max_ps(maxRadius, _mm256_loadu_ps(soa.radius + i));
+    }
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(maxRadius), _mm256_extractf128_ps(maxRadius, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+// same order as resolveBounds: the min side sees the position clamped by the max side
+force_inline void reflectAxis_256(f32* pos, f32* vel, const __m256 r, const f32 bound) {
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+    const __m256 hi = _mm256_set1_ps(bound);
+    const __m256 lo = _mm256_set1_ps(-bound);
+    __m256 p = _mm256_loadu_ps(pos);
+    __m256 v = _mm256_loadu_ps(vel);
+    const __m256 over = _mm256_cmp_ps(_mm256_add_ps(p, r), hi, _CMP_GT_OQ);
+    p = _mm256_blendv_ps(p, _mm256_sub_ps(hi, r), over);
+    v = _mm256_xor_ps(v, _mm256_and_ps(over, signMask));
+    const __m256 under = _mm256_cmp_ps(_mm256_sub_ps(p, r), lo, _CMP_LT_OQ);
+    p = _mm256_blendv_ps(p, _mm256_add_ps(lo, r), under);
+    v = _mm256_xor_ps(v, _mm256_and_ps(under, signMask));
+    _mm256_storeu_ps(pos, p);
+    _mm256_storeu_ps(vel, v);
+}
+void resolveBounds_256(BallsSoA& soa, const u32 count, const float2& bounds) {
+    for (u32 i = 0; i < count; i += 8) {
+        const __m256 r = _mm256_loadu_ps(soa.radius + i);
+        reflectAxis_256(soa.posx + i, soa.velx + i, r, bounds.x);
+        reflectAxis_256(soa.posy + i, soa.vely + i, r, bounds.y);
+    }
+}
+
+// Resolves up to 8 pairs that don't share any ball at once, lanes from n on are ignored
+void resolveBallPairBatch_256(BallsSoA& soa, const __m256i a, const __m256i b, const u32 n, const f32 restitution) {
+    __m256 p1x = _mm256_i32gather_ps(soa.posx, a, 4), p1y = _mm256_i32gather_ps(soa.posy, a, 4);
+    __m256 p2x = _mm256_i32gather_ps(soa.posx, b, 4), p2y = _mm256_i32gather_ps(soa.posy, b, 4);
+    const __m256 rsum = _mm256_add_ps(_mm256_i32gather_ps(soa.radius, a, 4), _mm256_i32gather_ps(soa.radius, b, 4));
+    const __m256 dx = _mm256_sub_ps(p2x, p1x), dy = _mm256_sub_ps(p2y, p1y);
+    const __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+    const __m256 lanes = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+    const __m256 active = _mm256_and_ps(
+        _mm256_cmp_ps(lanes, _mm256_set1_ps((f32)n), _CMP_LT_OQ),
+        _mm256_and_ps(
+            _mm256_cmp_ps(dist, _mm256_set1_ps(math::eps32), _CMP_GE_OQ),
+            _mm256_cmp_ps(dist, rsum, _CMP_LE_OQ)));
+    const u32 activeMask = (u32)_mm256_movemask_ps(active);
+    if (activeMask == 0) { return; }
+
+    __m256 v1x = _mm256_i32gather_ps(soa.velx, a, 4), v1y = _mm256_i32gather_ps(soa.vely, a, 4);
+    __m256 v2x = _mm256_i32gather_ps(soa.velx, b, 4), v2y = _mm256_i32gather_ps(soa.vely, b, 4);
+    const __m256 m1 = _mm256_i32gather_ps(soa.mass, a, 4), m2 = _mm256_i32gather_ps(soa.mass, b, 4);
+    const __m256 nx = _mm256_div_ps(dx, dist), ny = _mm256_div_ps(dy, dist);
+    const __m256 correction = _mm256_mul_ps(_mm256_sub_ps(rsum, dist), _mm256_set1_ps(0.5f));
+    p1x = _mm256_sub_ps(p1x, _mm256_mul_ps(nx, correction));
+    p1y = _mm256_sub_ps(p1y, _mm256_mul_ps(ny, correction));
+    p2x = _mm256_add_ps(p2x, _mm256_mul_ps(nx, correction));
+    p2y = _mm256_add_ps(p2y, _mm256_mul_ps(ny, correction));
+    // collisionDir.z is 0, so velocity z doesn't take part
+    const __m256 v1 = _mm256_add_ps(_mm256_mul_ps(v1x, nx), _mm256_mul_ps(v1y, ny));
+    const __m256 v2 = _mm256_add_ps(_mm256_mul_ps(v2x, nx), _mm256_mul_ps(v2y, ny));
+    const __m256 e = _mm256_set1_ps(restitution);
+    const __m256 momentum = _mm256_add_ps(_mm256_mul_ps(m1, v1), _mm256_mul_ps(m2, v2));
+    const __m256 massSum = _mm256_add_ps(m1, m2);
+    const __m256 nextv1 = _mm256_div_ps(
+        _mm256_sub_ps(momentum, _mm256_mul_ps(_mm256_mul_ps(m2, _mm256_sub_ps(v1, v2)), e)), massSum);
+    const __m256 nextv2 = _mm256_div_ps(
+        _mm256_sub_ps(momentum, _mm256_mul_ps(_mm256_mul_ps(m1, _mm256_sub_ps(v2, v1)), e)), massSum);
+    const __m256 dv1 = _mm256_sub_ps(nextv1, v1), dv2 = _mm256_sub_ps(nextv2, v2);
+    v1x = _mm256_add_ps(v1x, _mm256_mul_ps(nx, dv1));
+    v1y = _mm256_add_ps(v1y, _mm256_mul_ps(ny, dv1));
+    v2x = _mm256_add_ps(v2x, _mm256_mul_ps(nx, dv2));
+    v2y = _mm256_add_ps(v2y, _mm256_mul_ps(ny, dv2));
+
+    // no scatter in AVX2, inactive lanes are skipped
+    alignas(32) s32 ia[8], ib[8];
+    _mm256_store_si256((__m256i*)ia, a);
+    _mm256_store_si256((__m256i*)ib, b);
+    alignas(32) f32 out[8][8];
+    _mm256_store_ps(out[0], p1x); _mm256_store_ps(out[1], p1y);
+    _mm256_store_ps(out[2], p2x); _mm256_store_ps(out[3], p2y);
+    _mm256_store_ps(out[4], v1x); _mm256_store_ps(out[5], v1y);
+    _mm256_store_ps(out[6], v2x); _mm256_store_ps(out[7], v2y);
+    for (u32 l = 0; l < n; l++) {
+        if (!(activeMask & (1 << l))) { continue; }
+        soa.posx[ia[l]] = out[0][l]; soa.posy[ia[l]] = out[1][l];
+        soa.posx[ib[l]] = out[2][l]; soa.posy[ib[l]] = out[3][l];
+        soa.velx[ia[l]] = out[4][l]; soa.vely[ia[l]] = out[5][l];
+        soa.velx[ib[l]] = out[6][l]; soa.vely[ib[l]] = out[7][l];
+    }
+}
+// Resolves up to 8 pairs of different balls with the same obstacle at once, lanes from n on are ignored
+void resolveObstaclePairBatch_256(
+    BallsSoA& soa, const __m256i a, const u32 n, const StaticObject_Sphere& o, const f32 restitution) {
+    __m256 px = _mm256_i32gather_ps(soa.posx, a, 4), py = _mm256_i32gather_ps(soa.posy, a, 4);
+    const __m256 rsum = _mm256_add_ps(_mm256_i32gather_ps(soa.radius, a, 4), _mm256_set1_ps(o.radius));
+    const __m256 dx = _mm256_sub_ps(px, _mm256_set1_ps(o.pos.x)), dy = _mm256_sub_ps(py, _mm256_set1_ps(o.pos.y));
+    const __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+    const __m256 lanes = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+    const __m256 active = _mm256_and_ps(
+        _mm256_cmp_ps(lanes, _mm256_set1_ps((f32)n), _CMP_LT_OQ),
+        _mm256_and_ps(
+            _mm256_cmp_ps(dist, _mm256_set1_ps(math::eps32), _CMP_GE_OQ),
+            _mm256_cmp_ps(dist, rsum, _CMP_LE_OQ)));
+    const u32 activeMask = (u32)_mm256_movemask_ps(active);
+    if (activeMask == 0) { return; }
+
+    __m256 vx = _mm256_i32gather_ps(soa.velx, a, 4), vy = _mm256_i32gather_ps(soa.vely, a, 4);
+    const __m256 nx = _mm256_div_ps(dx, dist), ny = _mm256_div_ps(dy, dist);
+    const __m256 correction = _mm256_sub_ps(rsum, dist);
+    px = _mm256_add_ps(px, _mm256_mul_ps(nx, correction));
+    py = _mm256_add_ps(py, _mm256_mul_ps(ny, correction));
+    // collisionDir.z is 0, so velocity z doesn't take part
+    const __m256 v1 = _mm256_add_ps(_mm256_mul_ps(vx, nx), _mm256_mul_ps(vy, ny));
+    const __m256 v2 = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_set1_ps(o.vel.x), nx), _mm256_mul_ps(_mm256_set1_ps(o.vel.y), ny));
+    const __m256 dv = _mm256_mul_ps(_mm256_sub_ps(v2, v1), _mm256_set1_ps(restitution));
+    vx = _mm256_add_ps(vx, _mm256_mul_ps(nx, dv));
+    vy = _mm256_add_ps(vy, _mm256_mul_ps(ny, dv));
+
+    alignas(32) s32 ia[8];
+    _mm256_store_si256((__m256i*)ia, a);
+    alignas(32) f32 out[4][8];
+    _mm256_store_ps(out[0], px); _mm256_store_ps(out[1], py);
+    _mm256_store_ps(out[2], vx); _mm256_store_ps(out[3], vy);
+    for (u32 l = 0; l < n; l++) {
+        if (!(activeMask & (1 << l))) { continue; }
+        soa.posx[ia[l]] = out[0][l]; soa.posy[ia[l]] = out[1][l];
+        soa.velx[ia[l]] = out[2][l]; soa.vely[ia[l]] = out[3][l];
+    }
+}
+// The broadphase finds each obstacle's pairs together and none of them share a ball, so runs of
+// pairs with the same obstacle are batched in order
+void resolveObstaclePairs_256(
+    BallsSoA& soa, const Pair* pairs, const u32 pairCount, const StaticObject_Sphere* obstacles,
+    const f32 restitution) {
+    alignas(32) s32 batch[8];
+    u32 n = 0;
+    for (u32 p = 0; p < pairCount; p++) {
+        batch[n++] = (s32)pairs[p].a;
+        if (n == 8 || p + 1 == pairCount || pairs[p + 1].b != pairs[p].b) {
+            for (u32 l = n; l < 8; l++) { batch[l] = batch[0]; }
+            resolveObstaclePairBatch_256(
+                soa, _mm256_load_si256((const __m256i*)batch), n, obstacles[pairs[p].b], restitution);
+            n = 0;
+        }
+    }
+}
+// Every ball against one wall, 8 at a time. Padding balls are resolved too, they are never read
+void resolveWall_256(BallsSoA& soa, const u32 count, const StaticObject_Line& w, const f32 restitution) {
+    const float3 ab = math::subtract(w.end, w.start);
+    const float3 normal(-ab.y, ab.x, ab.z);
+    const __m256 sx = _mm256_set1_ps(w.start.x), sy = _mm256_set1_ps(w.start.y), sz = _mm256_set1_ps(w.start.z);
+    const __m256 abx = _mm256_set1_ps(ab.x), aby = _mm256_set1_ps(ab.y), abz = _mm256_set1_ps(ab.z);
+    const __m256 abLengthSq = _mm256_set1_ps(math::dot(ab, ab));
+    const __m256 nx = _mm256_set1_ps(normal.x), ny = _mm256_set1_ps(normal.y), nz = _mm256_set1_ps(normal.z);
+    const __m256 normalLength = _mm256_set1_ps(math::mag(normal));
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.f);
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+    const __m256 e = _mm256_set1_ps(restitution);
+    for (u32 i = 0; i < count; i += 8) {
+        const __m256 px = _mm256_loadu_ps(soa.posx + i), py = _mm256_loadu_ps(soa.posy + i);
+        const __m256 pz = _mm256_loadu_ps(soa.posz + i);
+        const __m256 r = _mm256_loadu_ps(soa.radius + i);
+        // closestPointOnWall, min and max pick the same operand as the scalar ones
+        __m256 t = _mm256_div_ps(
+            _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(px, sx), abx), _mm256_mul_ps(_mm256_sub_ps(py, sy), aby)),
+                _mm256_mul_ps(_mm256_sub_ps(pz, sz), abz)),
+            abLengthSq);
+        t = _mm256_max_ps(_mm256_min_ps(t, one), zero);
+        __m256 dx = _mm256_sub_ps(px, _mm256_add_ps(sx, _mm256_mul_ps(abx, t)));
+        __m256 dy = _mm256_sub_ps(py, _mm256_add_ps(sy, _mm256_mul_ps(aby, t)));
+        __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        const __m256 onWall = _mm256_cmp_ps(dist, zero, _CMP_EQ_OQ);
+        dx = _mm256_blendv_ps(dx, nx, onWall);
+        dy = _mm256_blendv_ps(dy, ny, onWall);
+        __m256 dz = _mm256_and_ps(nz, onWall);
+        dist = _mm256_blendv_ps(dist, normalLength, onWall);
+        dx = _mm256_div_ps(dx, dist);
+        dy = _mm256_div_ps(dy, dist);
+        dz = _mm256_div_ps(dz, dist);
+        const __m256 side =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, nx), _mm256_mul_ps(dy, ny)), _mm256_mul_ps(dz, nz));
+        const __m256 outside = _mm256_cmp_ps(side, zero, _CMP_GE_OQ);
+        // balls in front of the wall only touch it within their radius
+        const __m256 active = _mm256_or_ps(
+            _mm256_cmp_ps(side, zero, _CMP_NGE_UQ), _mm256_cmp_ps(dist, r, _CMP_NGT_UQ));
+        if (_mm256_movemask_ps(active) == 0) { continue; }
+
+        const __m256 push = _mm256_blendv_ps(
+            _mm256_xor_ps(_mm256_add_ps(r, dist), signMask), _mm256_sub_ps(r, dist), outside);
+        const __m256 vx = _mm256_loadu_ps(soa.velx + i), vy = _mm256_loadu_ps(soa.vely + i);
+        const __m256 vz = _mm256_loadu_ps(soa.velz + i);
+        const __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, dx), _mm256_mul_ps(vy, dy)), _mm256_mul_ps(vz, dz));
+        const __m256 dv = _mm256_sub_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, v), e), v);
+        _mm256_storeu_ps(soa.posx + i, _mm256_blendv_ps(px, _mm256_add_ps(px, _mm256_mul_ps(dx, push)), active));
+        _mm256_storeu_ps(soa.posy + i, _mm256_blendv_ps(py, _mm256_add_ps(py, _mm256_mul_ps(dy, push)), active));
+        _mm256_storeu_ps(soa.posz + i, _mm256_blendv_ps(pz, _mm256_add_ps(pz, _mm256_mul_ps(dz, push)), active));
+        _mm256_storeu_ps(soa.velx + i, _mm256_blendv_ps(vx, _mm256_add_ps(vx, _mm256_mul_ps(dx, dv)), active));
+        _mm256_storeu_ps(soa.vely + i, _mm256_blendv_ps(vy, _mm256_add_ps(vy, _mm256_mul_ps(dy, dv)), active));
+        _mm256_storeu_ps(soa.velz + i, _mm256_blendv_ps(vz, _mm256_add_ps(vz, _mm256_mul_ps(dz, dv)), active));
+    }
+}
+// Pairs are batched in order, and a pair that shares a ball with the current batch flushes it
+// first. Pairs in a batch are independent and pairs sharing a ball keep their order, so the
+// result is the same as resolving them one by one
+void resolveBallPairs_256(BallsSoA& soa, const Pair* pairs, const u32 pairCount, const f32 restitution) {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i batchA = _mm256_setzero_si256(), batchB = _mm256_setzero_si256();
+    u32 n = 0;
+    for (u32 p = 0; p < pairCount; p++) {
+        const __m256i a = _mm256_set1_epi32((s32)pairs[p].a), b = _mm256_set1_epi32((s32)pairs[p].b);
+        if (n > 0) {
+            const __m256i shared = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi32(batchA, a), _mm256_cmpeq_epi32(batchB, a)),
+                _mm256_or_si256(_mm256_cmpeq_epi32(batchA, b), _mm256_cmpeq_epi32(batchB, b)));
+            if (!_mm256_testz_si256(shared, shared)) {
+                resolveBallPairBatch_256(soa, batchA, batchB, n, restitution);
+                n = 0;
+            }
+        }
+        if (n == 0) { // unused lanes repeat the first pair, so they add no conflicts
+            batchA = a;
+            batchB = b;
+        } else {
+            const __m256i lane = _mm256_cmpeq_epi32(lanes, _mm256_set1_epi32((s32)n));
+            batchA = _mm256_blendv_epi8(batchA, a, lane);
+            batchB = _mm256_blendv_epi8(batchB, b, lane);
+        }
+        if (++n == 8) {
+            resolveBallPairBatch_256(soa, batchA, batchB, n, restitution);
+            n = 0;
+        }
+    }
+    if (n > 0) { resolveBallPairBatch_256(soa, batchA, batchB, n, restitution); }
+}
+
+// The game time is accumulated and simulated in fixed substeps, up to scene.maxSubsteps per
+// update: after a long frame the rest is dropped, rather than making the next frame longer too.
+// Every substep integrates all balls, finds the candidate pairs with the scene's broadphase
+// (its data only lives for the substep), resolves them in order and then every ball against
+// every wall. With scene.simd, it runs
+// on the SoA storage of the balls instead
+void updatePhysics(Scene& scene, f32 game_dt, allocator::PagedArena frameArena)
+{
+    BallsSoA& soa = scene.soa;
+    if (scene.simd && scene.soaCount != scene.ball_count) {
+        ballsToSoA(soa, scene.balls, scene.ball_count);
+        scene.soaCount = scene.ball_count;
+    } else if (!scene.simd && scene.soaCount > 0) {
+        ballsFromSoA(scene.balls, soa, scene.soaCount);
+        scene.soaCount = 0;
+    }
+    const BallView balls = scene.simd ? viewFromBalls(soa, scene.ball_count) : viewFromBalls(scene);
+    const f32 dt = scene.substepLength;
+    scene.dt = math::min(scene.dt + game_dt, scene.maxSubsteps * dt);
+    const u32 steps = math::min((u32)(scene.dt / dt), scene.maxSubsteps);
+    scene.dt = math::max(scene.dt - steps * dt, 0.f);
+    scene.substepCount = steps;
+    for (u32 s = 0; s < steps; s++) {
+		if (s == steps - 1) {
+			for (u32 i = 0; i < scene.ball_count; i++) { scene.prevPos[i] = get_ball_pos(scene, i); }
+			scene.prevCount = scene.ball_count;
+		}
+
+		allocator::PagedArena arena = frameArena; // explicit copy, scoped to the substep
+		Pairs pairs;
+		if (scene.simd) {
+			const f32 maxRadius = integrateBalls_256(soa, scene.ball_count, scene.gravity, dt);
+			findPairs(pairs, scene, balls, scene.broadphase, maxRadius, arena);
+			resolveBallPairs_256(soa, pairs.balls.data, (u32)pairs.balls.len, scene.restitution);
+			resolveObstaclePairs_256(
+				soa, pairs.obstacles.data, (u32)pairs.obstacles.len, scene.obstacles, scene.restitution);
 			for (u32 j = 0; j < scene.wall_count; j++) {
-				physics::StaticObject_Line& w = scene.walls[j];
-
-				// distance to wall
-				float3 ab = math::subtract(w.end, w.start);
-				f32 t = math::max(0.f, 
-					math::min(1.f,
-						(math::dot(math::subtract(b1.pos, w.start), ab)) / math::dot(ab, ab)));
-				float3 col = math::add(w.start, math::scale(ab, t));
-				float3 d = math::subtract(b1.pos, col);
-				d.z = 0.f;
-				f32 dist = math::mag(d);
-				float3 normal(-ab.y, ab.x, ab.z);
-
-				// push out
-				if (dist == 0.f) {
-					d = normal;
-					dist = math::mag(normal);
-				}
-				d = math::invScale(d, dist);
-				if (math::dot(d, normal) >= 0.f) { // outside the wall
-					if (dist > b1.radius) continue;
-					b1.pos = math::add(b1.pos, math::scale(d, b1.radius - dist));
-				} else { // inside the wall
-					b1.pos = math::add(b1.pos, math::scale(d, -(b1.radius + dist)));
-				}
-
-				// update velocity
-				f32 v = math::dot(b1.vel, d);
-				f32 vnew = math::abs(v) * scene.restitution;
-				b1.vel = math::add(b1.vel, math::scale(d, vnew - v));
+				resolveWall_256(soa, scene.ball_count, scene.walls[j], scene.restitution);
 			}
+			resolveBounds_256(soa, scene.ball_count, scene.bounds);
+			continue;
+		}
 
-			if ((b1.pos.x + b1.radius) > scene.bounds.x) {
-				b1.pos.x = scene.bounds.x - b1.radius;
-				b1.vel.x = -b1.vel.x;
-			}
-			if ((b1.pos.x - b1.radius) < -scene.bounds.x) {
-				b1.pos.x = -scene.bounds.x + b1.radius;
-				b1.vel.x = -b1.vel.x;
-			}
-			if ((b1.pos.y + b1.radius) > scene.bounds.y) {
-				b1.pos.y = scene.bounds.y - b1.radius;
-				b1.vel.y = -b1.vel.y;
-			}
-			if ((b1.pos.y - b1.radius) < -scene.bounds.y) {
-				b1.pos.y = -scene.bounds.y + b1.radius;
-				b1.vel.y = -b1.vel.y;
-			}
+		const f32 maxRadius = integrateBalls(scene.balls, scene.ball_count, scene.gravity, dt);
+		findPairs(pairs, scene, balls, scene.broadphase, maxRadius, arena);
+		for (ptrdiff_t p = 0; p < pairs.balls.len; p++) {
+			resolveCollision(scene, scene.balls[pairs.balls.data[p].a], scene.balls[pairs.balls.data[p].b]);
+		}
+		for (ptrdiff_t p = 0; p < pairs.obstacles.len; p++) {
+			resolveCollision(
+				scene, scene.balls[pairs.obstacles.data[p].a], scene.obstacles[pairs.obstacles.data[p].b]);
+		}
+		for (u32 j = 0; j < scene.wall_count; j++) {
+			for (u32 i = 0; i < scene.ball_count; i++) { resolveCollision(scene, scene.balls[i], scene.walls[j]); }
+		}
+		for (u32 i = 0; i < scene.ball_count; i++) {
+			resolveBounds(scene, scene.balls[i]);
 		}
     }
 }
+
+#if __DEBUG
+// Fills a square room with balls at the same density for every count
+void initBenchmarkScene(Scene& scene, const u32 count, allocator::PagedArena& arena) {
+    const f32 halfSize = 4.f * math::sqrt((f32)count);
+    scene = {};
+    init_scene(scene, 4, 1, count, arena);
+    scene.bounds = float2(halfSize, halfSize);
+    scene.restitution = 1.f;
+    for (u32 i = 0; i < count; i++) {
+        DynamicObject_Sphere& ball = add_ball(scene);
+        ball.radius = 0.5f + math::rand();
+        ball.mass = math::pi32 * ball.radius * ball.radius;
+        ball.pos = float3(
+            halfSize * (-1.f + 2.f * math::rand()), halfSize * (-1.f + 2.f * math::rand()), 0.f);
+        ball.vel = float3(20.f * (-1.f + 2.f * math::rand()), 20.f * (-1.f + 2.f * math::rand()), 0.f);
+    }
+    StaticObject_Sphere& o = add_obstacle(scene);
+    o = {};
+    o.radius = halfSize * 0.2f;
+    const float2 corners[] = {
+        float2(-halfSize, 0.f), float2(0.f, -halfSize), float2(halfSize, 0.f), float2(0.f, halfSize) };
+    for (u32 i = 0; i < countof(corners); i++) {
+        StaticObject_Line& w = add_wall(scene);
+        w.start = float3(corners[i], 0.f);
+        w.end = float3(corners[(i + 1) % countof(corners)], 0.f);
+    }
+}
+// Times each broadphase on its own (from the same positions), and a few full substeps with it.
+// Obstacle pairs are only candidates (brute force pairs every ball with every obstacle), so
+// the broadphases are compared by the contacts among them
+void benchmarkBroadphase(allocator::PagedArena scratchArena) {
+    const u32 ballCounts[] = { 100, 1000, 10000 };
+    const u32 stepCount = 10;
+    for (u32 c = 0; c < countof(ballCounts); c++) {
+        allocator::PagedArena arena = scratchArena; // explicit copy
+        const u32 count = ballCounts[c];
+        Scene source;
+        initBenchmarkScene(source, count, arena);
+        DynamicObject_Sphere* initialBalls = ALLOC_ARRAY(arena, DynamicObject_Sphere, count);
+        memcpy(initialBalls, source.balls, count * sizeof(DynamicObject_Sphere));
+
+        u64 ballPairs[BroadphaseType::Count] = {};
+        u64 obstacleContacts[BroadphaseType::Count] = {};
+        for (u32 t = 0; t < BroadphaseType::Count; t++) {
+            const BroadphaseType::Enum type = (BroadphaseType::Enum)t;
+            if (type == BroadphaseType::BruteForce && count > 1000) {
+                io::debuglog("broadphase %5d balls: %s skipped\n", count, broadphaseNames[t]);
+                continue;
+            }
+            Scene scene = source;
+            scene.broadphase = type;
+            memcpy(scene.balls, initialBalls, count * sizeof(DynamicObject_Sphere));
+            scene.sweepCount = 0;
+            // the first sweep sorts from scratch, prime it so only the incremental sort is timed
+            {
+                allocator::PagedArena pairsArena = arena; // explicit copy
+                Pairs pairs;
+                findPairs(pairs, scene, viewFromBalls(scene), type, 1.5f, pairsArena);
+            }
+            allocator::PagedArena pairsArena = arena; // explicit copy
+            Pairs pairs;
+            u64 start = __rdtsc();
+            findPairs(pairs, scene, viewFromBalls(scene), type, 1.5f, pairsArena);
+            const u64 cyclesBroadphase = __rdtsc() - start;
+            ballPairs[t] = pairs.balls.len;
+            for (ptrdiff_t p = 0; p < pairs.obstacles.len; p++) {
+                const DynamicObject_Sphere& b = scene.balls[pairs.obstacles.data[p].a];
+                const StaticObject_Sphere& o = scene.obstacles[pairs.obstacles.data[p].b];
+                const float3 d = math::subtract(b.pos, o.pos);
+                if (math::mag(float2(d.x, d.y)) <= b.radius + o.radius) { obstacleContacts[t]++; }
+            }
+            start = __rdtsc();
+            for (u32 s = 0; s < stepCount; s++) { updatePhysics(scene, 1 / 60.f, arena); }
+            const u64 cyclesStep = (__rdtsc() - start) / stepCount;
+            io::debuglog(
+                "broadphase %5d balls: %s %.3f Mcycles (%d ball pairs, %d obstacle pairs, %d obstacle contacts), "
+                "substep %.3f Mcycles\n",
+                count, broadphaseNames[t], cyclesBroadphase / 1000000.f, (s32)pairs.balls.len,
+                (s32)pairs.obstacles.len, (s32)obstacleContacts[t], cyclesStep / 1000000.f);
+        }
+        assert(count > 1000 || ballPairs[BroadphaseType::BruteForce] == ballPairs[BroadphaseType::SpatialHash]);
+        assert(ballPairs[BroadphaseType::SpatialHash] == ballPairs[BroadphaseType::SortAndSweep]);
+        assert(count > 1000 || obstacleContacts[BroadphaseType::BruteForce] == obstacleContacts[BroadphaseType::SpatialHash]);
+        assert(obstacleContacts[BroadphaseType::SpatialHash] == obstacleContacts[BroadphaseType::SortAndSweep]);
+    }
+}
+// Times the scalar functions against the SoA kernels on the same balls, then runs the same
+// substeps with both paths and reports how far apart the balls end up. Collisions are chaotic,
+// so any difference in rounding (e.g. fma contraction of the scalar code) grows over time: only
+// a single pass of each stage and the first substep are asserted to match
+void benchmarkSolver(allocator::PagedArena scratchArena) {
+    const u32 ballCounts[] = { 100, 1000, 10000 };
+    const u32 stepCount = 60;
+    const f32 dt = 1 / 60.f;
+    const f32 tolerance = 0.001f;
+    auto maxDistance = [](const Scene& a, const Scene& b) {
+        f32 d = 0.f;
+        for (u32 i = 0; i < a.ball_count; i++) {
+            d = math::max(d, math::mag(math::subtract(get_ball_pos(a, i), get_ball_pos(b, i))));
+        }
+        return d;
+    };
+    for (u32 c = 0; c < countof(ballCounts); c++) {
+        allocator::PagedArena arena = scratchArena; // explicit copy
+        const u32 count = ballCounts[c];
+        Scene scalar, simd;
+        initBenchmarkScene(scalar, count, arena);
+        simd = scalar;
+        simd.balls = ALLOC_ARRAY(arena, DynamicObject_Sphere, count);
+        DynamicObject_Sphere* initialBalls = ALLOC_ARRAY(arena, DynamicObject_Sphere, count);
+        memcpy(simd.balls, scalar.balls, count * sizeof(DynamicObject_Sphere));
+        memcpy(initialBalls, scalar.balls, count * sizeof(DynamicObject_Sphere));
+        scalar.simd = false;
+        simd.simd = true;
+
+        // each stage on its own
+        {
+            BallsSoA& soa = simd.soa;
+            ballsToSoA(soa, simd.balls, count);
+            u64 start = __rdtsc();
+            const f32 maxRadius = integrateBalls(scalar.balls, count, scalar.gravity, dt);
+            const u64 integrateScalar = __rdtsc() - start;
+            start = __rdtsc();
+            integrateBalls_256(soa, count, simd.gravity, dt);
+            const u64 integrateSimd = __rdtsc() - start;
+
+            allocator::PagedArena pairsArena = arena; // explicit copy
+            Pairs pairs;
+            findPairs(pairs, scalar, viewFromBalls(scalar), BroadphaseType::SpatialHash, maxRadius, pairsArena);
+            start = __rdtsc();
+            for (ptrdiff_t p = 0; p < pairs.balls.len; p++) {
+                resolveCollision(scalar, scalar.balls[pairs.balls.data[p].a], scalar.balls[pairs.balls.data[p].b]);
+            }
+            const u64 pairsScalar = __rdtsc() - start;
+            start = __rdtsc();
+            resolveBallPairs_256(soa, pairs.balls.data, (u32)pairs.balls.len, simd.restitution);
+            const u64 pairsSimd = __rdtsc() - start;
+
+            start = __rdtsc();
+            for (ptrdiff_t p = 0; p < pairs.obstacles.len; p++) {
+                resolveCollision(
+                    scalar, scalar.balls[pairs.obstacles.data[p].a], scalar.obstacles[pairs.obstacles.data[p].b]);
+            }
+            for (u32 j = 0; j < scalar.wall_count; j++) {
+                for (u32 i = 0; i < count; i++) { resolveCollision(scalar, scalar.balls[i], scalar.walls[j]); }
+            }
+            const u64 staticScalar = __rdtsc() - start;
+            start = __rdtsc();
+            resolveObstaclePairs_256(
+                soa, pairs.obstacles.data, (u32)pairs.obstacles.len, simd.obstacles, simd.restitution);
+            for (u32 j = 0; j < simd.wall_count; j++) { resolveWall_256(soa, count, simd.walls[j], simd.restitution); }
+            const u64 staticSimd = __rdtsc() - start;
+
+            start = __rdtsc();
+            for (u32 i = 0; i < count; i++) { resolveBounds(scalar, scalar.balls[i]); }
+            const u64 boundsScalar = __rdtsc() - start;
+            start = __rdtsc();
+            resolveBounds_256(soa, count, simd.bounds);
+            const u64 boundsSimd = __rdtsc() - start;
+            ballsFromSoA(simd.balls, soa, count);
+            const f32 stageDistance = maxDistance(scalar, simd);
+
+            io::debuglog(
+                "solver %5d balls: integrate %.3f/%.3f Mcycles (%.2fx), "
+                "%d ball pairs %.3f/%.3f Mcycles (%.2fx), %d obstacle pairs and %d walls %.3f/%.3f Mcycles (%.2fx), "
+                "bounds %.3f/%.3f Mcycles (%.2fx), max position difference %.6f\n",
+                count, integrateScalar / 1000000.f, integrateSimd / 1000000.f,
+                integrateScalar / (f32)math::max(integrateSimd, 1ull), (s32)pairs.balls.len,
+                pairsScalar / 1000000.f, pairsSimd / 1000000.f, pairsScalar / (f32)math::max(pairsSimd, 1ull),
+                (s32)pairs.obstacles.len, (s32)scalar.wall_count,
+                staticScalar / 1000000.f, staticSimd / 1000000.f, staticScalar / (f32)math::max(staticSimd, 1ull),
+                boundsScalar / 1000000.f, boundsSimd / 1000000.f, boundsScalar / (f32)math::max(boundsSimd, 1ull),
+                stageDistance);
+            assert(stageDistance <= tolerance);
+        }
+
+        // full substeps
+        memcpy(scalar.balls, initialBalls, count * sizeof(DynamicObject_Sphere));
+        memcpy(simd.balls, initialBalls, count * sizeof(DynamicObject_Sphere));
+        updatePhysics(scalar, dt, arena);
+        updatePhysics(simd, dt, arena);
+        const f32 firstStepDistance = maxDistance(scalar, simd);
+        assert(firstStepDistance <= tolerance);
+        u64 start = __rdtsc();
+        for (u32 s = 1; s < stepCount; s++) { updatePhysics(scalar, dt, arena); }
+        const u64 cyclesScalar = (__rdtsc() - start) / (stepCount - 1);
+        start = __rdtsc();
+        for (u32 s = 1; s < stepCount; s++) { updatePhysics(simd, dt, arena); }
+        const u64 cyclesSimd = (__rdtsc() - start) / (stepCount - 1);
+        io::debuglog(
+            "solver %5d balls: substep %.3f/%.3f Mcycles (%.2fx), "
+            "max position difference %.6f after 1 substep, %.6f after %d\n",
+            count, cyclesScalar / 1000000.f, cyclesSimd / 1000000.f,
+            cyclesScalar / (f32)math::max(cyclesSimd, 1ull), firstStepDistance,
+            maxDistance(scalar, simd), stepCount);
+    }
+}
+#endif
 }
 
 #endif // __WASTELADNS_PHYSICS_H__
@@ -117,7 +117,7 @@ struct DrawMesh { // id of a piece of geometry loaded on the gpu
 };
 struct CPUMesh {
     float3* vertices;
-    u16* indices;
+    bvh::Index* indices; // the bvh's index width, so trees build from them without a copy
     u32 vertexCount;
     u32 indexCount;
 };
@@ -140,6 +140,7 @@ struct DrawNodeInstanced {
 };
 
 void draw_drawlist(Drawlist& dl, Drawlist_Context& ctx, const Drawlist_Overrides& overrides) {
+    __PROFILEONLY(profiler::start_zone("submit");)
 	u32 count = dl.count[DrawlistBuckets::Base] + dl.count[DrawlistBuckets::Instanced];
     for (u32 i = 0; i < count; i++) {
         DrawCall_Item& item = dl.items[dl.keys[i].idx];
@@ -172,6 +173,7 @@ void draw_drawlist(Drawlist& dl, Drawlist_Context& ctx, const Drawlist_Overrides
         }
         gfx::rhi::end_event();
     }
+    __PROFILEONLY(profiler::end_zone();)
 }
 
 struct ReloadableShader {
@@ -186,10 +188,55 @@ struct ReloadableShader {
     #endif
 };
 
+struct Frustum {
+    enum { MAX_PLANE_COUNT = 10 };
+    float4 planes[MAX_PLANE_COUNT];
+    u32 numPlanes;
+};
+struct CullEntry {
+    float3 boxPointsWS[8]; // todo: surely we can do better?
+    u32 poolId;
+};
+// Same corners as CullEntry, transposed so that each lane holds a different draw node:
+// a block covers 8 consecutive pool indices, indexed by [corner][lane]
+struct CullEntryBlock {
+    f32 x[8][8];
+    f32 y[8][8];
+    f32 z[8][8];
+};
+// Dynamic AABB tree over the draw nodes, so that visibility queries only visit the branches
+// that touch the frustum. Leaves store a fattened world space box, so that small movements
+// don't require a reinsertion, and the tree is kept balanced through rotations
+struct CullTree {
+    enum { Invalid = 0xffffffff, MaxStackSize = 64 };
+    struct Node {
+        float3 min;
+        float3 max;
+        u32 parent; // next free node when unused
+        u32 children[2];
+        u32 poolId; // leaves only
+        s32 height; // 0 for leaves, -1 for unused nodes
+    };
+    Node* nodes;
+    CullEntryBlock* entryBlocks; // indexed by draw node pool index / 8
+    u32* leafIds; // indexed by draw node pool index
+    u32 cap;
+    u32 root;
+    u32 firstFree;
+};
+const f32 cullTreeMargin = 0.5f;
+
+struct CBufferRequest {
+    u32 handle;
+    u32 byteWidth;
+};
 struct Scene {
     allocator::Pool<DrawNode> drawNodes;
-    allocator::Pool<DrawNodeInstanced> instancedDrawNodes;
+    allocator::PackedPool<DrawNodeInstanced> instancedDrawNodes;
     allocator::Pool<gfx::rhi::RscCBuffer> cbuffers;
+    CBufferRequest* pendingCBuffers; // see request_cbuffer, one slot per cbuffer in the pool
+    u32 pendingCBufferCount;
+    CullTree cullTree;
 };
 struct CoreResources {
     ReloadableShader shaders[ShaderTechniques::Count];
@@ -227,10 +274,10 @@ force_inline DrawNode& node_from_handle(Scene& scene, const DrawNodeHandle handl
     return allocator::get_pool_slot(scene.drawNodes, handle - 1);
 }
 force_inline DrawNodeHandle handle_from_instanced_node(Scene& scene, DrawNodeInstanced& node) {
-    return allocator::get_pool_index(scene.instancedDrawNodes, node) + 1;
+    return allocator::get_packed_pool_handle(scene.instancedDrawNodes, node);
 }
 force_inline void instanced_node_from_handle(Matrices64*& matrices, u32*& count, Scene& scene, const u32 handle) {
-    DrawNodeInstanced& node = allocator::get_pool_slot(scene.instancedDrawNodes, handle - 1);
+    DrawNodeInstanced& node = allocator::get_packed_pool_slot(scene.instancedDrawNodes, handle);
     matrices = &node.instanceMatrices;
 	count = &node.instanceCount;
 }
@@ -249,88 +296,506 @@ force_inline gfx::rhi::RscCBuffer& cbuffer_from_handle(Scene& scene, const u32 h
 force_inline u32 handle_from_cbuffer(Scene& scene, gfx::rhi::RscCBuffer& cbuffer) {
     return allocator::get_pool_index(scene.cbuffers, cbuffer) + 1;
 }
+// Allocates a cbuffer from the pool, but leaves its creation to create_pending_cbuffers, so that
+// scenes can be built away from the render thread
+u32 request_cbuffer(Scene& scene, const u32 byteWidth) {
+    gfx::rhi::RscCBuffer& cbuffer = allocator::alloc_pool(scene.cbuffers);
+    cbuffer = {};
+    const u32 handle = handle_from_cbuffer(scene, cbuffer);
+    scene.pendingCBuffers[scene.pendingCBufferCount++] = { handle, byteWidth };
+    return handle;
+}
+void create_pending_cbuffers(Scene& scene) {
+    for (u32 i = 0; i < scene.pendingCBufferCount; i++) {
+        const CBufferRequest& request = scene.pendingCBuffers[i];
+        gfx::rhi::create_cbuffer(cbuffer_from_handle(scene, request.handle), { request.byteWidth });
+    }
+    scene.pendingCBufferCount = 0;
+}
+// Destroys every cbuffer still allocated from the scene's pool, when the scene is discarded
+void release_cbuffers(Scene& scene) {
+    for (u32 i = 0; i < (u32)scene.cbuffers.cap; i++) {
+        if (!scene.cbuffers.data[i].alive) { continue; }
+        gfx::rhi::RscCBuffer& cbuffer = allocator::get_pool_slot(scene.cbuffers, i);
+        gfx::rhi::destroy_cbuffer(cbuffer);
+        allocator::free_pool(scene.cbuffers, cbuffer);
+    }
+}
 
-struct Frustum {
-    enum { MAX_PLANE_COUNT = 10 };
-    float4 planes[MAX_PLANE_COUNT];
-    u32 numPlanes;
-};
-struct CullEntry {
-    float3 boxPointsWS[8]; // todo: surely we can do better?
-    u32 poolId;
-};
-struct CullEntries {
-    CullEntry* entries;
-    u32 count;
-};
-void allocCullEntries(allocator::PagedArena scratchArena, CullEntries& cullEntries, const Scene& scene) {
-    
-    cullEntries.entries = ALLOC_ARRAY(scratchArena, CullEntry, scene.drawNodes.count);
-
-    for (u32 n = 0, count = 0; n < scene.drawNodes.cap && count < scene.drawNodes.count; n++) {
-        if (scene.drawNodes.data[n].alive == 0) { continue; }
-        count++;
-
-        CullEntry& entry = cullEntries.entries[cullEntries.count++];
-        const DrawNode& node = scene.drawNodes.data[n].state.live;
-        const float4 boxPointsLS[8] = {
-            { node.min.x, node.min.y, node.min.z, 1.f },
-            { node.max.x, node.min.y, node.min.z, 1.f },
-            { node.min.x, node.max.y, node.min.z, 1.f },
-            { node.max.x, node.max.y, node.min.z, 1.f },
-            { node.min.x, node.min.y, node.max.z, 1.f },
-            { node.max.x, node.min.y, node.max.z, 1.f },
-            { node.min.x, node.max.y, node.max.z, 1.f },
-            { node.max.x, node.max.y, node.max.z, 1.f }
-        };
-        entry.boxPointsWS[0] = math::mult(node.nodeData.worldMatrix, boxPointsLS[0]).xyz;
-        entry.boxPointsWS[1] = math::mult(node.nodeData.worldMatrix, boxPointsLS[1]).xyz;
-        entry.boxPointsWS[2] = math::mult(node.nodeData.worldMatrix, boxPointsLS[2]).xyz;
-        entry.boxPointsWS[3] = math::mult(node.nodeData.worldMatrix, boxPointsLS[3]).xyz;
-        entry.boxPointsWS[4] = math::mult(node.nodeData.worldMatrix, boxPointsLS[4]).xyz;
-        entry.boxPointsWS[5] = math::mult(node.nodeData.worldMatrix, boxPointsLS[5]).xyz;
-        entry.boxPointsWS[6] = math::mult(node.nodeData.worldMatrix, boxPointsLS[6]).xyz;
-        entry.boxPointsWS[7] = math::mult(node.nodeData.worldMatrix, boxPointsLS[7]).xyz;
-        entry.poolId = n;
+void initCullTree(CullTree& tree, const u32 maxLeaves, allocator::PagedArena& arena) {
+    tree.cap = 2 * maxLeaves - 1;
+    tree.nodes = ALLOC_ARRAY(arena, CullTree::Node, tree.cap);
+    tree.entryBlocks = ALLOC_ARRAY(arena, CullEntryBlock, (maxLeaves + 7) / 8);
+    tree.leafIds = ALLOC_ARRAY(arena, u32, maxLeaves);
+    for (u32 i = 0; i < tree.cap; i++) {
+        tree.nodes[i].parent = i + 1;
+        tree.nodes[i].height = -1;
+    }
+    tree.nodes[tree.cap - 1].parent = CullTree::Invalid;
+    for (u32 i = 0; i < maxLeaves; i++) { tree.leafIds[i] = CullTree::Invalid; }
+    tree.root = CullTree::Invalid;
+    tree.firstFree = 0;
+}
+force_inline f32 halfSurfaceArea(const float3& min, const float3& max) {
+    const float3 d = math::subtract(max, min);
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+force_inline void mergeCullTreeBounds(CullTree::Node& node, const CullTree::Node& a, const CullTree::Node& b) {
+    node.min = math::min(a.min, b.min);
+    node.max = math::max(a.max, b.max);
+    node.height = 1 + math::max(a.height, b.height);
+}
+u32 allocCullTreeNode(CullTree& tree) {
+    assert(tree.firstFree != CullTree::Invalid); // more leaves than the tree was initialized with
+    const u32 nodeId = tree.firstFree;
+    CullTree::Node& node = tree.nodes[nodeId];
+    tree.firstFree = node.parent;
+    node.parent = node.children[0] = node.children[1] = CullTree::Invalid;
+    node.poolId = CullTree::Invalid;
+    node.height = 0;
+    return nodeId;
+}
+void freeCullTreeNode(CullTree& tree, const u32 nodeId) {
+    CullTree::Node& node = tree.nodes[nodeId];
+    node.parent = tree.firstFree;
+    node.height = -1;
+    tree.firstFree = nodeId;
+}
+void replaceCullTreeChild(CullTree& tree, const u32 parentId, const u32 oldChildId, const u32 newChildId) {
+    if (parentId == CullTree::Invalid) { tree.root = newChildId; return; }
+    CullTree::Node& parent = tree.nodes[parentId];
+    if (parent.children[0] == oldChildId) { parent.children[0] = newChildId; }
+    else { parent.children[1] = newChildId; }
+}
+// If the subtree at nodeId is imbalanced, rotate its taller child up. Returns the subtree's new root
+u32 balanceCullTree(CullTree& tree, const u32 nodeId) {
+    CullTree::Node& a = tree.nodes[nodeId];
+    if (a.height < 2) { return nodeId; }
+    s32 balance = tree.nodes[a.children[1]].height - tree.nodes[a.children[0]].height;
+    if (balance > -2 && balance < 2) { return nodeId; }
+
+    // the taller child takes the place of a, and a keeps the shorter grandchild
+    const u32 tallSide = balance > 1 ? 1 : 0;
+    const u32 tallId = a.children[tallSide];
+    CullTree::Node& tall = tree.nodes[tallId];
+    const u32 fId = tall.children[0];
+    const u32 gId = tall.children[1];
+    const bool fTaller = tree.nodes[fId].height > tree.nodes[gId].height;
+    const u32 keepId = fTaller ? fId : gId;
+    const u32 moveId = fTaller ? gId : fId;
+
+    tall.children[0] = nodeId;
+    tall.children[1] = keepId;
+    tall.parent = a.parent;
+    replaceCullTreeChild(tree, tall.parent, nodeId, tallId);
+    a.parent = tallId;
+    a.children[tallSide] = moveId;
+    tree.nodes[moveId].parent = nodeId;
+    mergeCullTreeBounds(a, tree.nodes[a.children[0]], tree.nodes[a.children[1]]);
+    mergeCullTreeBounds(tall, a, tree.nodes[keepId]);
+    return tallId;
+}
+void refitCullTreeAncestors(CullTree& tree, u32 nodeId) {
+    while (nodeId != CullTree::Invalid) {
+        nodeId = balanceCullTree(tree, nodeId);
+        CullTree::Node& node = tree.nodes[nodeId];
+        mergeCullTreeBounds(node, tree.nodes[node.children[0]], tree.nodes[node.children[1]]);
+        nodeId = node.parent;
+    }
+}
+void insertCullTreeLeaf(CullTree& tree, const u32 leafId) {
+    if (tree.root == CullTree::Invalid) {
+        tree.root = leafId;
+        tree.nodes[leafId].parent = CullTree::Invalid;
+        return;
+    }
+    // descend towards the sibling that minimizes the added surface area (branch and bound as in
+    // Box2D's b2DynamicTree: stop when creating a parent here is cheaper than going further down)
+    const CullTree::Node& leaf = tree.nodes[leafId];
+    u32 siblingId = tree.root;
+    while (tree.nodes[siblingId].height > 0) {
+        const CullTree::Node& node = tree.nodes[siblingId];
+        const f32 area = halfSurfaceArea(node.min, node.max);
+        const f32 combinedArea =
+            halfSurfaceArea(math::min(node.min, leaf.min), math::max(node.max, leaf.max));
+        const f32 cost = 2.f * combinedArea;
+        const f32 inheritedCost = 2.f * (combinedArea - area);
+        f32 childCost[2];
+        for (u32 c = 0; c < 2; c++) {
+            const CullTree::Node& child = tree.nodes[node.children[c]];
+            childCost[c] = inheritedCost +
+                halfSurfaceArea(math::min(child.min, leaf.min), math::max(child.max, leaf.max));
+            if (child.height > 0) { childCost[c] -= halfSurfaceArea(child.min, child.max); }
+        }
+        if (cost < childCost[0] && cost < childCost[1]) { break; }
+        siblingId = node.children[childCost[0] < childCost[1] ? 0 : 1];
+    }
+
+    const u32 oldParentId = tree.nodes[siblingId].parent;
+    const u32 newParentId = allocCullTreeNode(tree);
+    CullTree::Node& newParent = tree.nodes[newParentId];
+    newParent.parent = oldParentId;
+    newParent.children[0] = siblingId;
+    newParent.children[1] = leafId;
+    replaceCullTreeChild(tree, oldParentId, siblingId, newParentId);
+    tree.nodes[siblingId].parent = newParentId;
+    tree.nodes[leafId].parent = newParentId;
+    refitCullTreeAncestors(tree, newParentId);
+}
+void removeCullTreeLeaf(CullTree& tree, const u32 leafId) {
+    if (leafId == tree.root) { tree.root = CullTree::Invalid; return; }
+    const u32 parentId = tree.nodes[leafId].parent;
+    const CullTree::Node& parent = tree.nodes[parentId];
+    const u32 grandParentId = parent.parent;
+    const u32 siblingId = parent.children[parent.children[0] == leafId ? 1 : 0];
+    replaceCullTreeChild(tree, grandParentId, parentId, siblingId);
+    tree.nodes[siblingId].parent = grandParentId;
+    freeCullTreeNode(tree, parentId);
+    refitCullTreeAncestors(tree, grandParentId);
+}
+// Call whenever the node's worldMatrix or bounds change, inserts the node if it isn't in the tree
+void updateCullNode(Scene& scene, const DrawNodeHandle handle) {
+    CullTree& tree = scene.cullTree;
+    const u32 poolId = handle - 1;
+    const DrawNode& node = node_from_handle(scene, handle);
+
+    CullEntryBlock& block = tree.entryBlocks[poolId / 8];
+    const u32 lane = poolId % 8;
+    const float4 boxPointsLS[8] = {
+        { node.min.x, node.min.y, node.min.z, 1.f },
+        { node.max.x, node.min.y, node.min.z, 1.f },
+        { node.min.x, node.max.y, node.min.z, 1.f },
+        { node.max.x, node.max.y, node.min.z, 1.f },
+        { node.min.x, node.min.y, node.max.z, 1.f },
+        { node.max.x, node.min.y, node.max.z, 1.f },
+        { node.min.x, node.max.y, node.max.z, 1.f },
+        { node.max.x, node.max.y, node.max.z, 1.f }
+    };
+    float3 minWS = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float3 maxWS = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (u32 i = 0; i < 8; i++) {
+        const float3 pointWS = math::mult(node.nodeData.worldMatrix, boxPointsLS[i]).xyz;
+        block.x[i][lane] = pointWS.x;
+        block.y[i][lane] = pointWS.y;
+        block.z[i][lane] = pointWS.z;
+        minWS = math::min(minWS, pointWS);
+        maxWS = math::max(maxWS, pointWS);
+    }
+
+    u32 leafId = tree.leafIds[poolId];
+    if (leafId != CullTree::Invalid) {
+        const CullTree::Node& leaf = tree.nodes[leafId];
+        if (leaf.min.x <= minWS.x && leaf.min.y <= minWS.y && leaf.min.z <= minWS.z
+         && leaf.max.x >= maxWS.x && leaf.max.y >= maxWS.y && leaf.max.z >= maxWS.z) {
+            return; // still contained in the fattened box
+        }
+        removeCullTreeLeaf(tree, leafId);
+    } else {
+        leafId = allocCullTreeNode(tree);
+        tree.leafIds[poolId] = leafId;
+        tree.nodes[leafId].poolId = poolId;
+    }
+    CullTree::Node& leaf = tree.nodes[leafId];
+    const float3 margin(cullTreeMargin, cullTreeMargin, cullTreeMargin);
+    leaf.min = math::subtract(minWS, margin);
+    leaf.max = math::add(maxWS, margin);
+    insertCullTreeLeaf(tree, leafId);
+}
+void removeCullNode(Scene& scene, const DrawNodeHandle handle) {
+    CullTree& tree = scene.cullTree;
+    const u32 poolId = handle - 1;
+    const u32 leafId = tree.leafIds[poolId];
+    if (leafId == CullTree::Invalid) { return; }
+    removeCullTreeLeaf(tree, leafId);
+    freeCullTreeNode(tree, leafId);
+    tree.leafIds[poolId] = CullTree::Invalid;
+}
+// Visits the leaves of every subtree whose bounds aren't fully outside one of the frustum planes
+// visit(poolId, planeMask) gets the planes that the leaf's box still straddles
+template<typename _Visit>
+void traverseCullTree(const CullTree& tree, const Frustum& frustum, _Visit&& visit) {
+    if (tree.root == CullTree::Invalid) { return; }
+    u32 stackNodes[CullTree::MaxStackSize];
+    u32 stackMasks[CullTree::MaxStackSize];
+    u32 stackCount = 0;
+    stackNodes[stackCount] = tree.root;
+    stackMasks[stackCount++] = (1 << frustum.numPlanes) - 1;
+    while (stackCount) {
+        stackCount--;
+        const CullTree::Node& node = tree.nodes[stackNodes[stackCount]];
+        u32 planeMask = stackMasks[stackCount];
+        bool out = false;
+        for (u32 p = 0; p < frustum.numPlanes; p++) {
+            if (!(planeMask & (1 << p))) { continue; }
+            const float4& plane = frustum.planes[p];
+            // furthest and closest corners along the plane normal
+            const float4 pVertex(
+                plane.x >= 0.f ? node.max.x : node.min.x,
+                plane.y >= 0.f ? node.max.y : node.min.y,
+                plane.z >= 0.f ? node.max.z : node.min.z, 1.f);
+            const float4 nVertex(
+                plane.x >= 0.f ? node.min.x : node.max.x,
+                plane.y >= 0.f ? node.min.y : node.max.y,
+                plane.z >= 0.f ? node.min.z : node.max.z, 1.f);
+            if (math::dot(plane, pVertex) < 0.f) { out = true; break; }
+            if (math::dot(plane, nVertex) >= 0.f) { planeMask &= ~(1 << p); }
+        }
+        if (out) { continue; }
+        if (node.height == 0) { visit(node.poolId, planeMask); continue; }
+        assert(stackCount + 2 <= CullTree::MaxStackSize);
+        stackNodes[stackCount] = node.children[0];
+        stackMasks[stackCount++] = planeMask;
+        stackNodes[stackCount] = node.children[1];
+        stackMasks[stackCount++] = planeMask;
     }
 }
+// The scalar and 8-wide leaf tests must give the same visibility, so their plane distances are
+// computed in the same order, with separate multiplies and adds: fp contraction into fma is off
+// for both (math::dot can't be used, clang contracts it with -march=haswell, and gcc contracts
+// across statements by default)
+#if __clang__
+#define __CULL_NO_FP_CONTRACT_SCOPE _Pragma("clang fp contract(off)")
+#else
+#define __CULL_NO_FP_CONTRACT_SCOPE
+#endif
+#if __GNUC__ && !__clang__
+#define __CULL_NO_FP_CONTRACT_FUNC __attribute__((optimize("fp-contract=off")))
+#else
+#define __CULL_NO_FP_CONTRACT_FUNC
+#endif
+__CULL_NO_FP_CONTRACT_FUNC
+f32 cullPlaneDistance(const float4& plane, const float3& p) {
+    __CULL_NO_FP_CONTRACT_SCOPE
+    return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+}
+// A box is culled if all of its corners are behind any of the planes in planeMask
+bool isCullEntryVisible(const CullEntry& entry, const Frustum& frustum, const u32 planeMask) {
+    for (u32 p = 0; p < frustum.numPlanes; p++) {
+        if (!(planeMask & (1 << p))) { continue; }
+        int out = 0;
+        out += (cullPlaneDistance(frustum.planes[p], entry.boxPointsWS[0]) < 0.f) ? 1 : 0;
+        out += (cullPlaneDistance(frustum.planes[p], entry.boxPointsWS[1]) < 0.f) ? 1 : 0;
+        out += (cullPlaneDistance(frustum.planes[p], entry.boxPointsWS[2]) < 0.f) ? 1 : 0;
+        out += (cullPlaneDistance(frustum.planes[p], entry.boxPointsWS[3]) < 0.f) ? 1 : 0;
+        out += (cullPlaneDistance(frustum.planes[p], entry.boxPointsWS[4]) < 0.f) ? 1 : 0;
+        out += (cullPlaneDistance(frustum.planes[p], entry.boxPointsWS[5]) < 0.f) ? 1 : 0;
+        out += (cullPlaneDistance(frustum.planes[p], entry.boxPointsWS[6]) < 0.f) ? 1 : 0;
+        out += (cullPlaneDistance(frustum.planes[p], entry.boxPointsWS[7]) < 0.f) ? 1 : 0;
+        if (out == 8) { return false; }
+    }
+    // frustum inside quad??
+    return true;
+}
+// 8-wide version of isCullEntryVisible: gathers the corners of up to 8 draw nodes (one per lane)
+// and tests them against all planes at once. Returns the mask of visible lanes.
+// The plane distance is computed as in cullPlaneDistance, so results match the scalar test exactly
+__CULL_NO_FP_CONTRACT_FUNC
+u32 areCullEntriesVisible_256(
+    const CullEntryBlock* blocks, const u32* poolIds, const u32* planeMasks, const u32 count,
+    const Frustum& frustum) {
+    const u32 blockStride = sizeof(CullEntryBlock) / sizeof(f32);
+    s32 offsets[8];
+    s32 masks[8];
+    for (u32 i = 0; i < 8; i++) {
+        const u32 poolId = poolIds[i < count ? i : 0];
+        offsets[i] = (s32)((poolId / 8) * blockStride + poolId % 8);
+        masks[i] = i < count ? (s32)planeMasks[i] : 0;
+    }
+    const __m256i offsets_256 = _mm256_loadu_si256((const __m256i*)offsets);
+    const __m256i masks_256 = _mm256_loadu_si256((const __m256i*)masks);
+    const u32 visibleLanes = (1 << count) - 1;
+
+    // allOut[p] keeps, per lane, whether every corner so far is behind plane p. It starts with
+    // the lanes that have plane p in their mask, since only those can be culled by it
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 allOut[Frustum::MAX_PLANE_COUNT];
+    for (u32 p = 0; p < frustum.numPlanes; p++) {
+        allOut[p] = _mm256_castsi256_ps(_mm256_slli_epi32(masks_256, 31 - p));
+    }
+    for (u32 c = 0; c < 8; c++) {
+        const __m256 x = _mm256_i32gather_ps(&blocks->x[c][0], offsets_256, 4);
+        const __m256 y = _mm256_i32gather_ps(&blocks->y[c][0], offsets_256, 4);
+        const __m256 z = _mm256_i32gather_ps(&blocks->z[c][0], offsets_256, 4);
+        __m256 anyOut = zero;
+        for (u32 p = 0; p < frustum.numPlanes; p++) {
+            const float4& plane = frustum.planes[p];
+            __m256 dist =
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(plane.x), x),
+                    _mm256_mul_ps(_mm256_set1_ps(plane.y), y));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(plane.z), z));
+            dist = _mm256_add_ps(dist, _mm256_set1_ps(plane.w));
+            allOut[p] = _mm256_and_ps(allOut[p], _mm256_cmp_ps(dist, zero, _CMP_LT_OQ));
+            anyOut = _mm256_or_ps(anyOut, allOut[p]);
+        }
+        // no lane can be culled anymore
+        if (!(_mm256_movemask_ps(anyOut) & visibleLanes)) { return visibleLanes; }
+    }
+    __m256 culled = zero;
+    for (u32 p = 0; p < frustum.numPlanes; p++) { culled = _mm256_or_ps(culled, allOut[p]); }
+    return ~(u32)_mm256_movemask_ps(culled) & visibleLanes;
+}
 struct VisibleNodes {
     u32* visible_nodes;
     u32 visible_nodes_count;
 };
 void computeVisibilityWS(allocator::PagedArena& frameArena, VisibleNodes& visibilityFrustum,
                          u32* isEachNodeVisible, const Frustum& frustum,
-                         const CullEntries& cullEntries) {
+                         const CullTree& cullTree) {
 
     allocator::Buffer<u32> visibleNodes = {};
     visibilityFrustum.visible_nodes_count = 0;
-    for (u32 i = 0; i < cullEntries.count; i++) {
-        const CullEntry& entry = cullEntries.entries[i];
-        
-        // quad inside frustum
-        bool visible = true;
-        for (u32 p = 0; p < frustum.numPlanes; p++) {
-            int out = 0;
-            out += (math::dot(frustum.planes[p], float4(entry.boxPointsWS[0], 1.f)) < 0.f) ? 1 : 0;
-            out += (math::dot(frustum.planes[p], float4(entry.boxPointsWS[1], 1.f)) < 0.f) ? 1 : 0;
-            out += (math::dot(frustum.planes[p], float4(entry.boxPointsWS[2], 1.f)) < 0.f) ? 1 : 0;
-            out += (math::dot(frustum.planes[p], float4(entry.boxPointsWS[3], 1.f)) < 0.f) ? 1 : 0;
-            out += (math::dot(frustum.planes[p], float4(entry.boxPointsWS[4], 1.f)) < 0.f) ? 1 : 0;
-            out += (math::dot(frustum.planes[p], float4(entry.boxPointsWS[5], 1.f)) < 0.f) ? 1 : 0;
-            out += (math::dot(frustum.planes[p], float4(entry.boxPointsWS[6], 1.f)) < 0.f) ? 1 : 0;
-            out += (math::dot(frustum.planes[p], float4(entry.boxPointsWS[7], 1.f)) < 0.f) ? 1 : 0;
-            if (out == 8) { visible = false; break; }
+    auto add_visible = [&](const u32 poolId) {
+        isEachNodeVisible[poolId] = true;
+        push(visibleNodes, frameArena) = poolId;
+        visibilityFrustum.visible_nodes_count++;
+    };
+    // leaves the tree couldn't resolve are batched, and tested 8 at a time
+    u32 poolIds[8];
+    u32 planeMasks[8];
+    u32 batchCount = 0;
+    auto flush_batch = [&]() {
+        const u32 visible = areCullEntriesVisible_256(
+            cullTree.entryBlocks, poolIds, planeMasks, batchCount, frustum);
+        for (u32 i = 0; i < batchCount; i++) {
+            if (visible & (1 << i)) { add_visible(poolIds[i]); }
+        }
+        batchCount = 0;
+    };
+    traverseCullTree(cullTree, frustum, [&](const u32 poolId, const u32 planeMask) {
+        if (!planeMask) { add_visible(poolId); return; } // fully inside
+        poolIds[batchCount] = poolId;
+        planeMasks[batchCount++] = planeMask;
+        if (batchCount == 8) { flush_batch(); }
+    });
+    if (batchCount) { flush_batch(); }
+    visibilityFrustum.visible_nodes = visibleNodes.data;
+}
+#if __DEBUG
+// Times isCullEntryVisible against areCullEntriesVisible_256 over every node (worst case for the
+// tree, where no subtree gets culled), on synthetic scenes of increasing size
+void benchmarkCullEntries(allocator::PagedArena scratchArena) {
+    const u32 nodeCounts[] = { 1000, 10000, 100000 };
+    Frustum frustum;
+    frustum.numPlanes = Frustum::MAX_PLANE_COUNT;
+    for (u32 p = 0; p < frustum.numPlanes; p++) {
+        // random planes facing the origin
+        const float3 normal = math::normalize(
+            float3(math::rand() - 0.5f, math::rand() - 0.5f, math::rand() - 0.5f));
+        frustum.planes[p] = float4(normal, 50.f + 20.f * math::rand());
+    }
+    for (u32 b = 0; b < countof(nodeCounts); b++) {
+        allocator::PagedArena arena = scratchArena; // explicit copy
+        const u32 count = nodeCounts[b];
+        CullEntry* entries = ALLOC_ARRAY(arena, CullEntry, count);
+        CullEntryBlock* blocks = ALLOC_ARRAY(arena, CullEntryBlock, (count + 7) / 8);
+        u32* poolIds = ALLOC_ARRAY(arena, u32, count);
+        u32* planeMasks = ALLOC_ARRAY(arena, u32, count);
+        for (u32 n = 0; n < count; n++) {
+            const float3 center(
+                100.f * (math::rand() - 0.5f), 100.f * (math::rand() - 0.5f),
+                100.f * (math::rand() - 0.5f));
+            for (u32 c = 0; c < 8; c++) {
+                const float3 corner(
+                    center.x + ((c & 1) ? 1.f : -1.f), center.y + ((c & 2) ? 1.f : -1.f),
+                    center.z + ((c & 4) ? 1.f : -1.f));
+                entries[n].boxPointsWS[c] = corner;
+                blocks[n / 8].x[c][n % 8] = corner.x;
+                blocks[n / 8].y[c][n % 8] = corner.y;
+                blocks[n / 8].z[c][n % 8] = corner.z;
+            }
+            entries[n].poolId = poolIds[n] = n;
+            planeMasks[n] = (1 << frustum.numPlanes) - 1;
         }
-        // frustum inside quad??
 
-        if (visible) {
-            isEachNodeVisible[entry.poolId] = true;
-            push(visibleNodes, frameArena) = entry.poolId;
-            visibilityFrustum.visible_nodes_count++;
+        u32 visibleScalar = 0, visibleSIMD = 0;
+        u64 start = __rdtsc();
+        for (u32 n = 0; n < count; n++) {
+            visibleScalar += isCullEntryVisible(entries[n], frustum, planeMasks[n]) ? 1 : 0;
         }
+        const u64 cyclesScalar = __rdtsc() - start;
+        start = __rdtsc();
+        for (u32 n = 0; n < count; n += 8) {
+            const u32 visible = areCullEntriesVisible_256(
+                blocks, &poolIds[n], &planeMasks[n], math::min(count - n, 8u), frustum);
+            visibleSIMD += __popcnt(visible);
+        }
+        const u64 cyclesSIMD = __rdtsc() - start;
+        for (u32 n = 0; n < count; n += 8) {
+            const u32 lanes = math::min(count - n, 8u);
+            const u32 visible = areCullEntriesVisible_256(
+                blocks, &poolIds[n], &planeMasks[n], lanes, frustum);
+            for (u32 i = 0; i < lanes; i++) {
+                assert(((visible >> i) & 1) == (isCullEntryVisible(entries[n + i], frustum, planeMasks[n + i]) ? 1u : 0u));
+            }
+        }
+        io::debuglog(
+            "cull entries %6d nodes: scalar %.3f Mcycles, 8-wide %.3f Mcycles (%.2fx), %d visible\n",
+            count, cyclesScalar / 1000000.f, cyclesSIMD / 1000000.f,
+            cyclesScalar / (f32)cyclesSIMD, visibleSIMD);
+        assert(visibleScalar == visibleSIMD);
     }
-    visibilityFrustum.visible_nodes = visibleNodes.data;
 }
+// Walks the cull tree, checking that every node bounds its children and agrees with them on
+// parent links and heights, and that each leaf is the one leafIds points to. Returns the leaf count
+u32 checkCullTree(const CullTree& tree) {
+    if (tree.root == CullTree::Invalid) { return 0; }
+    assert(tree.nodes[tree.root].parent == CullTree::Invalid);
+    u32 stackNodes[CullTree::MaxStackSize];
+    u32 stackCount = 0;
+    stackNodes[stackCount++] = tree.root;
+    u32 leafCount = 0;
+    while (stackCount) {
+        const u32 nodeId = stackNodes[--stackCount];
+        const CullTree::Node& node = tree.nodes[nodeId];
+        if (node.height == 0) {
+            assert(tree.leafIds[node.poolId] == nodeId);
+            leafCount++;
+            continue;
+        }
+        s32 childHeight = 0;
+        for (u32 c = 0; c < 2; c++) {
+            const CullTree::Node& child = tree.nodes[node.children[c]];
+            assert(child.parent == nodeId);
+            assert(child.min.x >= node.min.x && child.min.y >= node.min.y && child.min.z >= node.min.z);
+            assert(child.max.x <= node.max.x && child.max.y <= node.max.y && child.max.z <= node.max.z);
+            childHeight = math::max(childHeight, child.height);
+            assert(stackCount < CullTree::MaxStackSize);
+            stackNodes[stackCount++] = node.children[c];
+        }
+        assert(node.height == childHeight + 1);
+    }
+    return leafCount;
+}
+// Checks removeCullNode and updateCullNode on a copy of the scene's cull tree: removes every other
+// draw node in it, and adds them back. Returns the number of draw nodes removed
+u32 validateCullTree(allocator::PagedArena scratchArena, const Scene& scene) {
+    Scene copy = scene; // only the cull tree is written to
+    CullTree& tree = copy.cullTree;
+    const u32 maxLeaves = (tree.cap + 1) / 2;
+    tree.nodes = ALLOC_ARRAY(scratchArena, CullTree::Node, tree.cap);
+    tree.entryBlocks = ALLOC_ARRAY(scratchArena, CullEntryBlock, (maxLeaves + 7) / 8);
+    tree.leafIds = ALLOC_ARRAY(scratchArena, u32, maxLeaves);
+    memcpy(tree.nodes, scene.cullTree.nodes, sizeof(CullTree::Node) * tree.cap);
+    memcpy(tree.entryBlocks, scene.cullTree.entryBlocks, sizeof(CullEntryBlock) * ((maxLeaves + 7) / 8));
+    memcpy(tree.leafIds, scene.cullTree.leafIds, sizeof(u32) * maxLeaves);
+
+    const u32 leafCount = checkCullTree(tree);
+    u32* removed = ALLOC_ARRAY(scratchArena, u32, maxLeaves);
+    u32 removedCount = 0, visited = 0;
+    for (u32 poolId = 0; poolId < maxLeaves; poolId++) {
+        if (tree.leafIds[poolId] == CullTree::Invalid) { continue; }
+        if (visited++ % 2) { continue; }
+        removeCullNode(copy, poolId + 1);
+        assert(tree.leafIds[poolId] == CullTree::Invalid);
+        removed[removedCount++] = poolId;
+    }
+    assert(checkCullTree(tree) == leafCount - removedCount);
+    for (u32 i = 0; i < removedCount; i++) { updateCullNode(copy, removed[i] + 1); }
+    assert(checkCullTree(tree) == leafCount);
+    return removedCount;
+}
+#endif
 void computeVisibilityCS(VisibleNodes& visibleNodes, u32* isEachNodeVisible, float4x4& vpMatrix,
                          const Scene& scene) {
     auto cull_isVisible = [](float4x4 mvp, float3 min, float3 max) -> bool {
@@ -430,16 +895,18 @@ void computeVisibilityCS(VisibleNodes& visibleNodes, u32* isEachNodeVisible, flo
         return true;
     };
 
-    for (u32 n = 0, count = 0; n < scene.drawNodes.cap && count < scene.drawNodes.count; n++) {
-        if (scene.drawNodes.data[n].alive == 0) { continue; }
-        count++;
-
-        const DrawNode& node = scene.drawNodes.data[n].state.live;
+    // the tree only discards nodes fully outside a clip plane, the remaining ones still
+    // go through the full test above
+    Frustum frustum;
+    gfx::extract_frustum_planes_from_vp(frustum.planes, vpMatrix);
+    frustum.numPlanes = 6;
+    traverseCullTree(scene.cullTree, frustum, [&](const u32 poolId, const u32) {
+        const DrawNode& node = scene.drawNodes.data[poolId].state.live;
         if (cull_isVisible(math::mult(vpMatrix, node.nodeData.worldMatrix), node.min, node.max)) {
-            visibleNodes.visible_nodes[visibleNodes.visible_nodes_count++] = n;
-            isEachNodeVisible[n] = true;
+            visibleNodes.visible_nodes[visibleNodes.visible_nodes_count++] = poolId;
+            isEachNodeVisible[poolId] = true;
         }
-    }
+    });
 }
 struct SortParams {
     struct Type { enum Enum { Default, BackToFront }; };
@@ -453,6 +920,7 @@ struct SortParams {
     u32 drawNodeBits;
     u32 depthBits;
     u32 shaderTechniqueBits;
+    u32 keyBits; // bits used by makeSortKey, higher ones are always zero
 };
 void makeSortKeyBitParams(
     SortParams& params,
@@ -470,6 +938,7 @@ void makeSortKeyBitParams(
         params.depthMask = (1 << params.depthBits) - 1;
         params.maxDistValue = (1 << params.depthBits) - 1;
         params.maxDistSq = 1000.f * 1000.f;
+        params.keyBits = params.drawNodeBits + params.shaderTechniqueBits;
         assert(DrawNodeMeta::HandleBits + ShaderTechniques::Bits + 10 < sizeof(SortKeyValue) * 8);
     }
     break;
@@ -480,6 +949,7 @@ void makeSortKeyBitParams(
         params.depthMask = (1 << params.depthBits) - 1;
         params.maxDistValue = (1 << params.depthBits) - 1;
         params.maxDistSq = 1000.f * 1000.f; // todo: based on camera distance?
+        params.keyBits = params.drawNodeBits + params.shaderTechniqueBits + params.depthBits;
         assert(DrawNodeMeta::HandleBits + ShaderTechniques::Bits + 10 < sizeof(SortKeyValue) * 8);
     }
     break;
@@ -550,6 +1020,48 @@ void qsort_s64(SortKey* keys, s32 low, s32 high) {
     };
 };
 
+// LSD radix sort over the lowest keyBits of each key, 8 bits per pass, ping-ponging between the
+// keys and a scratch copy. All histograms are built in a single read, and passes where every key
+// falls in the same bucket are skipped (the draw node bits are mostly zero, for example).
+// Stable, so keys with the same value keep the order they were added in
+void radixsort_keys(SortKey* keys, const u32 count, const u32 keyBits, allocator::PagedArena scratchArena) {
+    const u32 radixBits = 8;
+    const u32 bucketCount = 1 << radixBits;
+    const u32 passCount = (keyBits + radixBits - 1) / radixBits;
+    if (count < 2 || passCount == 0) { return; }
+
+    u32* histograms = ALLOC_ARRAY(scratchArena, u32, passCount * bucketCount);
+    memset(histograms, 0, passCount * bucketCount * sizeof(u32));
+    for (u32 i = 0; i < count; i++) {
+        const SortKeyValue v = keys[i].v;
+        for (u32 pass = 0; pass < passCount; pass++) {
+            histograms[pass * bucketCount + ((v >> (pass * radixBits)) & (bucketCount - 1))]++;
+        }
+    }
+
+    SortKey* src = keys;
+    SortKey* dst = ALLOC_ARRAY(scratchArena, SortKey, count);
+    for (u32 pass = 0; pass < passCount; pass++) {
+        const u32 shift = pass * radixBits;
+        u32* histogram = &histograms[pass * bucketCount];
+        if (histogram[(src[0].v >> shift) & (bucketCount - 1)] == count) { continue; }
+        // histogram to bucket offsets
+        u32 offset = 0;
+        for (u32 b = 0; b < bucketCount; b++) {
+            const u32 bucketSize = histogram[b];
+            histogram[b] = offset;
+            offset += bucketSize;
+        }
+        for (u32 i = 0; i < count; i++) {
+            dst[histogram[(src[i].v >> shift) & (bucketCount - 1)]++] = src[i];
+        }
+        SortKey* temp = src;
+        src = dst;
+        dst = temp;
+    }
+    if (src != keys) { memcpy(keys, src, count * sizeof(SortKey)); }
+}
+
 // testing only
 void qsort_key(SortKey* keys, s32 low, s32 high) {
     qsort(keys, 0, high, sizeof(SortKey),
@@ -561,8 +1073,9 @@ void qsort_key(SortKey* keys, s32 low, s32 high) {
 void addNodesToDrawlistSorted(
     Drawlist& dl, const VisibleNodes& visibleNodes, float3 cameraPos,
     Scene& scene, CoreResources& rsc, const u32 includeFilter, const u32 excludeFilter,
-    const SortParams::Type::Enum sortType) {
+    const SortParams::Type::Enum sortType, allocator::PagedArena scratchArena) {
 
+    __PROFILEONLY(profiler::start_zone("drawlist build");)
     SortParams sortParams;
     makeSortKeyBitParams(sortParams, sortType);
         
@@ -604,11 +1117,8 @@ void addNodesToDrawlistSorted(
     }
     const bool addInstancedNodes = true;
     if (addInstancedNodes) {
-        for (u32 n = 0, count = 0;n < scene.instancedDrawNodes.cap && count < scene.instancedDrawNodes.count; n++) {
-            if (scene.instancedDrawNodes.data[n].alive == 0) { continue; }
-            count++;
-            
-            const DrawNodeInstanced& node = scene.instancedDrawNodes.data[n].state.live;
+        for (u32 n = 0; n < scene.instancedDrawNodes.count; n++) {
+            const DrawNodeInstanced& node = scene.instancedDrawNodes.data[n];
             
             if (includeFilter & DrawlistFilter::Alpha && node.nodeData.groupColor.w == 1.f) continue; 
             if (excludeFilter & DrawlistFilter::Alpha && node.nodeData.groupColor.w < 1.f) continue;
@@ -638,13 +1148,62 @@ void addNodesToDrawlistSorted(
         }
     }
 
-    qsort_s64(dl.keys,
-              0,
-              dl.count[DrawlistBuckets::Base] - 1);
-    qsort_s64(dl.keys,
-              dl.count[DrawlistBuckets::Base],
-              dl.count[DrawlistBuckets::Base] + dl.count[DrawlistBuckets::Instanced] - 1);
+    __PROFILEONLY(profiler::end_zone();)
+
+    __PROFILEONLY(profiler::start_zone("sort");)
+    radixsort_keys(
+        dl.keys, dl.count[DrawlistBuckets::Base], sortParams.keyBits, scratchArena);
+    radixsort_keys(
+        &dl.keys[dl.count[DrawlistBuckets::Base]], dl.count[DrawlistBuckets::Instanced],
+        sortParams.keyBits, scratchArena);
+    __PROFILEONLY(profiler::end_zone();)
+}
+
+#if __DEBUG
+// Times qsort_s64 against radixsort_keys on keys built the same way addNodesToDrawlistSorted
+// does: a handful of shader techniques, random depths, and nodes added in pool order
+void benchmarkSortKeys(allocator::PagedArena scratchArena) {
+    const u32 keyCounts[] = { 256, 1024, 4096 };
+    const SortParams::Type::Enum sortTypes[] = {
+        SortParams::Type::Default, SortParams::Type::BackToFront };
+    const char* sortTypeNames[] = { "default", "back to front" };
+    for (u32 t = 0; t < countof(sortTypes); t++) {
+        SortParams sortParams;
+        makeSortKeyBitParams(sortParams, sortTypes[t]);
+        for (u32 b = 0; b < countof(keyCounts); b++) {
+            allocator::PagedArena arena = scratchArena; // explicit copy
+            const u32 count = keyCounts[b];
+            SortKey* keys = ALLOC_ARRAY(arena, SortKey, count);
+            SortKey* keysQsort = ALLOC_ARRAY(arena, SortKey, count);
+            SortKey* keysRadix = ALLOC_ARRAY(arena, SortKey, count);
+            for (u32 i = 0; i < count; i++) {
+                makeSortKeyDistParams(sortParams, 1000.f * 1000.f * math::rand() * math::rand());
+                const u32 shaderTechnique = ShaderTechniques::Color3D + (u32)(math::rand() * 4.f) % 4;
+                keys[i].v = makeSortKey(i / DrawlistStreams::Count, shaderTechnique, sortParams);
+                keys[i].idx = i;
+            }
+            memcpy(keysQsort, keys, count * sizeof(SortKey));
+            memcpy(keysRadix, keys, count * sizeof(SortKey));
+
+            u64 start = __rdtsc();
+            qsort_s64(keysQsort, 0, count - 1);
+            const u64 cyclesQsort = __rdtsc() - start;
+            start = __rdtsc();
+            radixsort_keys(keysRadix, count, sortParams.keyBits, arena);
+            const u64 cyclesRadix = __rdtsc() - start;
+            for (u32 i = 0; i < count; i++) {
+                assert(keysQsort[i].v == keysRadix[i].v);
+                assert(i == 0 || keysRadix[i - 1].v < keysRadix[i].v
+                       || keysRadix[i - 1].idx < keysRadix[i].idx); // stable
+            }
+            io::debuglog(
+                "sort keys (%s) %5d keys: qsort %.3f Mcycles, radix %.3f Mcycles (%.2fx)\n",
+                sortTypeNames[t], count, cyclesQsort / 1000000.f, cyclesRadix / 1000000.f,
+                cyclesQsort / (f32)cyclesRadix);
+        }
+    }
 }
+#endif
 
 #if __DEBUG
 void recompileShaders(CoreResources& rsc) {
@@ -1,6 +1,10 @@
 #ifndef __WASTELADNS_SCENE_H__
 #define __WASTELADNS_SCENE_H__
 
+#ifndef __COOK_ASSETS
+#define __COOK_ASSETS 0
+#endif
+
 namespace game {
 
 const f32 SDF_scene_radius = 8.5f;
@@ -11,6 +15,11 @@ struct Mirrors { // todo: figure out delete, unhack sizes
     renderer::DrawMesh* drawMeshes;
     bvh::Tree bvh; // used to accelerate visibility queries
     u32 count;
+    // only set in rooms with moving mirrors: they animate a copy of the mirror hall vertices,
+    // and refit the bvh over them every frame
+    float3* vertices;
+    f32 time;
+    bvh::BuildMode::Enum bvhBuildMode;
 };
 struct GPUCPUMesh {
     renderer::CPUMesh cpuBuffer;
@@ -42,12 +51,28 @@ struct AssetInMemory {
     animation::Clip* clips;
     u32 clipCount;
 };
+// cpu side copy of an asset's meshes, one per drawlist stream, as they get uploaded to the gpu
+struct AssetStreams {
+    struct Stream {
+        u8* vertexData; // vertexCount * vertexSize bytes, in the stream's vertex layout
+        u32* indices;
+        const char* texturePath; // null if untextured
+        u32 vertexCount;
+        u32 vertexSize;
+        u32 indexCount;
+    };
+    Stream streams[renderer::DrawlistStreams::Count];
+};
 struct Resources {
     struct AssetsMeta { enum Enum { Bird, Ground, BackMirrors, Count }; };
     struct MirrorHallMeta { enum Enum { Count = 4 }; };
     renderer::CoreResources renderCore;
     AssetInMemory assets[AssetsMeta::Count];
     GPUCPUMesh mirrorHallMesh;
+    // same mirror hall in a cpu-writable buffer, for rooms with moving mirrors
+    gfx::rhi::RscIndexedVertexBuffer mirrorHallDynamicBuffer;
+    renderer::VertexLayout_Color_3D* mirrorHallVertices;
+    u16* mirrorHallIndices;
     renderer::MeshHandle instancedUnitCubeMesh;
     renderer::MeshHandle instancedUnitSphereMesh;
     renderer::MeshHandle groundMesh;
@@ -65,13 +90,19 @@ struct RoomDefinition {
     f32 minCameraZoom;
     f32 maxCameraZoom;
     u32 maxMirrorBounces;
+    bvh::BuildMode::Enum mirrorBVHBuildMode;
     bool physicsBalls;
+    bool movingMirrors;
 };
 const RoomDefinition roomDefinitions[] = {
     { float3(-180.f * math::d2r32, 0.f, -180 * math::d2r32), // min camera eulers
       float3(-3.f * math::d2r32, 0.f, 180 * math::d2r32), // max camera eulers
       0.3f, 2.f,
-      8, true }
+      8, bvh::BuildMode::SAH, true, false },
+    { float3(-180.f * math::d2r32, 0.f, -180 * math::d2r32), // min camera eulers
+      float3(-3.f * math::d2r32, 0.f, 180 * math::d2r32), // max camera eulers
+      0.3f, 2.f,
+      8, bvh::BuildMode::SAH, true, true }
 };
 
 void spawnAsset(
@@ -88,12 +119,11 @@ Scene& scene, const AssetInMemory& def, const float3& spawnPos) {
     renderNode.min = def.min;
     renderNode.max = def.max;
     memcpy(renderNode.meshHandles, def.meshHandles, sizeof(renderNode.meshHandles));
-    gfx::rhi::RscCBuffer& cbuffercore = allocator::alloc_pool(renderScene.cbuffers);
-    renderNode.cbuffer_node = handle_from_cbuffer(renderScene, cbuffercore);
-    gfx::rhi::create_cbuffer(cbuffercore, { sizeof(renderer::NodeData) });
+    renderNode.cbuffer_node = renderer::request_cbuffer(renderScene, sizeof(renderer::NodeData));
+    renderer::updateCullNode(renderScene, renderHandle);
     if (def.skeleton.jointCount) {
         animation::Scene& animScene = scene.animScene;
-        animation::Node& animNode = allocator::alloc_pool(animScene.nodes);
+        animation::Node& animNode = allocator::alloc_packed_pool(animScene.nodes);
         animationHandle = animation::handle_from_node(animScene, animNode);
         animNode = {};
         animNode.skeleton = def.skeleton;
@@ -102,16 +132,17 @@ Scene& scene, const AssetInMemory& def, const float3& spawnPos) {
         animNode.state.animIndex = 0;
         animNode.state.time = 0.f;
         animNode.state.scale = 1.f;
+        animNode.state.updateInterval = 1;
+        animNode.drawHandle = renderHandle;
+        animNode.state.boundsMin = def.min; // until the first pose
+        animNode.state.boundsMax = def.max;
         for (u32 m = 0; m < animNode.skeleton.jointCount; m++) {
             float4x4& matrix = animNode.state.skinning[m];
             math::identity4x4(*(Transform*)&(matrix));
         }
         // skinning data for rendering
-        gfx::rhi::RscCBuffer& cbufferskinning =
-            allocator::alloc_pool(renderScene.cbuffers);
-        renderNode.cbuffer_ext = handle_from_cbuffer(renderScene, cbufferskinning);
-        gfx::rhi::create_cbuffer(cbufferskinning,
-            { (u32) sizeof(float4x4) * animNode.skeleton.jointCount });
+        renderNode.cbuffer_ext = renderer::request_cbuffer(
+            renderScene, (u32) sizeof(float4x4) * animNode.skeleton.jointCount);
         renderNode.ext_data = animNode.state.skinning;
     }
     // todo: physics??
@@ -119,7 +150,8 @@ Scene& scene, const AssetInMemory& def, const float3& spawnPos) {
 
 void spawn_model_as_mirrors(
     game::Mirrors& mirrors, const game::GPUCPUMesh& loadedMesh,
-    allocator::PagedArena scratchArena, allocator::PagedArena& sceneArena, bool accelerateBVH) {
+    allocator::PagedArena scratchArena, allocator::PagedArena& sceneArena, bool accelerateBVH,
+    const bvh::BuildMode::Enum bvhBuildMode, const bool refitBVH) {
 
     const renderer::CPUMesh& cpuMesh = loadedMesh.cpuBuffer;
     u32* triangleIds;
@@ -170,12 +202,84 @@ void spawn_model_as_mirrors(
         index += mesh.vertexBuffer.indexCount;
     }
 
-    if (accelerateBVH) {
+    // if the mesh doesn't fit the bvh index width, no tree is built and every mirror gets tested
+    if (accelerateBVH &&
         bvh::buildTree(
             sceneArena, scratchArena, mirrors.bvh, &(loadedMesh.cpuBuffer.vertices[0].x),
-            loadedMesh.cpuBuffer.indices, loadedMesh.cpuBuffer.indexCount, triangleIds);
+            cpuMesh.indices, loadedMesh.cpuBuffer.indexCount, triangleIds,
+            bvhBuildMode, __DEBUG || refitBVH)) { // refit, the debug checks and drawing need the binary tree
+        #if __DEBUG
+        const bvh::Index* indices = cpuMesh.indices;
+        bvh::TreeStats stats;
+        bvh::computeTreeStats(stats, scratchArena, mirrors.bvh);
+        io::debuglog(
+            "Mirror BVH (%s): %d nodes (%d wide), %d leaves, depth %d, SAH cost %.3f\n",
+            bvhBuildMode == bvh::BuildMode::SAH ? "SAH" : "midpoint",
+            stats.nodeCount, stats.wideNodeCount, stats.leafCount, stats.maxDepth, stats.sahCost);
+        f32 sahCosts[3];
+        const u32 rebuiltCount = bvh::validateRefit(
+            sahCosts, scratchArena, mirrors.bvh, &(cpuMesh.vertices[0].x), indices,
+            cpuMesh.indexCount, triangleIds, 1.25f, bvhBuildMode);
+        io::debuglog(
+            "Mirror BVH refit check: %d subtrees rebuilt after swapping triangles in half the "
+            "tree, SAH cost %.3f refit, %.3f rebuilt, %.3f fresh\n",
+            rebuiltCount, sahCosts[0], sahCosts[1], sahCosts[2]);
+        #endif
     }
 }
+// Swings each mirror quad around its vertical axis, then updates the mirror polys, the bvh and
+// the gpu vertices to match
+void update_moving_mirrors(
+    game::Mirrors& mirrors, const game::Resources& core,
+    allocator::PagedArena& sceneArena, allocator::PagedArena scratchArena, const f32 dt) {
+
+    const renderer::CPUMesh& restMesh = core.mirrorHallMesh.cpuBuffer;
+    const f32 maxAngle = 12.f * math::d2r32;
+    const f32 frequency = 0.25f;
+    mirrors.time += dt;
+    for (u32 v = 0; v + 4 <= restMesh.vertexCount; v += 4) {
+        const float3* rest = &restMesh.vertices[v];
+        const float3 center = math::scale(
+            math::add(math::add(rest[0], rest[1]), math::add(rest[2], rest[3])), 0.25f);
+        const f32 angle =
+            maxAngle * math::sin(math::twopi32 * (frequency * mirrors.time + (f32)v / (f32)restMesh.vertexCount));
+        const f32 c = math::cos(angle);
+        const f32 s = math::sin(angle);
+        for (u32 i = 0; i < 4; i++) {
+            const float3 d = math::subtract(rest[i], center);
+            mirrors.vertices[v + i] =
+                float3(center.x + c * d.x - s * d.y, center.y + s * d.x + c * d.y, rest[i].z);
+        }
+    }
+
+    // same triangles as spawn_model_as_mirrors, through the offsets in the draw meshes
+    for (u32 i = 0; i < mirrors.count; i++) {
+        game::Mirrors::Poly& poly = mirrors.polys[i];
+        const bvh::Index* indices = &restMesh.indices[mirrors.drawMeshes[i].vertexBuffer.indexOffset];
+        for (u32 p = 0; p < poly.numPts; p++) { poly.v[p] = mirrors.vertices[indices[p]]; }
+        poly.normal = math::normalize(math::cross(math::subtract(poly.v[2], poly.v[0]), math::subtract(poly.v[1], poly.v[0])));
+    }
+
+    if (mirrors.bvh.wideNodeCount) {
+        bvh::refit(
+            sceneArena, scratchArena, mirrors.bvh, &(mirrors.vertices[0].x), restMesh.indices,
+            1.25f, mirrors.bvhBuildMode);
+    }
+
+    renderer::VertexLayout_Color_3D* gpuVertices =
+        ALLOC_ARRAY(scratchArena, renderer::VertexLayout_Color_3D, restMesh.vertexCount);
+    for (u32 i = 0; i < restMesh.vertexCount; i++) {
+        gpuVertices[i] = { mirrors.vertices[i], core.mirrorHallVertices[i].color };
+    }
+    gfx::rhi::IndexedBufferUpdateParams bufferParams;
+    bufferParams.vertexData = gpuVertices;
+    bufferParams.vertexSize = restMesh.vertexCount * sizeof(renderer::VertexLayout_Color_3D);
+    bufferParams.indexData = core.mirrorHallIndices;
+    bufferParams.indexSize = restMesh.indexCount * sizeof(u16);
+    bufferParams.indexCount = restMesh.indexCount;
+    gfx::rhi::RscIndexedVertexBuffer buffer = core.mirrorHallDynamicBuffer;
+    gfx::rhi::update_indexed_vertex_buffer(buffer, bufferParams);
+}
 }
 
 namespace fbx {
@@ -187,9 +291,26 @@ void from_ufbx_mat(float4x4& o, const ufbx_matrix& i) {
     o.col3.x = i.cols[3].x; o.col3.y = i.cols[3].y; o.col3.z = i.cols[3].z; o.col3.w = 1.f;
 };
 
+// visit(jointIndex, position) gets every vertex in the joint space of each joint that skins it
+// (same weights as extract_skinning_attribs)
+template<typename _Visit>
+void for_each_joint_vertex(const ufbx_mesh& mesh, const animation::Skeleton& skeleton, _Visit&& visit) {
+    const ufbx_skin_deformer& skin = *(mesh.skin_deformers.data[0]);
+    for (size_t v = 0; v < mesh.num_vertices; v++) {
+        const ufbx_skin_vertex& skinned = skin.vertices.data[v];
+        const u32 num_weights = math::min(skinned.num_weights, 4u);
+        const float4 vertex(mesh.vertices[v].x, mesh.vertices[v].y, mesh.vertices[v].z, 1.f);
+        for (u32 wi = 0; wi < num_weights; wi++) {
+            const ufbx_skin_weight& weight = skin.weights.data[skinned.weight_begin + wi];
+            if (weight.cluster_index >= skeleton.jointCount || weight.weight <= 0.f) { continue; }
+            const u32 joint_index = weight.cluster_index;
+            visit(joint_index, math::mult(skeleton.jointFromGeometry[joint_index], vertex).xyz);
+        }
+    }
+}
 void extract_anim_data(game::AssetInMemory& assetToAdd,
-                       allocator::PagedArena& persistentArena, const ufbx_mesh& mesh,
-                       const ufbx_scene& scene) {
+                       allocator::PagedArena& persistentArena, allocator::PagedArena scratchArena,
+                       const ufbx_mesh& mesh, const ufbx_scene& scene) {
 
     const u32 maxjoints = 128;
     ufbx_matrix jointFromGeometry[maxjoints];
@@ -210,8 +331,7 @@ void extract_anim_data(game::AssetInMemory& assetToAdd,
     u32* node_indices_skeleton = ALLOC_ARRAY(persistentArena, u32, jointCount);
     s8* nodeIdtoJointId = ALLOC_ARRAY(persistentArena, s8, scene.nodes.count);
     skeleton.jointFromGeometry = ALLOC_ARRAY(persistentArena, float4x4, jointCount);
-    skeleton.parentFromPosedJoint = ALLOC_ARRAY(persistentArena, float4x4, jointCount);
-    skeleton.geometryFromPosedJoint = ALLOC_ARRAY(persistentArena, float4x4, jointCount);
+    skeleton.jointBounds = ALLOC_ARRAY(persistentArena, float4, jointCount);
     skeleton.parentIndices = ALLOC_ARRAY(persistentArena, s8, jointCount);
     skeleton.jointCount = jointCount;
 
@@ -226,18 +346,33 @@ void extract_anim_data(game::AssetInMemory& assetToAdd,
         } else { // if (node.parent) { // todo: multiple roots??
             skeleton.parentIndices[joint_index] = nodeIdtoJointId[node.parent->typed_id];
         }
-        from_ufbx_mat(skeleton.geometryFromPosedJoint[joint_index], node.node_to_world); // default
         nodeIdtoJointId[node_index] = joint_index;
         node_indices_skeleton[joint_index] = node_index;
     }
 
-    // todo: default
-    for (u32 joint_index = 0; joint_index < skeleton.jointCount; joint_index++) {
-        float4x4& m = skeleton.parentFromPosedJoint[joint_index];
-        m.col0 = { 1.f, 0.f, 0.f, 0.f };
-        m.col1 = { 0.f, 1.f, 0.f, 0.f };
-        m.col2 = { 0.f, 0.f, 1.f, 0.f };
-        m.col3 = { 0.f, 0.f, 0.f, 1.f };
+    // Bounding sphere of each joint, in joint space, around every vertex it skins.
+    // The center is that of the box around the vertices
+    {
+        float3* jointMin = ALLOC_ARRAY(scratchArena, float3, jointCount);
+        float3* jointMax = ALLOC_ARRAY(scratchArena, float3, jointCount);
+        for (u32 joint_index = 0; joint_index < jointCount; joint_index++) {
+            jointMin[joint_index] = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+            jointMax[joint_index] = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            skeleton.jointBounds[joint_index] = float4(0.f, 0.f, 0.f, -1.f);
+        }
+        for_each_joint_vertex(mesh, skeleton, [&](const u32 joint_index, const float3& p) {
+            jointMin[joint_index] = math::min(jointMin[joint_index], p);
+            jointMax[joint_index] = math::max(jointMax[joint_index], p);
+        });
+        for (u32 joint_index = 0; joint_index < jointCount; joint_index++) {
+            if (jointMin[joint_index].x > jointMax[joint_index].x) { continue; }
+            skeleton.jointBounds[joint_index].xyz =
+                math::scale(math::add(jointMin[joint_index], jointMax[joint_index]), 0.5f);
+        }
+        for_each_joint_vertex(mesh, skeleton, [&](const u32 joint_index, const float3& p) {
+            float4& sphere = skeleton.jointBounds[joint_index];
+            sphere.w = math::max(sphere.w, math::mag(math::subtract(p, sphere.xyz)));
+        });
     }
 
     // anim clip
@@ -251,31 +386,62 @@ void extract_anim_data(game::AssetInMemory& assetToAdd,
         const u32 numFrames = math::clamp((u32)(duration * targetFramerate), 2u, maxFrames);
         const f64 framerate = (numFrames-1) / duration;
 
-        animation::Clip& clip = assetToAdd.clips[i];
+        // sample the clip uncompressed into scratch memory, only the compressed clip is kept
+        allocator::PagedArena clipArena = scratchArena; // explicit copy
+        animation::Clip clip = {};
         clip.frameCount = numFrames;
-        clip.joints = ALLOC_ARRAY(persistentArena, animation::JointKeyframes, jointCount);
+        clip.blockCount = animation::get_block_count(jointCount);
+        clip.frames = ALLOC_ARRAY(clipArena, animation::JointBlock, numFrames * clip.blockCount);
         clip.timeEnd = (f32)stack.time_end;
-        for (u32 joint_index = 0; joint_index < jointCount; joint_index++) {
+        for (u32 joint_index = 0; joint_index < clip.blockCount * animation::JointLanes; joint_index++) {
+            const u32 block_index = joint_index / animation::JointLanes;
+            const u32 lane = joint_index % animation::JointLanes;
+            if (joint_index >= jointCount) { // padding lanes
+                for (u32 f = 0; f < numFrames; f++) {
+                    animation::set_joint_lane(
+                        clip.frames[f * clip.blockCount + block_index], lane,
+                        float3(0.f, 0.f, 0.f), float4(0.f, 0.f, 0.f, 1.f), float3(1.f, 1.f, 1.f));
+                }
+                continue;
+            }
             ufbx_node* node = scene.nodes.data[node_indices_skeleton[joint_index]];
-			animation::JointKeyframes& joint = clip.joints[joint_index];
-            joint.joint_to_parent_trs =
-                ALLOC_ARRAY(persistentArena, animation::Joint_TRS, numFrames);
+            float4 prevRotation(0.f, 0.f, 0.f, 1.f);
             for (u32 f = 0; f < numFrames; f++) {
-                animation::Joint_TRS& keyframeJoint = joint.joint_to_parent_trs[f];
                 f64 time = stack.time_begin + (double)f / framerate;
                 ufbx_transform transform = ufbx_evaluate_transform(&stack.anim, node, time);
-                keyframeJoint.rotation.x = transform.rotation.x;
-                keyframeJoint.rotation.y = transform.rotation.y;
-                keyframeJoint.rotation.z = transform.rotation.z;
-                keyframeJoint.rotation.w = transform.rotation.w;
-                keyframeJoint.translation.x = transform.translation.x;
-                keyframeJoint.translation.y = transform.translation.y;
-                keyframeJoint.translation.z = transform.translation.z;
-                keyframeJoint.scale.x = transform.scale.x;
-                keyframeJoint.scale.y = transform.scale.y;
-                keyframeJoint.scale.z = transform.scale.z;
+                float4 rotation(
+                    (f32)transform.rotation.x, (f32)transform.rotation.y,
+                    (f32)transform.rotation.z, (f32)transform.rotation.w);
+                // keep consecutive keys on the same hemisphere, so the sampler can blend
+                // them directly without taking the long way around
+                if (f > 0 && math::quaternionDot(prevRotation, rotation) < 0.f) {
+                    rotation = float4(-rotation.x, -rotation.y, -rotation.z, -rotation.w);
+                }
+                prevRotation = rotation;
+                animation::set_joint_lane(
+                    clip.frames[f * clip.blockCount + block_index], lane,
+                    float3((f32)transform.translation.x, (f32)transform.translation.y,
+                           (f32)transform.translation.z),
+                    rotation,
+                    float3((f32)transform.scale.x, (f32)transform.scale.y, (f32)transform.scale.z));
             }
         }
+        animation::compressClip(
+            assetToAdd.clips[i], clip, jointCount, animation::CompressionParams(),
+            persistentArena, clipArena);
+#if __DEBUG
+        {
+            const animation::Clip& compressed = assetToAdd.clips[i];
+            const size_t rawSize = animation::get_clip_size(clip, jointCount);
+            const size_t compressedSize = animation::get_clip_size(compressed, jointCount);
+            io::debuglog(
+                "anim clip %s: %d joints x %d frames, %.1fKB -> %.1fKB (%.2fx), %d keys, "
+                "max joint error %.5f\n",
+                stack.name.data, jointCount, numFrames, rawSize / 1024.f, compressedSize / 1024.f,
+                rawSize / (f32)compressedSize, compressed.compressed.keyCount,
+                animation::computeMaxJointError(clip, compressed, skeleton, clipArena));
+        }
+#endif
     }
 }
 void extract_skinning_attribs(u8* joint_indices, u8* joint_weights,
@@ -312,8 +478,10 @@ struct PipelineAssetContext {
     const gfx::rhi::VertexAttribDesc* vertexAttrs[renderer::DrawlistStreams::Count];
     u32 attr_count[renderer::DrawlistStreams::Count];
 };
+// Parses the fbx file at path into the cpu side streams, allocated from the context's scratch arena
+// The skeleton and clips go into the context's persistent arena
 bool load_with_materials(
-    game::AssetInMemory& assetToAdd, renderer::CoreResources& renderCore,
+    game::AssetInMemory& assetToAdd, game::AssetStreams& assetStreams,
     PipelineAssetContext& pipelineContext, const char* path) {
    
     bool success = false;
@@ -384,7 +552,8 @@ bool load_with_materials(
         // hack: only consider skinning from first mesh
         if (scene->meshes.count && scene->meshes[0]->skin_deformers.count) {
             extract_anim_data(
-                assetToAdd, pipelineContext.persistentArena, *(scene->meshes[0]), *scene);
+                assetToAdd, pipelineContext.persistentArena, pipelineContext.scratchArena,
+                *(scene->meshes[0]), *scene);
         }
 
         // TODO: consider skinning
@@ -639,46 +808,43 @@ bool load_with_materials(
         assetToAdd.max = max;
         assetToAdd.min = min;
 
-        const renderer::ShaderTechniques::Enum shaderTechniques[renderer::DrawlistStreams::Count] = {
-            renderer::ShaderTechniques::Color3D, renderer::ShaderTechniques::Color3DSkinned,
-            renderer::ShaderTechniques::Textured3D, renderer::ShaderTechniques::Textured3DAlphaClip,
-            renderer::ShaderTechniques::Textured3DSkinned,
-            renderer::ShaderTechniques::Textured3DAlphaClipSkinned
-        };
+        // reorder triangles for the vertex cache and overdraw, and vertices for fetching,
+        // see meshopt.h. Every mirror reflection pass draws these again
+        for (u32 i = 0; i < renderer::DrawlistStreams::Count; i++) {
+            DstStreams& stream = materialVertexBuffer[i];
+            if (!stream.index.len) { continue; }
+            const u32 vertexCount = (u32)stream.vertex.len;
+            const u32 indexCount = (u32)stream.index.len;
+            #if __DEBUG
+            meshopt::CacheStats before, after;
+            meshopt::compute_cache_stats(
+                before, stream.index.data, indexCount, vertexCount, pipelineContext.scratchArena);
+            #endif
+            meshopt::optimize_triangle_order(
+                stream.index.data, indexCount, stream.vertex.data, stream.vertex_size, vertexCount,
+                pipelineContext.scratchArena);
+            stream.vertex.len = meshopt::optimize_vertex_order(
+                stream.vertex.data, stream.vertex_size, vertexCount, stream.index.data, indexCount,
+                pipelineContext.scratchArena);
+            #if __DEBUG
+            meshopt::compute_cache_stats(
+                after, stream.index.data, indexCount, (u32)stream.vertex.len,
+                pipelineContext.scratchArena);
+            io::debuglog(
+                "%s, stream %d (%d tris): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+                path, i, indexCount / 3, before.acmr, after.acmr, before.atvr, after.atvr);
+            #endif
+        }
+
 		for (u32 i = 0; i < renderer::DrawlistStreams::Count; i++) {
-			DstStreams& stream = materialVertexBuffer[i];
-			if (!stream.vertex.len) { continue; }
-
-            gfx::rhi::IndexedVertexBufferDesc desc = {};
-            desc.vertexData = stream.vertex.data;
-            desc.vertexSize = (u32)stream.vertex.len * stream.vertex_size;
-            desc.vertexCount = (u32)stream.vertex.len;
-            desc.indexData = stream.index.data;
-            desc.indexSize = (u32)stream.index.len * sizeof(u32);
-            desc.indexCount = (u32)stream.index.len;
-            desc.memoryUsage = gfx::rhi::BufferMemoryUsage::GPU;
-            desc.accessType = gfx::rhi::BufferAccessType::GPU;
-            desc.indexType = gfx::rhi::BufferItemType::U32;
-            desc.type = gfx::rhi::BufferTopologyType::Triangles;
-
-            const renderer::ShaderTechniques::Enum shaderTechnique =
-                shaderTechniques[i];
-            renderer::DrawMesh& mesh =
-                renderer::alloc_drawMesh(renderCore);
-            mesh = {};
-            mesh.shaderTechnique = shaderTechnique;
-            gfx::rhi::create_indexed_vertex_buffer(
-                mesh.vertexBuffer, desc, pipelineContext.vertexAttrs[i],
-                pipelineContext.attr_count[i]);
-            if (stream.user) {
-                const char* texturefile =
-                    ((ufbx_texture*)stream.user)->filename.data;
-                gfx::rhi::create_texture_from_file(
-                    mesh.texture,
-                    { pipelineContext.scratchArena, texturefile });
-            }
-            assetToAdd.meshHandles[i] =
-                handle_from_drawMesh(renderCore, mesh);
+			const DstStreams& stream = materialVertexBuffer[i];
+            game::AssetStreams::Stream& dst = assetStreams.streams[i];
+            dst.vertexData = stream.vertex.data;
+            dst.vertexCount = (u32)stream.vertex.len;
+            dst.vertexSize = stream.vertex_size;
+            dst.indices = stream.index.data;
+            dst.indexCount = (u32)stream.index.len;
+            dst.texturePath = stream.user ? ((ufbx_texture*)stream.user)->filename.data : nullptr;
 		}
         success = true;
     }
@@ -686,6 +852,222 @@ bool load_with_materials(
 }
 } // fbx
 
+namespace cooked {
+
+// Cooked assets hold the output of fbx::load_with_materials in a single versioned binary file, laid
+// out as the runtime structs: the header with the asset and its streams, followed by their arrays.
+// Pointers are saved as offsets from the start of the file (0 for null), so loading is mapping the
+// file and patching those pointers in place (the mapping is copy-on-write, only the pages holding
+// the header and clips get copied). The version needs bumping whenever any of the structs change.
+// Cooked files are only valid on the platform that wrote them
+
+const u32 magic = 0x53414c57; // "WLAS"
+const u32 version = 2;
+const size_t sectionAlign = 32; // enough for aligned avx loads of the keyframes
+
+struct Header {
+    u32 magic;
+    u32 version;
+    u32 headerSize; // catches struct changes that forgot to bump the version
+    u32 padding;
+    u64 size;
+    s64 sourceTimestamp; // last modified time of the source fbx, when it was cooked
+    game::AssetInMemory asset; // mesh handles are not saved
+    game::AssetStreams streams;
+};
+
+// The count elements at the saved offset must be past the header, inside the file and aligned
+// for their type (the mapping starts at a page boundary, so checking the offset is enough). The
+// size check is written so that no offset or count can overflow it
+template <typename _T>
+bool relocate(_T*& ptr, const size_t count, u8* base, const size_t size) {
+    const uintptr_t offset = (uintptr_t)ptr;
+    if (!offset) { return true; }
+    if (offset < sizeof(Header) || offset > size || count > (size - offset) / sizeof(_T)) { return false; }
+    if (offset % alignof(_T) != 0) { return false; }
+    ptr = (_T*)(base + offset);
+    return true;
+}
+// Same as relocate, and the string needs to end inside the file
+bool relocate_string(const char*& str, u8* base, const size_t size) {
+    if (!relocate(str, 1, base, size)) { return false; }
+    return !str || memchr(str, 0, size - (size_t)((const u8*)str - base)) != nullptr;
+}
+
+// Maps the cooked file at path, and points the asset and streams into it. Fails if the file is
+// missing, malformed or written by a different version, or (with __COOK_ASSETS) if the source has
+// changed since it was cooked. On success the file stays mapped for as long as the process runs
+bool load(
+    game::AssetInMemory& assetToAdd, game::AssetStreams& assetStreams,
+    const char* path, const char* sourcePath) {
+
+    platform::MappedFile file;
+    if (!platform::file_map(file, path)) { return false; }
+    u8* base = (u8*)file.data;
+    Header& header = *(Header*)base;
+    bool valid =
+           file.size >= sizeof(Header) && header.magic == magic && header.version == version
+        && header.headerSize == sizeof(Header) && header.size == file.size;
+    #if __COOK_ASSETS
+    struct stat source;
+    if (valid && stat(sourcePath, &source) == 0) {
+        valid = header.sourceTimestamp == (s64)source.st_mtime;
+    }
+    #endif
+    for (u32 i = 0; i < renderer::DrawlistStreams::Count && valid; i++) {
+        game::AssetStreams::Stream& stream = header.streams.streams[i];
+        valid = relocate(stream.vertexData, (size_t)stream.vertexCount * stream.vertexSize, base, file.size)
+             && relocate(stream.indices, stream.indexCount, base, file.size)
+             && relocate_string(stream.texturePath, base, file.size);
+    }
+    animation::Skeleton& skeleton = header.asset.skeleton;
+    valid = valid
+         && relocate(skeleton.jointFromGeometry, skeleton.jointCount, base, file.size)
+         && relocate(skeleton.jointBounds, skeleton.jointCount, base, file.size)
+         && relocate(skeleton.parentIndices, skeleton.jointCount, base, file.size)
+         && relocate(header.asset.clips, header.asset.clipCount, base, file.size);
+    for (u32 i = 0; i < header.asset.clipCount && valid; i++) {
+        animation::Clip& clip = header.asset.clips[i];
+        animation::CompressedClip& compressed = clip.compressed;
+        valid = relocate(clip.frames, (size_t)clip.frameCount * clip.blockCount, base, file.size)
+             && relocate(compressed.tracks, (size_t)skeleton.jointCount * animation::TrackType::Count,
+                         base, file.size)
+             && relocate(compressed.keyFrames, compressed.keyCount, base, file.size)
+             && relocate(compressed.keys, compressed.keyCount, base, file.size);
+    }
+    if (!valid) {
+        platform::file_unmap(file);
+        return false;
+    }
+    assetToAdd = header.asset;
+    assetStreams = header.streams;
+    return true;
+}
+
+#if __COOK_ASSETS
+struct Writer {
+    FILE* f;
+    u64 offset;
+    bool ok;
+};
+// Writes count elements at the next aligned offset, and stores that offset in dst
+template <typename _T>
+void append(_T*& dst, Writer& writer, const void* src, const size_t count) {
+    static_assert(alignof(_T) <= sectionAlign, "section alignment is too small");
+    dst = nullptr;
+    if (!src || !count) { return; }
+    const u8 padding[sectionAlign] = {};
+    const u64 aligned = (writer.offset + sectionAlign - 1) & ~(u64)(sectionAlign - 1);
+    const size_t padBytes = (size_t)(aligned - writer.offset);
+    const size_t bytes = count * sizeof(_T);
+    writer.ok = writer.ok
+        && fwrite(padding, 1, padBytes, writer.f) == padBytes
+        && fwrite(src, 1, bytes, writer.f) == bytes;
+    writer.offset = aligned + bytes;
+    dst = (_T*)(uintptr_t)aligned;
+}
+
+// Cooker: saves an asset, as output by fbx::load_with_materials, to path.
+// The header is written last, so a partially written file never passes validation
+bool write(
+    const char* path, const char* sourcePath,
+    const game::AssetInMemory& asset, const game::AssetStreams& assetStreams,
+    allocator::PagedArena scratchArena) {
+
+    Writer writer = {};
+    if (io::fopen(&writer.f, path, "wb") != 0 || !writer.f) { return false; }
+
+    Header header = {};
+    writer.ok = fwrite(&header, sizeof(Header), 1, writer.f) == 1;
+    writer.offset = sizeof(Header);
+
+    header.magic = magic;
+    header.version = version;
+    header.headerSize = sizeof(Header);
+    struct stat source;
+    if (stat(sourcePath, &source) == 0) { header.sourceTimestamp = (s64)source.st_mtime; }
+
+    for (u32 i = 0; i < renderer::DrawlistStreams::Count; i++) {
+        const game::AssetStreams::Stream& src = assetStreams.streams[i];
+        game::AssetStreams::Stream& dst = header.streams.streams[i];
+        dst = src;
+        append(dst.vertexData, writer, src.vertexData, src.vertexCount * src.vertexSize);
+        append(dst.indices, writer, src.indices, src.indexCount);
+        append(dst.texturePath, writer, src.texturePath,
+               src.texturePath ? strlen(src.texturePath) + 1 : 0);
+    }
+
+    const animation::Skeleton& skeleton = asset.skeleton;
+    header.asset = asset;
+    memset(header.asset.meshHandles, 0, sizeof(header.asset.meshHandles));
+    append(header.asset.skeleton.jointFromGeometry, writer,
+           skeleton.jointFromGeometry, skeleton.jointCount);
+    append(header.asset.skeleton.jointBounds, writer, skeleton.jointBounds, skeleton.jointCount);
+    append(header.asset.skeleton.parentIndices, writer,
+           skeleton.parentIndices, skeleton.jointCount);
+
+    animation::Clip* clips = ALLOC_ARRAY(scratchArena, animation::Clip, asset.clipCount);
+    for (u32 i = 0; i < asset.clipCount; i++) {
+        const animation::Clip& src = asset.clips[i];
+        animation::Clip& dst = clips[i];
+        dst = src;
+        append(dst.frames, writer, src.frames, src.frameCount * src.blockCount);
+        append(dst.compressed.tracks, writer,
+               src.compressed.tracks, skeleton.jointCount * animation::TrackType::Count);
+        append(dst.compressed.keyFrames, writer, src.compressed.keyFrames, src.compressed.keyCount);
+        append(dst.compressed.keys, writer, src.compressed.keys, src.compressed.keyCount);
+    }
+    append(header.asset.clips, writer, clips, asset.clipCount);
+
+    header.size = writer.offset;
+    writer.ok = writer.ok
+        && fseek(writer.f, 0, SEEK_SET) == 0
+        && fwrite(&header, sizeof(Header), 1, writer.f) == 1;
+    io::fclose(writer.f);
+    return writer.ok;
+}
+#endif
+} // cooked
+
+// textures: decoded image of each stream's texturePath, see loader::decodeTextureJob
+void create_asset_meshes(
+    game::AssetInMemory& assetToAdd, renderer::CoreResources& renderCore,
+    fbx::PipelineAssetContext& pipelineContext, const game::AssetStreams& assetStreams,
+    const gfx::rhi::TextureFromMemoryParams* textures) {
+
+    const renderer::ShaderTechniques::Enum shaderTechniques[renderer::DrawlistStreams::Count] = {
+        renderer::ShaderTechniques::Color3D, renderer::ShaderTechniques::Color3DSkinned,
+        renderer::ShaderTechniques::Textured3D, renderer::ShaderTechniques::Textured3DAlphaClip,
+        renderer::ShaderTechniques::Textured3DSkinned,
+        renderer::ShaderTechniques::Textured3DAlphaClipSkinned
+    };
+    for (u32 i = 0; i < renderer::DrawlistStreams::Count; i++) {
+        const game::AssetStreams::Stream& stream = assetStreams.streams[i];
+        if (!stream.vertexCount) { continue; }
+
+        gfx::rhi::IndexedVertexBufferDesc desc = {};
+        desc.vertexData = stream.vertexData;
+        desc.vertexSize = stream.vertexCount * stream.vertexSize;
+        desc.vertexCount = stream.vertexCount;
+        desc.indexData = stream.indices;
+        desc.indexSize = stream.indexCount * sizeof(u32);
+        desc.indexCount = stream.indexCount;
+        desc.memoryUsage = gfx::rhi::BufferMemoryUsage::GPU;
+        desc.accessType = gfx::rhi::BufferAccessType::GPU;
+        desc.indexType = gfx::rhi::BufferItemType::U32;
+        desc.type = gfx::rhi::BufferTopologyType::Triangles;
+
+        renderer::DrawMesh& mesh = renderer::alloc_drawMesh(renderCore);
+        mesh = {};
+        mesh.shaderTechnique = shaderTechniques[i];
+        gfx::rhi::create_indexed_vertex_buffer(
+            mesh.vertexBuffer, desc, pipelineContext.vertexAttrs[i],
+            pipelineContext.attr_count[i]);
+        if (stream.texturePath) { gfx::rhi::create_texture_from_memory(mesh.texture, textures[i]); }
+        assetToAdd.meshHandles[i] = handle_from_drawMesh(renderCore, mesh);
+    }
+}
+
 void clip_poly_in_frustum(
     float3* poly, u32& poly_count, const float4* planes, const u32 planeCount, const u32 polyCountCap) {
 
@@ -802,12 +1184,24 @@ struct GatherMirrorTreeContext {
     allocator::Buffer<CameraNode>& cameraTree;
     const game::Mirrors& mirrors;
     u32 maxDepth;
+    volatile s32 frameArenaLock; // gather jobs share the frame arena
+};
+// Children of a camera in the mirror tree, the tree is gathered breadth-first before being
+// flattened into the depth-first CameraNode array
+struct MirrorTreeExpansion {
+    const CameraNode* parent;
+    CameraNode* children;
+    MirrorTreeExpansion* childExpansions; // one per child, nullptr if they aren't expanded further
+    u32 childCount;
 };
-u32 gatherMirrorTreeRecursive(GatherMirrorTreeContext& ctx, u32 index, const CameraNode& parent) {
+void gatherMirrorChildren(
+    MirrorTreeExpansion& expansion, GatherMirrorTreeContext& ctx,
+    allocator::PagedArena scratchArena) {
 
-    bool* mirrorVisibility = ALLOC_ARRAY(ctx.scratchArenaRoot, bool, ctx.mirrors.count);
+    const CameraNode& parent = *expansion.parent;
+    bool* mirrorVisibility = ALLOC_ARRAY(scratchArena, bool, ctx.mirrors.count);
     memset(mirrorVisibility, 0, ctx.mirrors.count * sizeof(bool));
-    if (ctx.mirrors.bvh.nodeCount) {
+    if (ctx.mirrors.bvh.wideNodeCount) {
         memset(mirrorVisibility, 0, ctx.mirrors.count * sizeof(bool));
         m256_4 planes_256[renderer::Frustum::MAX_PLANE_COUNT];
         for (u32 p = 0; p < parent.frustum.numPlanes; p++) {
@@ -816,14 +1210,14 @@ u32 gatherMirrorTreeRecursive(GatherMirrorTreeContext& ctx, u32 index, const Cam
             planes_256[p].vz = _mm256_set1_ps(parent.frustum.planes[p].z);
             planes_256[p].vw = _mm256_set1_ps(parent.frustum.planes[p].w);
         }
-        bvh::findTrianglesIntersectingFrustum(
-            ctx.scratchArenaRoot,mirrorVisibility, ctx.mirrors.bvh,
+        bvh::findTrianglesIntersectingFrustum_wide(
+            scratchArena, mirrorVisibility, ctx.mirrors.bvh,
             planes_256, parent.frustum.numPlanes);
     } else {
         memset(mirrorVisibility, 1, ctx.mirrors.count * sizeof(bool));
     }
 
-    u32 parentIndex = index - 1;
+    allocator::Buffer<CameraNode> children = {};
     for (u32 i = 0; i < ctx.mirrors.count; i++) {
 
         // didn't pass visibility pre-pass, if appropriate
@@ -850,13 +1244,13 @@ u32 gatherMirrorTreeRecursive(GatherMirrorTreeContext& ctx, u32 index, const Cam
         if (poly_count < 3) { continue; } // resulting mirror poly is fully culled
 
         // acknowledge this mirror as part of the tree
-        CameraNode& curr = allocator::push(ctx.cameraTree, ctx.frameArena);
-        curr.parentIndex = parentIndex;
+        // (parentIndex and siblingIndex are set once the tree is flattened)
+        CameraNode& curr = allocator::push(children, scratchArena);
         curr.depth = parent.depth + 1;
         curr.sourceId = i;
+        curr.drawMesh = ctx.mirrors.drawMeshes[i];
         // store mirror id only when using GPU markers
         __PROFILEONLY(io::format(curr.str, sizeof(curr.str), "%s-%d", parent.str, i);)
-        index++;
 
         // compute mirror matrices
         auto reflectionMatrix = [](float4 p) -> float4x4 { // todo: understand properly
@@ -911,15 +1305,96 @@ u32 gatherMirrorTreeRecursive(GatherMirrorTreeContext& ctx, u32 index, const Cam
                 prev_v = curr_v;
             }
         }
+    }
 
-        // recurse if there is room for one more mirror
-        if (curr.depth + 1 < ctx.maxDepth) {
-            index = gatherMirrorTreeRecursive(ctx, index, curr);
+    // the scratch arena goes away with the job, move the children to the frame arena
+    atomic::lock(&ctx.frameArenaLock);
+    expansion.children = ALLOC_ARRAY(ctx.frameArena, CameraNode, children.len);
+    atomic::unlock(&ctx.frameArenaLock);
+    memcpy(expansion.children, children.data, children.len * sizeof(CameraNode));
+    expansion.childCount = (u32)children.len;
+    expansion.childExpansions = nullptr;
+}
+struct GatherMirrorTreeTask {
+    GatherMirrorTreeContext* ctx;
+    MirrorTreeExpansion** expansions;
+    u32 count;
+};
+void gatherMirrorTreeTask(jobs::Context& jobCtx, void* data) {
+    GatherMirrorTreeTask& task = *(GatherMirrorTreeTask*)data;
+    for (u32 i = 0; i < task.count; i++) {
+        gatherMirrorChildren(*task.expansions[i], *task.ctx, jobCtx.scratchArena);
+    }
+}
+void flattenMirrorTree(
+    allocator::Buffer<CameraNode>& cameraTree, allocator::PagedArena& arena,
+    const MirrorTreeExpansion& expansion, const u32 parentIndex) {
+    for (u32 c = 0; c < expansion.childCount; c++) {
+        const u32 index = (u32)cameraTree.len;
+        allocator::push(cameraTree, arena) = expansion.children[c];
+        cameraTree.data[index].parentIndex = parentIndex;
+        if (expansion.childExpansions) {
+            flattenMirrorTree(cameraTree, arena, expansion.childExpansions[c], index);
         }
-        curr.drawMesh = ctx.mirrors.drawMeshes[i];
-        curr.siblingIndex = index;
+        cameraTree.data[index].siblingIndex = (u32)cameraTree.len;
+    }
+}
+// Gathers the tree one depth level at a time, with the cameras of each level split across jobs.
+// The result is stored depth-first in ctx.cameraTree, with the root at index 0.
+// Returns the number of cameras in the tree
+u32 gatherMirrorTree(GatherMirrorTreeContext& ctx, const CameraNode& root) {
+    allocator::PagedArena scratchArena = ctx.scratchArenaRoot;
+
+    MirrorTreeExpansion rootExpansion = {};
+    rootExpansion.parent = &root;
+    MirrorTreeExpansion** level = ALLOC_ARRAY(scratchArena, MirrorTreeExpansion*, 1);
+    level[0] = &rootExpansion;
+    u32 levelCount = 1;
+    u32 cameraCount = 1;
+    for (u32 depth = 0; levelCount > 0; depth++) {
+        // a few jobs per worker, so uneven subtrees can be balanced by stealing
+        const u32 maxJobs = jobs::pool.workerCount * 4;
+        const u32 expansionsPerJob = (levelCount + maxJobs - 1) / maxJobs;
+        const u32 jobCount = (levelCount + expansionsPerJob - 1) / expansionsPerJob;
+        GatherMirrorTreeTask* tasks = ALLOC_ARRAY(scratchArena, GatherMirrorTreeTask, jobCount);
+        jobs::Counter counter = {};
+        for (u32 j = 0; j < jobCount; j++) {
+            GatherMirrorTreeTask& task = tasks[j];
+            task.ctx = &ctx;
+            task.expansions = &level[j * expansionsPerJob];
+            task.count = math::min(expansionsPerJob, levelCount - j * expansionsPerJob);
+            jobs::push(counter, gatherMirrorTreeTask, &task, scratchArena);
+        }
+        jobs::wait(counter, scratchArena);
+
+        u32 nextLevelCount = 0;
+        for (u32 i = 0; i < levelCount; i++) { nextLevelCount += level[i]->childCount; }
+        cameraCount += nextLevelCount;
+        // expand the next level only if there is room for one more mirror
+        if (depth + 2 >= ctx.maxDepth) { break; }
+        MirrorTreeExpansion** nextLevel =
+            ALLOC_ARRAY(scratchArena, MirrorTreeExpansion*, nextLevelCount);
+        nextLevelCount = 0;
+        for (u32 i = 0; i < levelCount; i++) {
+            MirrorTreeExpansion& expansion = *level[i];
+            expansion.childExpansions =
+                ALLOC_ARRAY(scratchArena, MirrorTreeExpansion, expansion.childCount);
+            for (u32 c = 0; c < expansion.childCount; c++) {
+                MirrorTreeExpansion& childExpansion = expansion.childExpansions[c];
+                childExpansion = {};
+                childExpansion.parent = &expansion.children[c];
+                nextLevel[nextLevelCount++] = &childExpansion;
+            }
+        }
+        level = nextLevel;
+        levelCount = nextLevelCount;
     }
-    return index;
+
+    allocator::reserve(ctx.cameraTree, cameraCount, ctx.frameArena);
+    allocator::push(ctx.cameraTree, ctx.frameArena) = root;
+    flattenMirrorTree(ctx.cameraTree, ctx.frameArena, rootExpansion, 0);
+    ctx.cameraTree.data[0].siblingIndex = cameraCount;
+    return cameraCount;
 }
 
 void renderSDFScene(
@@ -1041,7 +1516,8 @@ void renderBaseScene(RenderSceneContext& sceneCtx) {
         dl.keys = ALLOC_ARRAY(scratchArena, SortKey, maxDrawCalls);
         addNodesToDrawlistSorted(
             dl, sceneCtx.visibleNodes, sceneCtx.camera.pos, scene, rsc,
-            0, renderer::DrawlistFilter::Alpha, renderer::SortParams::Type::Default);
+            0, renderer::DrawlistFilter::Alpha, renderer::SortParams::Type::Default,
+            scratchArena);
         if (dl.count[DrawlistBuckets::Base] + dl.count[DrawlistBuckets::Instanced] > 0) {
             gfx::rhi::start_event("OPAQUE");
             gfx::rhi::bind_DS(sceneCtx.ds_opaque, sceneCtx.camera.depth);
@@ -1076,7 +1552,8 @@ void renderBaseScene(RenderSceneContext& sceneCtx) {
         gfx::rhi::bind_blend_state(rsc.blendStateOn);
         addNodesToDrawlistSorted(
             dl, sceneCtx.visibleNodes, sceneCtx.camera.pos, scene, rsc,
-            renderer::DrawlistFilter::Alpha, 0, renderer::SortParams::Type::BackToFront);
+            renderer::DrawlistFilter::Alpha, 0, renderer::SortParams::Type::BackToFront,
+            scratchArena);
         if (dl.count[DrawlistBuckets::Base] + dl.count[DrawlistBuckets::Instanced] > 0) {
             gfx::rhi::bind_DS(sceneCtx.ds_alpha, sceneCtx.camera.depth);
             gfx::rhi::start_event("ALPHA");
@@ -1185,7 +1662,12 @@ void renderMirrorTree(
         const CameraNode& parent = cameraTree[parents[parentCount - 1]];
 
         // render this mirror
-        __PROFILEONLY(gfx::rhi::start_event(camera.str);)
+        // events are named by depth rather than by mirror path, so that passes at the same depth
+        // aggregate together in the capture and in the headless stage timings
+        __PROFILEONLY(
+            char eventName[16];
+            io::format(eventName, sizeof(eventName), "MIRROR %d", camera.depth);
+            gfx::rhi::start_event(eventName);)
         
         // mark mirror
         RenderMirrorContext mirrorContext {
@@ -1232,24 +1714,204 @@ struct SceneMemory {
     allocator::PagedArena scratchArena;
     __DEBUGDEF(allocator::PagedArena& debugArena;)
 };
+// from blender: export fbx -> Apply Scalings: FBX All
+// -> Forward: the one in Blender -> Use Space Transform: yes
+struct AssetDef {
+    const char* path;
+    const char* cookedPath;
+    game::Resources::AssetsMeta::Enum assetId;
+};
+const AssetDef assets[] = {
+    { "assets/meshes/bird.fbx", "assets/meshes/bird.cooked", game::Resources::AssetsMeta::Bird }
+};
+
+#if __COOK_ASSETS
+// Offline cooker: re-cooks every asset from its fbx source, no renderer needed.
+// Returns the number of assets cooked
+u32 cook_assets(allocator::PagedArena persistentArena, allocator::PagedArena scratchArena) {
+    u32 cooked = 0;
+    for (u32 asset_idx = 0; asset_idx < countof(assets); asset_idx++) {
+        allocator::PagedArena assetArena = persistentArena; // explicit copy, reset for each asset
+        fbx::PipelineAssetContext ctx = { scratchArena, assetArena };
+        game::AssetInMemory asset = {};
+        game::AssetStreams streams = {};
+        if (fbx::load_with_materials(asset, streams, ctx, assets[asset_idx].path)
+            && cooked::write(
+                assets[asset_idx].cookedPath, assets[asset_idx].path, asset, streams,
+                ctx.scratchArena)) {
+            cooked++;
+        }
+    }
+    return cooked;
+}
+#endif
+
+namespace loader {
+
+// Parallel asset loading: each asset is loaded by a job that maps its cooked file (or runs the fbx
+// pipeline on its source, re-cooking it with __COOK_ASSETS), and then pushes a job per texture
+// to decode it. File reads, parsing and decoding of different assets and textures overlap on
+// the worker threads, and with whatever the calling thread does until finish_asset_loads.
+// Fbx pipeline jobs allocate from load arenas of their own, and texture jobs decode in their
+// scratch arena and copy the pixels to a texture arena they all share. Both outlive the jobs and
+// get reset once the loads are finished. The gpu resources are only created in finish_asset_loads, on the calling
+// thread, since the renderer isn't thread safe
+
+const u32 maxLoads = 8;
+const u32 maxLoadArenas = 2 * maxLoads; // two per fbx asset
+const size_t loadArenaSize = 1024 * 1024; // initial commit
+
+struct TextureLoad {
+    gfx::rhi::TextureFromMemoryParams decoded;
+    const char* path;
+};
+struct AssetLoad {
+    const AssetDef* def;
+    game::AssetInMemory asset;
+    game::AssetStreams streams;
+    TextureLoad textures[renderer::DrawlistStreams::Count];
+    bool loaded;
+    bool cooked; // skeleton and clips point into the cooked file, rather than a load arena
+};
+struct State {
+    allocator::PagedArena arenas[maxLoadArenas];
+    u8* arenaBuffers[maxLoadArenas]; // to reset the load arenas after every batch of loads
+    allocator::ConcurrentArena textureArena; // decoded pixels of every texture load
+    AssetLoad loads[maxLoads];
+    jobs::Counter counter;
+    volatile s32 arenaCount;
+    u32 loadCount;
+};
+
+State state;
+
+allocator::PagedArena& acquire_arena() {
+    const s32 index = atomic::add(&state.arenaCount, 1);
+    assert(index < (s32)maxLoadArenas);
+    return state.arenas[index];
+}
+
+void decodeTextureJob(jobs::Context& jobCtx, void* data) {
+    TextureLoad& load = *(TextureLoad*)data;
+    gfx::rhi::TextureFromMemoryParams& decoded = load.decoded;
+    allocator::PagedArena scratchArena = jobCtx.scratchArena; // stb's buffers, scoped to the job
+    const u8* pixels = stbi_load_arena(
+        load.path, &decoded.width, &decoded.height, &decoded.channels, 4, scratchArena);
+    if (!pixels) { decoded.data = nullptr; return; }
+    const size_t size = (size_t)decoded.width * decoded.height * 4;
+    u8* dst = ALLOC_BYTES(state.textureArena, u8, size, 16);
+    memcpy(dst, pixels, size);
+    decoded.data = dst;
+}
+void loadAssetJob(jobs::Context& jobCtx, void* data) {
+    AssetLoad& load = *(AssetLoad*)data;
+    const AssetDef& def = *load.def;
+    load.cooked = cooked::load(load.asset, load.streams, def.cookedPath, def.path);
+    load.loaded = load.cooked;
+    if (!load.loaded) {
+        // streams and texture paths live in the scratch arena, so neither arena can be scoped
+        fbx::PipelineAssetContext ctx = { acquire_arena(), acquire_arena() };
+        load.loaded = fbx::load_with_materials(load.asset, load.streams, ctx, def.path);
+        #if __COOK_ASSETS
+        if (load.loaded && cooked::write(def.cookedPath, def.path, load.asset, load.streams, ctx.scratchArena)) {
+            io::debuglog("cooked %s to %s\n", def.path, def.cookedPath);
+        }
+        #endif
+    }
+    if (!load.loaded) { return; }
+    for (u32 i = 0; i < renderer::DrawlistStreams::Count; i++) {
+        TextureLoad& texture = load.textures[i];
+        texture = {};
+        texture.path = load.streams.streams[i].texturePath;
+        if (!texture.path) { continue; }
+        jobs::push(state.counter, decodeTextureJob, &texture, jobCtx.scratchArena);
+    }
+}
+
+template <typename _T>
+void copy_array(_T*& ptr, const size_t count, allocator::PagedArena& arena) {
+    if (!ptr || !count) { ptr = nullptr; return; }
+    _T* dst = ALLOC_ARRAY(arena, _T, count);
+    memcpy(dst, ptr, count * sizeof(_T));
+    ptr = dst;
+}
+// Deep copy of the skeleton and clips of an asset, so they outlive the load arenas
+void copy_animation(game::AssetInMemory& asset, allocator::PagedArena& arena) {
+    animation::Skeleton& skeleton = asset.skeleton;
+    const u32 jointCount = skeleton.jointCount;
+    copy_array(skeleton.jointFromGeometry, jointCount, arena);
+    copy_array(skeleton.jointBounds, jointCount, arena);
+    copy_array(skeleton.parentIndices, jointCount, arena);
+    copy_array(asset.clips, asset.clipCount, arena);
+    for (u32 i = 0; i < asset.clipCount; i++) {
+        animation::Clip& clip = asset.clips[i];
+        copy_array(clip.frames, clip.frameCount * clip.blockCount, arena);
+        copy_array(clip.compressed.tracks, jointCount * animation::TrackType::Count, arena);
+        copy_array(clip.compressed.keyFrames, clip.compressed.keyCount, arena);
+        copy_array(clip.compressed.keys, clip.compressed.keyCount, arena);
+    }
+}
+
+// Pushes a load job for each asset, and returns without waiting for them
+void start_asset_loads(
+    const AssetDef* defs, const u32 count, allocator::PagedArena scratchArena) {
+    assert(state.loadCount == 0 && count <= maxLoads); // one batch at a time
+    if (!state.arenaBuffers[0]) {
+        for (u32 i = 0; i < maxLoadArenas; i++) {
+            allocator::init_arena(state.arenas[i], loadArenaSize);
+            state.arenaBuffers[i] = state.arenas[i].curr;
+        }
+        allocator::init_arena(state.textureArena, loadArenaSize);
+    }
+    state.counter = {};
+    state.loadCount = count;
+    for (u32 i = 0; i < count; i++) {
+        AssetLoad& load = state.loads[i];
+        load = {};
+        load.def = &defs[i];
+        jobs::push(state.counter, loadAssetJob, &load, scratchArena);
+    }
+}
+
+// Waits for the loads started by start_asset_loads (running pending ones on this thread), and
+// creates their gpu resources. Skeletons and clips that don't live in a cooked file get copied
+// to the persistent arena
+void finish_asset_loads(
+    game::Resources& core, allocator::PagedArena& persistentArena,
+    fbx::PipelineAssetContext& ctx) {
+    jobs::wait(state.counter, ctx.scratchArena);
+    for (u32 i = 0; i < state.loadCount; i++) {
+        AssetLoad& load = state.loads[i];
+        game::AssetInMemory& assetToAdd = core.assets[load.def->assetId];
+        assetToAdd = {};
+        if (!load.loaded) { continue; }
+        assetToAdd = load.asset;
+        if (!load.cooked) { copy_animation(assetToAdd, persistentArena); }
+        gfx::rhi::TextureFromMemoryParams textures[renderer::DrawlistStreams::Count];
+        for (u32 t = 0; t < renderer::DrawlistStreams::Count; t++) {
+            textures[t] = load.textures[t].decoded;
+        }
+        create_asset_meshes(assetToAdd, core.renderCore, ctx, load.streams, textures);
+    }
+    for (s32 i = 0; i < state.arenaCount; i++) { state.arenas[i].curr = state.arenaBuffers[i]; }
+    allocator::reset_arena(state.textureArena);
+    state.arenaCount = 0;
+    state.loadCount = 0;
+}
+} // loader
+
 void load_coreResources(
         game::Resources& core, SceneMemory& memory,
         const platform::Screen& screen) {
 
+    // asset files are read and parsed on the workers while the shaders compile
+    loader::start_asset_loads(assets, countof(assets), memory.scratchArena);
+
     allocator::PagedArena& persistentArena = memory.persistentArena;
 
     renderer::CoreResources& renderCore = core.renderCore;
     renderCore = {};
 
-    // from blender: export fbx -> Apply Scalings: FBX All
-    // -> Forward: the one in Blender -> Use Space Transform: yes
-    struct AssetDef {
-        const char* path;
-        game::Resources::AssetsMeta::Enum assetId;
-    };
-    const AssetDef assets[] = {
-        { "assets/meshes/bird.fbx", game::Resources::AssetsMeta::Bird }
-    };
     // very very hack: number of assets * 4 + 16 (for the meshes we load ourselves)
     const size_t meshArenaSize = (countof(assets) * 4 + 16) * sizeof(renderer::DrawMesh);
     renderCore.meshes = ALLOC_BYTES(persistentArena, renderer::DrawMesh, meshArenaSize, alignof(renderer::DrawMesh));
@@ -1785,12 +2447,7 @@ void load_coreResources(
 		= attribs_textured3d_skinned;
     ctx.attr_count[renderer::DrawlistStreams::Textured3DAlphaClipSkinned]
 		= countof(attribs_textured3d_skinned);
-    for (u32 asset_idx = 0; asset_idx < countof(assets); asset_idx++) {
-		ctx.scratchArena = scratchArena; // explicit copy
-        game::AssetInMemory& assetToAdd = core.assets[assets[asset_idx].assetId];
-        assetToAdd = {};
-        fbx::load_with_materials(assetToAdd, renderCore, ctx, assets[asset_idx].path);
-    }
+    loader::finish_asset_loads(core, persistentArena, ctx);
 
     // instanced cubes
     {
@@ -1956,12 +2613,23 @@ void load_coreResources(
 
         renderer::CPUMesh& cpuBuffer = meshToLoad.cpuBuffer;
         cpuBuffer.vertices = ALLOC_ARRAY(persistentArena, float3, countof(vertices));
-        cpuBuffer.indices = ALLOC_ARRAY(persistentArena, u16, countof(indices));
+        cpuBuffer.indices = ALLOC_ARRAY(persistentArena, bvh::Index, countof(indices));
         for (u32 i = 0; i < countof(vertices); i++) { cpuBuffer.vertices[i] = vertices[i].pos; }
-        memcpy(cpuBuffer.indices, indices, sizeof(u16) * countof(indices));
+        for (u32 i = 0; i < countof(indices); i++) { cpuBuffer.indices[i] = indices[i]; }
         cpuBuffer.indexCount = countof(indices);
         cpuBuffer.vertexCount = countof(vertices);
 
+        // moving mirrors are drawn from a cpu-writable copy, rewritten by update_moving_mirrors
+        core.mirrorHallVertices =
+            ALLOC_ARRAY(persistentArena, renderer::VertexLayout_Color_3D, countof(vertices));
+        memcpy(core.mirrorHallVertices, vertices, sizeof(vertices));
+        core.mirrorHallIndices = ALLOC_ARRAY(persistentArena, u16, countof(indices));
+        memcpy(core.mirrorHallIndices, indices, sizeof(indices));
+        bufferParams.memoryUsage = gfx::rhi::BufferMemoryUsage::CPU;
+        bufferParams.accessType = gfx::rhi::BufferAccessType::CPU;
+        gfx::rhi::create_indexed_vertex_buffer(
+            core.mirrorHallDynamicBuffer, bufferParams, attribs, countof(attribs));
+
         // back mirror
         renderer::DrawMesh& mesh = renderer::alloc_drawMesh(renderCore);
         mesh = {};
@@ -2128,14 +2796,23 @@ void spawn_scene_mirrorRoom(
     size_t maxAnimNodes = countof(assetDefs);
     allocator::init_pool(renderScene.cbuffers, cbufferCount, sceneArena);
 	__DEBUGDEF(renderScene.cbuffers.name = "cbuffers";)
-    allocator::init_pool(renderScene.instancedDrawNodes, maxInstancedNodes, sceneArena);
+    renderScene.pendingCBuffers = ALLOC_ARRAY(sceneArena, renderer::CBufferRequest, cbufferCount);
+    renderScene.pendingCBufferCount = 0;
+    allocator::init_packed_pool(renderScene.instancedDrawNodes, (u32)maxInstancedNodes, sceneArena);
 	__DEBUGDEF(renderScene.instancedDrawNodes.name = "instanced draw nodes";)
     allocator::init_pool(renderScene.drawNodes, maxDrawNodes, sceneArena);
 	__DEBUGDEF(renderScene.drawNodes.name = "draw nodes";)
-    allocator::init_pool(animScene.nodes, maxAnimNodes, sceneArena);
+    renderer::initCullTree(renderScene.cullTree, (u32)maxDrawNodes, sceneArena);
+    allocator::init_packed_pool(animScene.nodes, (u32)maxAnimNodes, sceneArena);
 	__DEBUGDEF(animScene.nodes.name = "anim nodes";)
 
     // physics
+    {
+        const u32 maxWalls = 8; // ground bars
+        const u32 maxObstacles = countof(assetDefs) + 1; // assets and the SDF platform
+        const u32 maxBalls = roomDef.physicsBalls ? 8 : 0;
+        physics::init_scene(physicsScene, maxWalls, maxObstacles, maxBalls, sceneArena);
+    }
     if (roomDef.physicsBalls)
     {
         struct BallAssets {
@@ -2149,7 +2826,6 @@ void spawn_scene_mirrorRoom(
         const f32 h = 30.f;
         const f32 maxspeed = 20.f;
         //physicsScene.dt = 1 / 60.f;
-        physicsScene.ball_count = 8;
         physicsScene.bounds = float2(w, h);
         physicsScene.restitution = 1.f;
         const float origin_x = w - 5.f; const float origin_y = h - 5.f;
@@ -2159,8 +2835,8 @@ void spawn_scene_mirrorRoom(
             float2(0.f, -1.f), float2(-0.5f, -0.5f),
             float2(-1.f, 0.f), float2(-0.5f, 0.5f),
         };
-        for (u32 i = 0; i < physicsScene.ball_count; i++) {
-            physics::DynamicObject_Sphere& ball = physicsScene.balls[i];
+        for (u32 i = 0; i < physicsScene.ball_cap; i++) {
+            physics::DynamicObject_Sphere& ball = physics::add_ball(physicsScene);
             ball.radius = (math::rand() + 1.f) * 2.f;
             ball.mass = math::pi32 * ball.radius * ball.radius;
             const float2 pos_xy = math::scale(positions[i], float2(origin_x, origin_y));
@@ -2173,21 +2849,15 @@ void spawn_scene_mirrorRoom(
                     0.f);
         }
 
-        renderer::DrawNodeInstanced& node = allocator::alloc_pool(renderScene.instancedDrawNodes);
+        renderer::DrawNodeInstanced& node = allocator::alloc_packed_pool(renderScene.instancedDrawNodes);
         node = {};
         node.meshHandles[0] = core.instancedUnitSphereMesh;
         math::identity4x4(*(Transform*)&(node.nodeData.worldMatrix));
         node.nodeData.groupColor = Color32(0.72f, 0.74f, 0.12f, 1.f).RGBAv4();
         node.instanceCount = physicsScene.ball_count;
-        gfx::rhi::RscCBuffer& cbuffercore = allocator::alloc_pool(renderScene.cbuffers);
-        node.cbuffer_node = handle_from_cbuffer(renderScene, cbuffercore);
-        gfx::rhi::create_cbuffer(cbuffercore, { sizeof(renderer::NodeData) });
-        gfx::rhi::RscCBuffer& cbufferinstances =
-            allocator::alloc_pool(renderScene.cbuffers);
-        node.cbuffer_instances =
-            handle_from_cbuffer(renderScene, cbufferinstances);
-        gfx::rhi::create_cbuffer(
-            cbufferinstances, { u32(sizeof(float4x4)) * physicsScene.ball_count });
+        node.cbuffer_node = renderer::request_cbuffer(renderScene, sizeof(renderer::NodeData));
+        node.cbuffer_instances = renderer::request_cbuffer(
+            renderScene, u32(sizeof(float4x4)) * physicsScene.ball_count);
         for (u32 m = 0; m < countof(node.instanceMatrices.data); m++) {
             float4x4& matrix = node.instanceMatrices.data[m];
             math::identity4x4(*(Transform*)&(matrix));
@@ -2212,6 +2882,10 @@ void spawn_scene_mirrorRoom(
                  (column - max_column / 2) * spacing,
                   stride * spacing });
 
+            // the backs of the mirrors don't follow them around
+            if (roomDef.movingMirrors && assetDef.assetId == game::Resources::AssetsMeta::BackMirrors) {
+                continue;
+            }
             const game::AssetInMemory& asset = core.assets[assetDef.assetId];
 
             renderer::DrawNodeHandle renderHandle = {};
@@ -2226,8 +2900,7 @@ void spawn_scene_mirrorRoom(
             }
 
             if (roomDef.physicsBalls && assetDef.physicsObstacle) {
-                physics::StaticObject_Sphere& o =
-                    physicsScene.obstacles[physicsScene.obstacle_count++];
+                physics::StaticObject_Sphere& o = physics::add_obstacle(physicsScene);
                 o = {};
                 o.pos = assetDef.asset_init_pos;
                 f32 radius = math::min(
@@ -2244,21 +2917,15 @@ void spawn_scene_mirrorRoom(
 
     // unit cubes behind player when running
     {
-        renderer::DrawNodeInstanced& node = allocator::alloc_pool(renderScene.instancedDrawNodes);
+        renderer::DrawNodeInstanced& node = allocator::alloc_packed_pool(renderScene.instancedDrawNodes);
         node = {};
 		node.meshHandles[0] = core.instancedUnitCubeMesh;
         math::identity4x4(*(Transform*)&(node.nodeData.worldMatrix));
         node.nodeData.groupColor = Color32(0.68f, 0.69f, 0.71f, 1.f).RGBAv4();
         node.instanceCount = 4;
-        gfx::rhi::RscCBuffer& cbuffercore = allocator::alloc_pool(renderScene.cbuffers);
-        node.cbuffer_node = handle_from_cbuffer(renderScene, cbuffercore);
-        gfx::rhi::create_cbuffer(cbuffercore, { sizeof(renderer::NodeData) });
-        gfx::rhi::RscCBuffer& cbufferinstances =
-            allocator::alloc_pool(renderScene.cbuffers);
-        node.cbuffer_instances = handle_from_cbuffer(renderScene, cbufferinstances);
-        gfx::rhi::create_cbuffer(
-            cbufferinstances,
-            { (u32) sizeof(float4x4) * node.instanceCount });
+        node.cbuffer_node = renderer::request_cbuffer(renderScene, sizeof(renderer::NodeData));
+        node.cbuffer_instances = renderer::request_cbuffer(
+            renderScene, (u32) sizeof(float4x4) * node.instanceCount);
         for (u32 m = 0; m < countof(node.instanceMatrices.data); m++) {
             float4x4& matrix = node.instanceMatrices.data[m];
             math::identity4x4(*(Transform*)&(matrix));
@@ -2286,7 +2953,7 @@ void spawn_scene_mirrorRoom(
         {
             u32 prev = countof(ground) - 1;
             for (u32 i = 0; i < countof(ground); i++) {
-                physics::StaticObject_Line& wall = physicsScene.walls[physicsScene.wall_count++];
+                physics::StaticObject_Line& wall = physics::add_wall(physicsScene);
                 wall = {};
                 wall.start = float3(ground[prev], 0.f);
                 wall.end = float3(ground[i], 0.f);
@@ -2297,21 +2964,15 @@ void spawn_scene_mirrorRoom(
 
         // render setup
         {
-            renderer::DrawNodeInstanced& node = allocator::alloc_pool(renderScene.instancedDrawNodes);
+            renderer::DrawNodeInstanced& node = allocator::alloc_packed_pool(renderScene.instancedDrawNodes);
             node = {};
             node.meshHandles[0] = core.instancedUnitCubeMesh;
             math::identity4x4(*(Transform*)&(node.nodeData.worldMatrix));
             node.nodeData.groupColor = Color32(0.82f, 0.64f, 0.12f, 1.f).RGBAv4();
             node.instanceCount = 2 * game::Resources::MirrorHallMeta::Count + 1;
-            gfx::rhi::RscCBuffer& cbuffercore = allocator::alloc_pool(renderScene.cbuffers);
-            node.cbuffer_node = handle_from_cbuffer(renderScene, cbuffercore);
-            gfx::rhi::create_cbuffer(cbuffercore, { sizeof(renderer::NodeData) });
-            gfx::rhi::RscCBuffer& cbufferinstances =
-                allocator::alloc_pool(renderScene.cbuffers);
-            node.cbuffer_instances = handle_from_cbuffer(renderScene, cbufferinstances);
-            gfx::rhi::create_cbuffer(
-                cbufferinstances,
-                { (u32)sizeof(float4x4) * node.instanceCount });
+            node.cbuffer_node = renderer::request_cbuffer(renderScene, sizeof(renderer::NodeData));
+            node.cbuffer_instances = renderer::request_cbuffer(
+                renderScene, (u32)sizeof(float4x4) * node.instanceCount);
 
             // initialize whole buffer
             for (u32 m = 0; m < countof(node.instanceMatrices.data); m++) {
@@ -2373,15 +3034,27 @@ void spawn_scene_mirrorRoom(
         scene.mirrors.polys = ALLOC_ARRAY(sceneArena, game::Mirrors::Poly, numMirrors);
         scene.mirrors.drawMeshes = ALLOC_ARRAY(sceneArena, renderer::DrawMesh, numMirrors);
         scene.mirrors.bvh = {};
-        const game::GPUCPUMesh& mirrorMesh = core.mirrorHallMesh;
-        game::spawn_model_as_mirrors(scene.mirrors, mirrorMesh, scratchArena, sceneArena, true);
+        game::GPUCPUMesh mirrorMesh = core.mirrorHallMesh;
+        if (roomDef.movingMirrors) {
+            const renderer::CPUMesh& restMesh = core.mirrorHallMesh.cpuBuffer;
+            scene.mirrors.vertices = ALLOC_ARRAY(sceneArena, float3, restMesh.vertexCount);
+            memcpy(scene.mirrors.vertices, restMesh.vertices, restMesh.vertexCount * sizeof(float3));
+            scene.mirrors.time = 0.f;
+            scene.mirrors.bvhBuildMode = roomDef.mirrorBVHBuildMode;
+            mirrorMesh.cpuBuffer.vertices = scene.mirrors.vertices;
+            mirrorMesh.gpuBuffer = core.mirrorHallDynamicBuffer;
+        } else {
+            scene.mirrors.vertices = nullptr;
+        }
+        game::spawn_model_as_mirrors(
+            scene.mirrors, mirrorMesh, scratchArena, sceneArena, true, roomDef.mirrorBVHBuildMode,
+            roomDef.movingMirrors);
         scene.maxMirrorBounces = roomDef.maxMirrorBounces;
     }
 
     // SDF platform
     {
-        physics::StaticObject_Sphere& o =
-            physicsScene.obstacles[physicsScene.obstacle_count++];
+        physics::StaticObject_Sphere& o = physics::add_obstacle(physicsScene);
         o = {};
         f32 radius = game::SDF_scene_radius;
         o.radius = radius;
@@ -2398,6 +3071,32 @@ void spawn_scene_mirrorRoom(
         scene.orbitCamera.minScale = roomDef.minCameraZoom;
         scene.orbitCamera.maxScale = roomDef.maxCameraZoom;
     }
+
+    #if __DEBUG
+    {
+        const u32 removedCount = renderer::validateCullTree(scratchArena, renderScene);
+        io::debuglog("Cull tree check: %d draw nodes removed and added back\n", removedCount);
+    }
+    #endif
+}
+
+// Builds a room on a background worker, see jobs::push_background. The scene only takes the
+// sceneArena and core resources, and leaves its cbuffers pending, so that it doesn't touch anything
+// the render thread is using: the main thread creates them when it swaps the scene in
+struct BuildRoomTask {
+    game::Scene* scene;
+    allocator::PagedArena* sceneArena;
+    const game::Resources* core;
+    platform::Screen screen; // copy, the window may change while the room builds
+    const game::RoomDefinition* roomDef;
+};
+void buildRoomTask(jobs::Context& jobCtx, void* data) {
+    __PROFILEONLY(profiler::start_zone("build room");)
+    BuildRoomTask& task = *(BuildRoomTask*)data;
+    *task.scene = {};
+    spawn_scene_mirrorRoom(
+        *task.scene, *task.sceneArena, jobCtx.scratchArena, *task.core, task.screen, *task.roomDef);
+    __PROFILEONLY(profiler::end_zone();)
 }
 
 #endif // __WASTELADNS_SCENE_H__